@@ -0,0 +1,162 @@
+#include "animation.hpp"
+#include "draw_list.hpp"
+
+/*******************************************************************************
+ * ANIMATOR POOL
+ ******************************************************************************/
+
+uint32_t animator_pool_t::add_animation(const animation_t& animation)
+{
+  if (!animation.texture.is_valid()) {
+    throw input_exception("Animation with an invalid texture");
+  }
+
+  if (animation.frames.empty()) {
+    throw input_exception("Animation without frames");
+  }
+
+  if (animation.frames.size() != animation.durations.size()) {
+    throw input_exception("Animation with " + STR(animation.frames.size()) +
+                          " frames and " + STR(animation.durations.size()) +
+                          " durations");
+  }
+
+  for (const float d : animation.durations) {
+    if (d <= .0f) {
+      throw input_exception("Invalid animation frame duration: " + STR(d));
+    }
+  }
+
+  // Animations usually share a sprite sheet
+  uint32_t texture = static_cast<uint32_t>(_textures.size());
+  for (size_t i = 0; i < _textures.size(); ++i) {
+    if (_textures[i]._ptr == animation.texture._ptr) {
+      texture = static_cast<uint32_t>(i);
+      break;
+    }
+  }
+
+  if (texture == _textures.size()) { _textures.push_back(animation.texture); }
+
+  const clip_t clip = {static_cast<uint32_t>(_frames.size()),
+                       static_cast<uint32_t>(animation.frames.size()), texture,
+                       animation.loop};
+
+  _frames.insert(_frames.end(), animation.frames.begin(),
+                 animation.frames.end());
+  _durations.insert(_durations.end(), animation.durations.begin(),
+                    animation.durations.end());
+  _clips.push_back(clip);
+
+  return static_cast<uint32_t>(_clips.size() - 1);
+}
+
+
+uint32_t animator_pool_t::add(const uint32_t animation,
+                              const float x,
+                              const float y,
+                              const float w,
+                              const float h,
+                              const float speed)
+{
+  if (animation >= _clips.size()) {
+    throw input_exception("Invalid animation id: " + STR(animation));
+  }
+
+  if (speed < .0f) {
+    throw input_exception("Invalid animation speed: " + STR(speed));
+  }
+
+  _animators.push_back(
+      {animation, 0, .0f, speed, x, y, w, h, 0xFFFFFFFF, 1, true});
+
+  return static_cast<uint32_t>(_animators.size() - 1);
+}
+
+
+void animator_pool_t::remove(const uint32_t index)
+{
+  if (index >= _animators.size()) {
+    throw input_exception("Invalid animator index: " + STR(index));
+  }
+
+  _animators[index] = _animators.back();
+  _animators.pop_back();
+}
+
+
+void animator_pool_t::clear() { _animators.clear(); }
+
+
+void animator_pool_t::play(const uint32_t index, const uint32_t animation)
+{
+  if (index >= _animators.size()) {
+    throw input_exception("Invalid animator index: " + STR(index));
+  }
+
+  if (animation >= _clips.size()) {
+    throw input_exception("Invalid animation id: " + STR(animation));
+  }
+
+  animator_t& a = _animators[index];
+  a.animation = animation;
+  a.frame = 0;
+  a.time = .0f;
+  a.direction = 1;
+  a.playing = true;
+}
+
+
+void animator_pool_t::update(const float dt)
+{
+  const clip_t* clips = _clips.data();
+  const float* durations = _durations.data();
+
+  for (animator_t& a : _animators) {
+    if (!a.playing) { continue; }
+
+    const clip_t& c = clips[a.animation];
+    const float* d = durations + c.first;
+
+    a.time += dt * a.speed;
+
+    // A long frame time can skip several frames
+    while (a.time >= d[a.frame]) {
+      a.time -= d[a.frame];
+
+      if (c.count == 1) {
+        if (c.loop == loop_mode_t::ONCE) { a.playing = false; }
+        a.time = .0f;
+        break;
+      }
+
+      if (c.loop == loop_mode_t::LOOP) {
+        a.frame = a.frame + 1 == c.count ? 0 : a.frame + 1;
+      } else if (c.loop == loop_mode_t::ONCE) {
+        if (a.frame + 1 == c.count) {
+          a.playing = false;
+          a.time = .0f;
+          break;
+        }
+        ++a.frame;
+      } else {
+        // Bounces on both ends without repeating them
+        const int64_t next = static_cast<int64_t>(a.frame) + a.direction;
+        if (next < 0 || next >= c.count) { a.direction = -a.direction; }
+        a.frame += a.direction;
+      }
+    }
+  }
+}
+
+
+void animator_pool_t::record(draw_list_t& list) const
+{
+  list.reserve(list.size() + _animators.size());
+
+  for (const animator_t& a : _animators) {
+    const clip_t& c = _clips[a.animation];
+    list.add_sprite(_textures[c.texture], a.x, a.y, a.w, a.h,
+                    _frames[c.first + a.frame], a.tint);
+  }
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <type_traits>
+#include <vector>
+#include "pixello.hpp"
+
+class draw_list_t;
+
+/*******************************************************************************
+ * ANIMATION
+ ******************************************************************************/
+
+enum class loop_mode_t
+{
+  ONCE,  // Stops on the last frame
+  LOOP,
+  PING_PONG
+};
+
+// Clip data, described once and registered in an animator_pool_t that shares
+// it between all the animators playing it
+struct animation_t
+{
+  texture_t texture;
+  std::vector<rect_t> frames;
+  std::vector<float> durations;  // Seconds, one per frame
+  loop_mode_t loop = loop_mode_t::LOOP;
+
+  animation_t() {}
+  animation_t(const texture_t& t,
+              std::vector<rect_t> f,
+              std::vector<float> d,
+              const loop_mode_t l = loop_mode_t::LOOP)
+      : texture(t), frames(std::move(f)), durations(std::move(d)), loop(l)
+  {}
+
+  // Same duration for every frame
+  animation_t(const texture_t& t,
+              std::vector<rect_t> f,
+              const float frame_duration,
+              const loop_mode_t l = loop_mode_t::LOOP)
+      : texture(t),
+        frames(std::move(f)),
+        durations(frames.size(), frame_duration),
+        loop(l)
+  {}
+};
+
+// Playback state of one sprite. Plain data, the pool keeps them packed.
+struct animator_t
+{
+  uint32_t animation;
+  uint32_t frame;
+  float time;   // Seconds spent in the current frame
+  float speed;  // Playback rate, 1 is the authored speed
+  float x, y;   // World rect
+  float w, h;
+  pixel_t tint;
+  int8_t direction;  // Ping pong only, 1 or -1
+  bool playing;
+};
+
+static_assert(std::is_trivially_copyable_v<animator_t>,
+              "Animators are copied around as plain data");
+
+
+/*******************************************************************************
+ * ANIMATOR POOL
+ ******************************************************************************/
+// Owns the animations and a packed array of animators. update() advances all
+// of them in one pass over contiguous memory and record() feeds them to a draw
+// list. The frames of every animation are flattened in one array.
+class animator_pool_t
+{
+private:
+  struct clip_t
+  {
+    uint32_t first;  // In _frames and _durations
+    uint32_t count;
+    uint32_t texture;
+    loop_mode_t loop;
+  };
+
+  std::vector<clip_t> _clips;
+  std::vector<rect_t> _frames;
+  std::vector<float> _durations;
+  std::vector<texture_t> _textures;
+
+  std::vector<animator_t> _animators;
+
+public:
+  // Returns the id used to play it
+  uint32_t add_animation(const animation_t& animation);
+  inline size_t animation_count() const { return _clips.size(); }
+
+  // Returns the index of the new animator
+  uint32_t add(const uint32_t animation,
+               const float x,
+               const float y,
+               const float w,
+               const float h,
+               const float speed = 1.0f);
+  // Swap remove, the last animator moves to the index
+  void remove(const uint32_t index);
+  void clear();
+  inline void reserve(const size_t n) { _animators.reserve(n); }
+
+  // Restarts the animator on another animation
+  void play(const uint32_t index, const uint32_t animation);
+
+  // Advances every playing animator by dt seconds
+  void update(const float dt);
+
+  // Adds one sprite per animator, in array order
+  void record(draw_list_t& list) const;
+
+  inline rect_t frame_clip(const uint32_t index) const
+  {
+    const animator_t& a = _animators[index];
+    return _frames[_clips[a.animation].first + a.frame];
+  }
+
+  inline animator_t& operator[](const uint32_t index)
+  {
+    return _animators[index];
+  }
+  inline const animator_t& operator[](const uint32_t index) const
+  {
+    return _animators[index];
+  }
+  inline size_t size() const { return _animators.size(); }
+  inline std::vector<animator_t>& animators() { return _animators; }
+  inline const std::vector<animator_t>& animators() const
+  {
+    return _animators;
+  }
+};
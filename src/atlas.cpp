@@ -0,0 +1,123 @@
+#include "atlas.hpp"
+#include <algorithm>
+
+/*******************************************************************************
+ * SKYLINE PACKER
+ ******************************************************************************/
+
+skyline_packer_t::skyline_packer_t(const int32_t w, const int32_t h)
+    : _w(w), _h(h)
+{
+  if (w < 1 || h < 1) {
+    throw input_exception("Invalid atlas page size: " + STR(w) + "x" + STR(h));
+  }
+
+  reset();
+}
+
+
+void skyline_packer_t::reset()
+{
+  _used_area = 0;
+  _used_w = 0;
+  _used_h = 0;
+  _skyline.clear();
+  _skyline.push_back({0, 0, _w});
+}
+
+
+bool skyline_packer_t::fits(const size_t index,
+                            const int32_t w,
+                            const int32_t h,
+                            int32_t& y) const
+{
+  const int32_t x = _skyline[index].x;
+  if (x + w > _w) { return false; }
+
+  // The rect lies on the highest segment it spans
+  int32_t width_left = w;
+  size_t i = index;
+  y = _skyline[index].y;
+
+  while (width_left > 0) {
+    y = std::max(y, _skyline[i].y);
+    if (y + h > _h) { return false; }
+
+    width_left -= _skyline[i].w;
+    ++i;
+  }
+
+  return true;
+}
+
+
+void skyline_packer_t::add_level(const size_t index, const rect_t& rect)
+{
+  const node_t node = {rect.x, rect.y + rect.h, rect.w};
+  _skyline.insert(_skyline.begin() + index, node);
+
+  // Shrink or remove the segments covered by the new one
+  for (size_t i = index + 1; i < _skyline.size(); ++i) {
+    node_t& prev = _skyline[i - 1];
+    node_t& curr = _skyline[i];
+
+    if (curr.x >= prev.x + prev.w) { break; }
+
+    const int32_t shrink = prev.x + prev.w - curr.x;
+    curr.x += shrink;
+    curr.w -= shrink;
+
+    if (curr.w > 0) { break; }
+
+    _skyline.erase(_skyline.begin() + i);
+    --i;
+  }
+
+  // Merge neighbours at the same height
+  for (size_t i = 0; i + 1 < _skyline.size(); ++i) {
+    if (_skyline[i].y == _skyline[i + 1].y) {
+      _skyline[i].w += _skyline[i + 1].w;
+      _skyline.erase(_skyline.begin() + i + 1);
+      --i;
+    }
+  }
+}
+
+
+bool skyline_packer_t::pack(const int32_t w, const int32_t h, rect_t& out)
+{
+  if (w < 1 || h < 1) {
+    throw input_exception("Invalid rect size to pack: " + STR(w) + "x" +
+                          STR(h));
+  }
+
+  int32_t best_top = INT32_MAX;
+  int32_t best_w = INT32_MAX;
+  size_t best_index = _skyline.size();
+  rect_t best = {0, 0, w, h};
+
+  for (size_t i = 0; i < _skyline.size(); ++i) {
+    int32_t y;
+    if (!fits(i, w, h, y)) { continue; }
+
+    // Lowest top edge first, narrowest segment on ties
+    const int32_t top = y + h;
+    if (top < best_top || (top == best_top && _skyline[i].w < best_w)) {
+      best_top = top;
+      best_w = _skyline[i].w;
+      best_index = i;
+      best.x = _skyline[i].x;
+      best.y = y;
+    }
+  }
+
+  if (best_index == _skyline.size()) { return false; }
+
+  add_level(best_index, best);
+  _used_area += static_cast<int64_t>(w) * h;
+  _used_w = std::max(_used_w, best.x + w);
+  _used_h = std::max(_used_h, best.y + h);
+  out = best;
+
+  return true;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+#include "pixello.hpp"
+
+/*******************************************************************************
+ * SKYLINE PACKER
+ ******************************************************************************/
+// Packs rectangles into a fixed size page using the skyline bottom-left
+// heuristic. The packer only computes positions, it does not own any pixels.
+class skyline_packer_t
+{
+private:
+  struct node_t
+  {
+    int32_t x;
+    int32_t y;
+    int32_t w;
+  };
+
+  int32_t _w;
+  int32_t _h;
+  int64_t _used_area = 0;
+  int32_t _used_w = 0;
+  int32_t _used_h = 0;
+  std::vector<node_t> _skyline;
+
+  bool fits(const size_t index,
+            const int32_t w,
+            const int32_t h,
+            int32_t& y) const;
+  void add_level(const size_t index, const rect_t& rect);
+
+public:
+  skyline_packer_t(const int32_t w, const int32_t h);
+
+  // Returns false if the rect does not fit anymore in the page
+  bool pack(const int32_t w, const int32_t h, rect_t& out);
+  void reset();
+
+  inline int32_t width() const { return _w; }
+  inline int32_t height() const { return _h; }
+  // Extent of the packed rects, all a page needs to hold them
+  inline int32_t used_width() const { return _used_w; }
+  inline int32_t used_height() const { return _used_h; }
+  inline float occupancy() const
+  {
+    return static_cast<float>(_used_area) / static_cast<float>(_w * _h);
+  }
+};
@@ -0,0 +1,502 @@
+#include "audio_engine.hpp"
+#include "music_stream.hpp"
+#include <SDL_mixer.h>
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/*******************************************************************************
+ * MIXING KERNELS
+ ******************************************************************************/
+
+static void accumulate_s16(float* acc,
+                           const int16_t* src,
+                           const size_t n,
+                           const float gain)
+{
+  size_t i = 0;
+
+#if defined(__SSE2__)
+  const __m128 g = _mm_set1_ps(gain);
+
+  for (; i + 8 <= n; i += 8) {
+    const __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+
+    // Sign extend to 32 bits
+    const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+    const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+
+    const __m128 a0 = _mm_loadu_ps(acc + i);
+    const __m128 a1 = _mm_loadu_ps(acc + i + 4);
+    _mm_storeu_ps(acc + i, _mm_add_ps(a0, _mm_mul_ps(_mm_cvtepi32_ps(lo), g)));
+    _mm_storeu_ps(acc + i + 4,
+                  _mm_add_ps(a1, _mm_mul_ps(_mm_cvtepi32_ps(hi), g)));
+  }
+#endif
+
+  for (; i < n; ++i) {
+    acc[i] += src[i] * gain;
+  }
+}
+
+
+static void accumulate_f32(float* acc,
+                           const float* src,
+                           const size_t n,
+                           const float gain)
+{
+  size_t i = 0;
+
+#if defined(__SSE2__)
+  const __m128 g = _mm_set1_ps(gain);
+
+  for (; i + 4 <= n; i += 4) {
+    const __m128 a = _mm_loadu_ps(acc + i);
+    const __m128 s = _mm_loadu_ps(src + i);
+    _mm_storeu_ps(acc + i, _mm_add_ps(a, _mm_mul_ps(s, g)));
+  }
+#endif
+
+  for (; i < n; ++i) {
+    acc[i] += src[i] * gain;
+  }
+}
+
+
+// Adds the accumulator to the SDL_mixer output, saturating
+static void output_s16(int16_t* out, const float* acc, const size_t n)
+{
+  size_t i = 0;
+
+#if defined(__SSE2__)
+  for (; i + 8 <= n; i += 8) {
+    const __m128i s = _mm_loadu_si128((const __m128i*)(out + i));
+    const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+    const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+
+    const __m128 f0 = _mm_add_ps(_mm_cvtepi32_ps(lo), _mm_loadu_ps(acc + i));
+    const __m128 f1 =
+        _mm_add_ps(_mm_cvtepi32_ps(hi), _mm_loadu_ps(acc + i + 4));
+
+    // The pack saturates to the int16 range
+    const __m128i r =
+        _mm_packs_epi32(_mm_cvtps_epi32(f0), _mm_cvtps_epi32(f1));
+    _mm_storeu_si128((__m128i*)(out + i), r);
+  }
+#endif
+
+  for (; i < n; ++i) {
+    const float v = out[i] + acc[i];
+    out[i] = static_cast<int16_t>(std::clamp(v, -32768.0f, 32767.0f));
+  }
+}
+
+
+static void output_f32(float* out, const float* acc, const size_t n)
+{
+  size_t i = 0;
+
+#if defined(__SSE2__)
+  const __m128 lo = _mm_set1_ps(-1.0f);
+  const __m128 hi = _mm_set1_ps(1.0f);
+
+  for (; i + 4 <= n; i += 4) {
+    const __m128 v = _mm_add_ps(_mm_loadu_ps(out + i), _mm_loadu_ps(acc + i));
+    _mm_storeu_ps(out + i, _mm_min_ps(_mm_max_ps(v, lo), hi));
+  }
+#endif
+
+  for (; i < n; ++i) {
+    out[i] = std::clamp(out[i] + acc[i], -1.0f, 1.0f);
+  }
+}
+
+
+/*******************************************************************************
+ * AUDIO ENGINE
+ ******************************************************************************/
+
+audio_engine_t::audio_engine_t(const int32_t frequency,
+                               const audio_format_t format,
+                               const int32_t channels,
+                               const size_t max_voices)
+    : _frequency(frequency),
+      _channels(channels),
+      _format(format),
+      _sample_bytes(format == audio_format_t::S16 ? 2 : 4)
+{
+  if (max_voices > MAX_VOICES) {
+    throw input_exception("Too many mixer voices: " + STR(max_voices));
+  }
+
+  _voices.resize(max_voices);
+  for (auto& v : _voices) {
+    v.active = false;
+  }
+
+  if (max_voices > 0) { _accum.resize(MAX_BLOCK_SAMPLES); }
+
+  _music_accum.resize(MAX_BLOCK_SAMPLES);
+  _music_block.resize(MAX_BLOCK_SAMPLES * _sample_bytes);
+}
+
+
+bool audio_engine_t::play(const sound_t& sound, const float gain)
+{
+  collect();
+
+  if (_voices.empty()) {
+    throw runtime_exception("The custom mixer is disabled in the config");
+  }
+
+  const Mix_Chunk* chunk = sound.pointer();
+  if (chunk == NULL) { throw input_exception("Playing an empty sound"); }
+
+  // Keep the chunk alive until the audio thread is done with it
+  uint32_t retain;
+  if (_free_retain.empty()) {
+    retain = static_cast<uint32_t>(_retained.size());
+    _retained.push_back(sound._ptr);
+  } else {
+    retain = _free_retain.back();
+    _free_retain.pop_back();
+    _retained[retain] = sound._ptr;
+  }
+
+  const command_t cmd = {chunk->abuf, chunk->alen, gain, retain};
+
+  if (!_commands.push(cmd)) {
+    _retained[retain].reset();
+    _free_retain.push_back(retain);
+    _dropped_voices.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  return true;
+}
+
+
+void audio_engine_t::collect()
+{
+  uint32_t retain;
+  while (_finished.pop(retain)) {
+    _retained[retain].reset();
+    _free_retain.push_back(retain);
+  }
+
+  // Dropped by the audio thread, the decode threads are joined here
+  music_stream_t* stream;
+  while (_finished_streams.pop(stream)) {
+    if (_playing_stream.get() == stream) { _playing_stream.reset(); }
+
+    for (size_t i = 0; i < _streams.size(); ++i) {
+      if (_streams[i].get() != stream) { continue; }
+      _streams[i] = _streams.back();
+      _streams.pop_back();
+      break;
+    }
+  }
+}
+
+
+audio_stats_t audio_engine_t::stats() const
+{
+  audio_stats_t s;
+  s.frequency = _frequency;
+  s.channels = _channels;
+  s.format = _format;
+
+  const uint32_t bytes = _buffer_bytes.load(std::memory_order_relaxed);
+  s.buffer_frames = static_cast<int32_t>(bytes / (_sample_bytes * _channels));
+  s.buffer_ms = s.buffer_frames * 1000.0f / _frequency;
+  s.estimated_latency_ms = s.buffer_ms * 2.0f;
+
+  const float freq = static_cast<float>(SDL_GetPerformanceFrequency());
+  const uint64_t callbacks = _callbacks.load(std::memory_order_relaxed);
+  if (callbacks > 1) {
+    const uint64_t sum = _interval_sum.load(std::memory_order_relaxed);
+    s.avg_callback_interval_ms = sum * 1000.0f / freq / (callbacks - 1);
+  }
+
+  s.max_callback_interval_ms =
+      _interval_max.load(std::memory_order_relaxed) * 1000.0f / freq;
+  s.late_callbacks = _late_callbacks.load(std::memory_order_relaxed);
+  s.active_voices = _active_voices.load(std::memory_order_relaxed);
+  s.dropped_voices = _dropped_voices.load(std::memory_order_relaxed);
+
+  return s;
+}
+
+
+void audio_engine_t::play_stream(const std::string& path,
+                                 const uint32_t buffer_ms,
+                                 const float fade_s,
+                                 const bool loop)
+{
+  collect();
+
+  auto stream = std::make_shared<music_stream_t>(
+      path, _frequency, _format, _channels, buffer_ms, loop);
+
+  const uint32_t fade = static_cast<uint32_t>(fade_s * _frequency);
+  if (!_stream_commands.push({stream.get(), fade})) {
+    throw runtime_exception("Too many queued music changes");
+  }
+
+  _streams.push_back(stream);
+  _playing_stream = std::move(stream);
+}
+
+
+void audio_engine_t::stop_streams(const float fade_s)
+{
+  collect();
+
+  if (_streams.empty()) { return; }
+
+  const uint32_t fade = static_cast<uint32_t>(fade_s * _frequency);
+  if (!_stream_commands.push({NULL, fade})) {
+    throw runtime_exception("Too many queued music changes");
+  }
+
+  _playing_stream.reset();
+}
+
+
+void audio_engine_t::reset_streams()
+{
+  stream_command_t cmd;
+  while (_stream_commands.pop(cmd)) {}
+
+  music_stream_t* stream;
+  while (_finished_streams.pop(stream)) {}
+
+  _current = stream_slot_t();
+  _previous = stream_slot_t();
+  _playing_stream.reset();
+  _streams.clear();
+}
+
+
+music_stream_stats_t audio_engine_t::stream_stats() const
+{
+  music_stream_stats_t s;
+  if (!_playing_stream) { return s; }
+
+  s.playing = true;
+  s.fill = _playing_stream->fill();
+  s.buffered_ms = _playing_stream->buffered_ms();
+  s.underruns = _playing_stream->underruns();
+  s.loops = _playing_stream->loops();
+  return s;
+}
+
+
+void audio_engine_t::start_voices()
+{
+  command_t cmd;
+  size_t slot = 0;
+
+  while (_commands.pop(cmd)) {
+    while (slot < _voices.size() && _voices[slot].active) { ++slot; }
+
+    if (slot == _voices.size()) {
+      // No free voice, the sound is lost
+      _dropped_voices.fetch_add(1, std::memory_order_relaxed);
+      (void)_finished.push(cmd.retain);
+      continue;
+    }
+
+    _voices[slot] = {cmd.data, cmd.length, 0, cmd.gain, cmd.retain, true};
+  }
+}
+
+
+void audio_engine_t::mix_voices(uint8_t* stream, const size_t samples)
+{
+  float* acc = _accum.data();
+  std::fill(acc, acc + samples, 0.0f);
+
+  const uint32_t block_bytes = static_cast<uint32_t>(samples * _sample_bytes);
+  uint32_t active = 0;
+
+  for (auto& v : _voices) {
+    if (!v.active) { continue; }
+
+    const uint32_t bytes = std::min(block_bytes, v.length - v.position);
+    const size_t n = bytes / _sample_bytes;
+    const uint8_t* src = v.data + v.position;
+
+    if (_format == audio_format_t::S16) {
+      accumulate_s16(acc, (const int16_t*)src, n, v.gain);
+    } else {
+      accumulate_f32(acc, (const float*)src, n, v.gain);
+    }
+
+    v.position += bytes;
+
+    if (v.position >= v.length) {
+      v.active = false;
+      (void)_finished.push(v.retain);
+    } else {
+      ++active;
+    }
+  }
+
+  if (_format == audio_format_t::S16) {
+    output_s16((int16_t*)stream, acc, samples);
+  } else {
+    output_f32((float*)stream, acc, samples);
+  }
+
+  _active_voices.store(active, std::memory_order_relaxed);
+}
+
+
+void audio_engine_t::postmix(uint8_t* stream, const int len)
+{
+  // Timing of the device callbacks
+  const uint64_t now = SDL_GetPerformanceCounter();
+  const uint64_t callbacks = _callbacks.fetch_add(1, std::memory_order_relaxed);
+
+  _buffer_bytes.store(static_cast<uint32_t>(len), std::memory_order_relaxed);
+
+  if (callbacks > 0) {
+    const uint64_t interval = now - _last_callback;
+    _interval_sum.fetch_add(interval, std::memory_order_relaxed);
+
+    if (interval > _interval_max.load(std::memory_order_relaxed)) {
+      _interval_max.store(interval, std::memory_order_relaxed);
+    }
+
+    // Way later than the buffer duration, the device probably starved
+    const uint64_t frames = len / (_sample_bytes * _channels);
+    const uint64_t expected =
+        frames * SDL_GetPerformanceFrequency() / _frequency;
+    if (interval > expected + expected / 2) {
+      _late_callbacks.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  _last_callback = now;
+
+  if (_voices.empty()) { return; }
+
+  start_voices();
+
+  // The accumulator has a fixed size, long buffers are mixed in blocks
+  const size_t total = len / _sample_bytes;
+  size_t done = 0;
+
+  while (done < total) {
+    const size_t samples = std::min(total - done, MAX_BLOCK_SAMPLES);
+    mix_voices(stream + done * _sample_bytes, samples);
+    done += samples;
+  }
+}
+
+
+void audio_engine_t::release_stream(stream_slot_t& slot)
+{
+  if (slot.stream) { (void)_finished_streams.push(slot.stream); }
+  slot = stream_slot_t();
+}
+
+
+void audio_engine_t::start_streams()
+{
+  stream_command_t cmd;
+
+  while (_stream_commands.pop(cmd)) {
+    // A third track cuts the one still fading out
+    release_stream(_previous);
+    _previous = _current;
+    _current = stream_slot_t();
+
+    if (cmd.fade_frames == 0) {
+      release_stream(_previous);
+    } else {
+      _previous.step = -1.0f / cmd.fade_frames;
+    }
+
+    if (cmd.stream == NULL) { continue; }
+
+    _current.stream = cmd.stream;
+    _current.gain = cmd.fade_frames == 0 ? 1.0f : 0.0f;
+    _current.step = cmd.fade_frames == 0 ? 0.0f : 1.0f / cmd.fade_frames;
+  }
+}
+
+
+void audio_engine_t::mix_stream(stream_slot_t& slot, const size_t samples)
+{
+  if (slot.stream == NULL) { return; }
+
+  const size_t bytes = slot.stream->read(_music_block.data(),
+                                         samples * _sample_bytes);
+  const size_t n = bytes / _sample_bytes;
+  float* acc = _music_accum.data();
+
+  if (slot.step == 0.0f) {
+    if (_format == audio_format_t::S16) {
+      accumulate_s16(acc, (const int16_t*)_music_block.data(), n, slot.gain);
+    } else {
+      accumulate_f32(acc, (const float*)_music_block.data(), n, slot.gain);
+    }
+  } else {
+    // Fading, the gain moves once per frame
+    const int16_t* s16 = (const int16_t*)_music_block.data();
+    const float* f32 = (const float*)_music_block.data();
+
+    for (size_t i = 0; i < n; i += _channels) {
+      for (int32_t c = 0; c < _channels; ++c) {
+        const float v = _format == audio_format_t::S16 ? s16[i + c]
+                                                       : f32[i + c];
+        acc[i + c] += v * slot.gain;
+      }
+
+      slot.gain = std::clamp(slot.gain + slot.step, 0.0f, 1.0f);
+    }
+
+    if (slot.step > 0.0f && slot.gain >= 1.0f) { slot.step = 0.0f; }
+  }
+
+  const bool faded_out = slot.step < 0.0f && slot.gain <= 0.0f;
+  if (faded_out || slot.stream->finished()) { release_stream(slot); }
+}
+
+
+void audio_engine_t::music(uint8_t* stream, const int len)
+{
+  start_streams();
+
+  // SDL_mixer hands over a silent buffer
+  if (_streams_paused.load(std::memory_order_relaxed)) { return; }
+  if (_current.stream == NULL && _previous.stream == NULL) { return; }
+
+  // Whole frames per block, the fades step per frame
+  const size_t block = MAX_BLOCK_SAMPLES - MAX_BLOCK_SAMPLES % _channels;
+  const size_t total = len / _sample_bytes;
+  size_t done = 0;
+
+  while (done < total) {
+    const size_t samples = std::min(total - done, block);
+    float* acc = _music_accum.data();
+    std::fill(acc, acc + samples, 0.0f);
+
+    mix_stream(_previous, samples);
+    mix_stream(_current, samples);
+
+    uint8_t* out = stream + done * _sample_bytes;
+    if (_format == audio_format_t::S16) {
+      output_s16((int16_t*)out, acc, samples);
+    } else {
+      output_f32((float*)out, acc, samples);
+    }
+
+    done += samples;
+  }
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "pixello.hpp"
+#include "spsc_ring.hpp"
+
+class music_stream_t;
+
+/*******************************************************************************
+ * AUDIO ENGINE
+ ******************************************************************************/
+// Runs inside the SDL_mixer post mix callback. It measures the callbacks to
+// report the real buffer size and timing, and mixes a pool of voices on top
+// of the SDL_mixer output. It also feeds the music hook from streamed tracks,
+// crossfading between them. The main thread only talks to it through lock
+// free rings.
+class audio_engine_t
+{
+private:
+  static constexpr size_t COMMAND_RING = 1024;
+  static constexpr size_t FINISHED_RING = 4096;
+  static constexpr size_t MAX_BLOCK_SAMPLES = 8192;
+  static constexpr size_t STREAM_RING = 16;
+
+  struct command_t
+  {
+    const uint8_t* data;
+    uint32_t length;  // Bytes
+    float gain;
+    uint32_t retain;  // Slot keeping the sound alive
+  };
+
+  struct voice_t
+  {
+    const uint8_t* data;
+    uint32_t length;
+    uint32_t position;
+    float gain;
+    uint32_t retain;
+    bool active;
+  };
+
+  struct stream_command_t
+  {
+    music_stream_t* stream;  // NULL stops the music
+    uint32_t fade_frames;
+  };
+
+  struct stream_slot_t
+  {
+    music_stream_t* stream = NULL;
+    float gain = 0.0f;
+    float step = 0.0f;  // Per frame
+  };
+
+  int32_t _frequency;
+  int32_t _channels;
+  audio_format_t _format;
+  uint32_t _sample_bytes;
+
+  // Audio thread only
+  std::vector<voice_t> _voices;
+  std::vector<float> _accum;
+  uint64_t _last_callback = 0;
+  stream_slot_t _current;
+  stream_slot_t _previous;  // Fading out
+  std::vector<float> _music_accum;
+  std::vector<uint8_t> _music_block;
+
+  spsc_ring_t<command_t, COMMAND_RING> _commands;
+  spsc_ring_t<uint32_t, FINISHED_RING> _finished;
+  spsc_ring_t<stream_command_t, STREAM_RING> _stream_commands;
+  spsc_ring_t<music_stream_t*, STREAM_RING> _finished_streams;
+
+  // Main thread only
+  std::vector<std::shared_ptr<sdl_sound_wrapper_t>> _retained;
+  std::vector<uint32_t> _free_retain;
+  std::vector<std::shared_ptr<music_stream_t>> _streams;
+  std::shared_ptr<music_stream_t> _playing_stream;
+
+  // Shared counters
+  std::atomic<uint32_t> _buffer_bytes{0};
+  std::atomic<uint64_t> _callbacks{0};
+  std::atomic<uint64_t> _interval_sum{0};
+  std::atomic<uint64_t> _interval_max{0};
+  std::atomic<uint64_t> _late_callbacks{0};
+  std::atomic<uint32_t> _active_voices{0};
+  std::atomic<uint64_t> _dropped_voices{0};
+  std::atomic<bool> _streams_paused{false};
+
+  void start_voices();
+  void mix_voices(uint8_t* stream, const size_t samples);
+  void start_streams();
+  void release_stream(stream_slot_t& slot);
+  void mix_stream(stream_slot_t& slot, const size_t samples);
+
+public:
+  static constexpr size_t MAX_VOICES = 1024;
+
+  audio_engine_t(const int32_t frequency,
+                 const audio_format_t format,
+                 const int32_t channels,
+                 const size_t max_voices);
+
+  // Main thread
+  bool play(const sound_t& sound, const float gain);
+  void collect();
+  audio_stats_t stats() const;
+
+  void play_stream(const std::string& path,
+                   const uint32_t buffer_ms,
+                   const float fade_s,
+                   const bool loop);
+  void stop_streams(const float fade_s);
+  inline void pause_streams(const bool paused)
+  {
+    _streams_paused.store(paused, std::memory_order_relaxed);
+  }
+  // Only once the music hook is removed
+  void reset_streams();
+  music_stream_stats_t stream_stats() const;
+
+  // Audio thread
+  void postmix(uint8_t* stream, const int len);
+  void music(uint8_t* stream, const int len);
+};
@@ -0,0 +1,225 @@
+#include "collision_mask.hpp"
+#include <algorithm>
+#include <bit>
+#include "image.hpp"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/*******************************************************************************
+ * COLLISION MASK
+ ******************************************************************************/
+
+void collision_mask_t::allocate(const int32_t w, const int32_t h)
+{
+  if (w < 1 || h < 1) {
+    throw input_exception("Invalid collision mask size: " + STR(w) + "x" +
+                          STR(h));
+  }
+
+  _w = w;
+  _h = h;
+  _words = (w + 63) / 64;
+  _bits.assign(static_cast<size_t>(_words) * h, 0);
+  _bounds = {0, 0, 0, 0};
+}
+
+
+collision_mask_t::collision_mask_t(const int32_t w, const int32_t h)
+{
+  allocate(w, h);
+}
+
+
+collision_mask_t::collision_mask_t(const image_t& image,
+                                   const uint8_t alpha_threshold)
+    : collision_mask_t(image, {0, 0, image.w(), image.h()}, alpha_threshold)
+{}
+
+
+collision_mask_t::collision_mask_t(const image_t& image,
+                                   const rect_t& clip,
+                                   const uint8_t alpha_threshold)
+{
+  if (clip.x < 0 || clip.y < 0 || clip.x + clip.w > image.w() ||
+      clip.y + clip.h > image.h()) {
+    throw input_exception("Collision mask clip outside of the image");
+  }
+
+  allocate(clip.w, clip.h);
+
+  for (int32_t y = 0; y < _h; ++y) {
+    const pixel_t* src = image.row(clip.y + y) + clip.x;
+    uint64_t* dst = _bits.data() + static_cast<size_t>(y) * _words;
+    int32_t x = 0;
+
+#if defined(__SSE2__)
+    // The alpha bytes of 16 pixels packed together, solid where they are
+    // still above zero after subtracting the threshold
+    const __m128i alpha_mask = _mm_set1_epi32(0xFF);
+    const __m128i threshold = _mm_set1_epi8(static_cast<char>(alpha_threshold));
+    const __m128i zero = _mm_setzero_si128();
+
+    for (; x + 16 <= _w; x += 16) {
+      auto alpha = [&](const int32_t i) {
+        return _mm_and_si128(
+            _mm_loadu_si128((const __m128i*)(src + x + i)), alpha_mask);
+      };
+      const __m128i a = _mm_packus_epi16(_mm_packs_epi32(alpha(0), alpha(4)),
+                                         _mm_packs_epi32(alpha(8), alpha(12)));
+      const __m128i empty = _mm_cmpeq_epi8(_mm_subs_epu8(a, threshold), zero);
+      const uint64_t solid = ~_mm_movemask_epi8(empty) & 0xFFFF;
+      dst[x >> 6] |= solid << (x & 63);
+    }
+#endif
+
+    for (; x < _w; ++x) {
+      if (src[x].a > alpha_threshold) {
+        dst[x >> 6] |= uint64_t(1) << (x & 63);
+      }
+    }
+  }
+
+  update_bounds();
+}
+
+
+void collision_mask_t::update_bounds()
+{
+  int32_t x0 = _w, x1 = 0, y0 = _h, y1 = 0;
+
+  for (int32_t y = 0; y < _h; ++y) {
+    const uint64_t* r = row(y);
+    for (int32_t k = 0; k < _words; ++k) {
+      if (r[k] == 0) { continue; }
+
+      x0 = std::min(x0, k * 64 + std::countr_zero(r[k]));
+      x1 = std::max(x1, k * 64 + 64 - std::countl_zero(r[k]));
+      y0 = std::min(y0, y);
+      y1 = y + 1;
+    }
+  }
+
+  _bounds = x0 < x1 ? rect_t{x0, y0, x1 - x0, y1 - y0} : rect_t{0, 0, 0, 0};
+}
+
+
+size_t collision_mask_t::count() const
+{
+  size_t n = 0;
+  for (const uint64_t word : _bits) { n += std::popcount(word); }
+  return n;
+}
+
+
+void collision_mask_t::set(const int32_t x, const int32_t y, const bool solid)
+{
+  if (x < 0 || y < 0 || x >= _w || y >= _h) {
+    throw input_exception("Collision mask pixel out of range: " + STR(x) +
+                          ", " + STR(y));
+  }
+
+  uint64_t& word = _bits[static_cast<size_t>(y) * _words + (x >> 6)];
+  const uint64_t bit = uint64_t(1) << (x & 63);
+
+  if (solid) {
+    word |= bit;
+    if (empty()) {
+      _bounds = {x, y, 1, 1};
+    } else {
+      const int32_t x1 = std::max(_bounds.x + _bounds.w, x + 1);
+      const int32_t y1 = std::max(_bounds.y + _bounds.h, y + 1);
+      _bounds.x = std::min(_bounds.x, x);
+      _bounds.y = std::min(_bounds.y, y);
+      _bounds.w = x1 - _bounds.x;
+      _bounds.h = y1 - _bounds.y;
+    }
+  } else if (word & bit) {
+    word &= ~bit;
+    update_bounds();
+  }
+}
+
+
+static inline bool rects_overlap(const rect_t& a, const rect_t& b)
+{
+  return a.x < b.x + b.w && b.x < a.x + a.w && a.y < b.y + b.h &&
+         b.y < a.y + a.h;
+}
+
+
+bool collision_mask_t::collides(const collision_mask_t& a,
+                                const point_t& pos_a,
+                                const collision_mask_t& b,
+                                const point_t& pos_b)
+{
+  const rect_t ra = a.rect(pos_a);
+  const rect_t rb = b.rect(pos_b);
+  if (a.empty() || b.empty() || !rects_overlap(ra, rb)) { return false; }
+
+  // With a on the left, pixel x of b is pixel x + dx of a
+  if (pos_b.x < pos_a.x) { return collides(b, pos_b, a, pos_a); }
+  const int32_t dx = pos_b.x - pos_a.x;
+
+  // The shared columns in words of b, the shared rows in world pixels
+  const int32_t first = (std::max(ra.x, rb.x) - pos_b.x) >> 6;
+  const int32_t last = (std::min(ra.x + ra.w, rb.x + rb.w) - 1 - pos_b.x) >> 6;
+  const int32_t y0 = std::max(ra.y, rb.y);
+  const int32_t y1 = std::min(ra.y + ra.h, rb.y + rb.h);
+
+  // Bits outside of the shared columns are clear in one of the masks, as
+  // they are out of its bounds, so whole words are compared
+  const int32_t shift = dx & 63;
+
+  for (int32_t y = y0; y < y1; ++y) {
+    const uint64_t* row_a = a.row(y - pos_a.y);
+    const uint64_t* row_b = b.row(y - pos_b.y);
+
+    for (int32_t j = first; j <= last; ++j) {
+      const uint64_t word_b = row_b[j];
+      if (word_b == 0) { continue; }
+
+      // The 64 pixels of a under the word of b
+      const int32_t k = j + (dx >> 6);
+      uint64_t word_a = k < a._words ? row_a[k] >> shift : 0;
+      if (shift != 0 && k + 1 < a._words) {
+        word_a |= row_a[k + 1] << (64 - shift);
+      }
+
+      if (word_a & word_b) { return true; }
+    }
+  }
+
+  return false;
+}
+
+
+bool collision_mask_t::overlaps(const point_t& pos, const rect_t& r) const
+{
+  const rect_t solid = rect(pos);
+  if (empty() || !rects_overlap(solid, r)) { return false; }
+
+  // The shared area in mask coordinates
+  const int32_t x0 = std::max(solid.x, r.x) - pos.x;
+  const int32_t x1 = std::min(solid.x + solid.w, r.x + r.w) - pos.x;
+  const int32_t y0 = std::max(solid.y, r.y) - pos.y;
+  const int32_t y1 = std::min(solid.y + solid.h, r.y + r.h) - pos.y;
+
+  const int32_t first = x0 >> 6;
+  const int32_t last = (x1 - 1) >> 6;
+  const uint64_t first_mask = ~uint64_t(0) << (x0 & 63);
+  const uint64_t last_mask = ~uint64_t(0) >> (63 - ((x1 - 1) & 63));
+
+  for (int32_t y = y0; y < y1; ++y) {
+    const uint64_t* r_bits = row(y);
+    for (int32_t k = first; k <= last; ++k) {
+      uint64_t word = r_bits[k];
+      if (k == first) { word &= first_mask; }
+      if (k == last) { word &= last_mask; }
+      if (word) { return true; }
+    }
+  }
+
+  return false;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <vector>
+#include "pixello.hpp"
+
+class image_t;
+
+/*******************************************************************************
+ * COLLISION MASK
+ ******************************************************************************/
+// One bit per pixel, set where the sprite is solid. Bit x % 64 of word x / 64
+// in a row is pixel x, so the first pixel is the lowest bit. Positions are the
+// top left corner of the sprite in world pixels, as for draw_texture().
+class collision_mask_t
+{
+private:
+  int32_t _w = 0;
+  int32_t _h = 0;
+  int32_t _words = 0;  // Per row, the bits past _w are zero
+  std::vector<uint64_t> _bits;
+  rect_t _bounds = {0, 0, 0, 0};  // Of the set bits, empty when none
+
+  void allocate(const int32_t w, const int32_t h);
+  void update_bounds();
+
+  inline const uint64_t* row(const int32_t y) const
+  {
+    return _bits.data() + static_cast<size_t>(y) * _words;
+  }
+
+public:
+  collision_mask_t() = default;
+  collision_mask_t(const int32_t w, const int32_t h);
+  // Solid where the alpha is above the threshold, of the clip when given,
+  // for the sprites of a sheet
+  collision_mask_t(const image_t& image, const uint8_t alpha_threshold = 0);
+  collision_mask_t(const image_t& image,
+                   const rect_t& clip,
+                   const uint8_t alpha_threshold = 0);
+
+  inline int32_t w() const { return _w; }
+  inline int32_t h() const { return _h; }
+  // Smallest rect around the solid pixels, in mask coordinates
+  inline const rect_t& bounds() const { return _bounds; }
+  inline bool empty() const { return _bounds.w == 0; }
+  size_t count() const;
+
+  // Mask coordinates, false outside
+  inline bool test(const int32_t x, const int32_t y) const
+  {
+    if (x < 0 || y < 0 || x >= _w || y >= _h) { return false; }
+    return (row(y)[x >> 6] >> (x & 63)) & 1;
+  }
+  void set(const int32_t x, const int32_t y, const bool solid);
+
+  // Solid pixels of the mask at pos, for the broad phase
+  inline rect_t rect(const point_t& pos) const
+  {
+    return {pos.x + _bounds.x, pos.y + _bounds.y, _bounds.w, _bounds.h};
+  }
+
+  // World point query
+  inline bool contains(const point_t& pos, const point_t& p) const
+  {
+    return test(p.x - pos.x, p.y - pos.y);
+  }
+
+  // Solid pixels of both masks overlap. Rejects on the bounds first, then
+  // ANDs 64 pixels at a time over the rows they share.
+  static bool collides(const collision_mask_t& a,
+                       const point_t& pos_a,
+                       const collision_mask_t& b,
+                       const point_t& pos_b);
+
+  // Some solid pixel is inside the world rect
+  bool overlaps(const point_t& pos, const rect_t& r) const;
+};
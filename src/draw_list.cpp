@@ -0,0 +1,85 @@
+#include "draw_list.hpp"
+
+/*******************************************************************************
+ * DRAW LIST
+ ******************************************************************************/
+
+void draw_list_t::clear()
+{
+  _commands.clear();
+  _textures.clear();
+  _last_texture = NO_TEXTURE;
+}
+
+
+uint32_t draw_list_t::texture_index(const texture_t& t)
+{
+  if (!t.is_valid()) {
+    throw input_exception("Trying to record an invalid texture");
+  }
+
+  // Consecutive sprites usually share the texture
+  if (_last_texture != NO_TEXTURE &&
+      _textures[_last_texture]._ptr == t._ptr) {
+    return _last_texture;
+  }
+
+  for (size_t i = 0; i < _textures.size(); ++i) {
+    if (_textures[i]._ptr == t._ptr) {
+      _last_texture = static_cast<uint32_t>(i);
+      return _last_texture;
+    }
+  }
+
+  _textures.push_back(t);
+  _last_texture = static_cast<uint32_t>(_textures.size() - 1);
+
+  return _last_texture;
+}
+
+
+void draw_list_t::add_sprite(const texture_t& t,
+                             const float x,
+                             const float y,
+                             const float w,
+                             const float h,
+                             const rect_t& clip,
+                             const pixel_t& tint)
+{
+  _commands.push_back({x, y, w, h, clip, texture_index(t), tint});
+}
+
+
+void draw_list_t::add_sprite(const texture_t& t,
+                             const rect_t& dst,
+                             const rect_t& clip,
+                             const pixel_t& tint)
+{
+  add_sprite(t, static_cast<float>(dst.x), static_cast<float>(dst.y),
+             static_cast<float>(dst.w), static_cast<float>(dst.h), clip, tint);
+}
+
+
+void draw_list_t::add_sprite(const sub_texture_t& t,
+                             const rect_t& dst,
+                             const pixel_t& tint)
+{
+  add_sprite(t.page, dst, t.clip, tint);
+}
+
+
+void draw_list_t::add_rect(const float x,
+                           const float y,
+                           const float w,
+                           const float h,
+                           const pixel_t& color)
+{
+  _commands.push_back({x, y, w, h, {0, 0, 0, 0}, NO_TEXTURE, color});
+}
+
+
+void draw_list_t::add_rect(const rect_t& rect, const pixel_t& color)
+{
+  add_rect(static_cast<float>(rect.x), static_cast<float>(rect.y),
+           static_cast<float>(rect.w), static_cast<float>(rect.h), color);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vector>
+#include "pixello.hpp"
+
+/*******************************************************************************
+ * DRAW LIST
+ ******************************************************************************/
+// Draw commands recorded in world coordinates. The list is kept between frames
+// and submitted to one or more views with pixello::submit(), which transforms
+// and culls the commands and batches consecutive ones sharing a texture into a
+// single geometry call.
+class draw_list_t
+{
+public:
+  static constexpr uint32_t NO_TEXTURE = UINT32_MAX;
+
+  struct command_t
+  {
+    float x, y;  // World rect
+    float w, h;
+    rect_t clip;
+    uint32_t texture;
+    pixel_t color;
+  };
+
+private:
+  std::vector<command_t> _commands;
+  std::vector<texture_t> _textures;
+  uint32_t _last_texture = NO_TEXTURE;
+
+  uint32_t texture_index(const texture_t& t);
+
+public:
+  void clear();
+  inline void reserve(const size_t n) { _commands.reserve(n); }
+
+  void add_sprite(const texture_t& t,
+                  const float x,
+                  const float y,
+                  const float w,
+                  const float h,
+                  const rect_t& clip,
+                  const pixel_t& tint = 0xFFFFFFFF);
+  void add_sprite(const texture_t& t,
+                  const rect_t& dst,
+                  const rect_t& clip,
+                  const pixel_t& tint = 0xFFFFFFFF);
+  void add_sprite(const sub_texture_t& t,
+                  const rect_t& dst,
+                  const pixel_t& tint = 0xFFFFFFFF);
+
+  void add_rect(const float x,
+                const float y,
+                const float w,
+                const float h,
+                const pixel_t& color);
+  void add_rect(const rect_t& rect, const pixel_t& color);
+
+  inline size_t size() const { return _commands.size(); }
+  inline const std::vector<command_t>& commands() const { return _commands; }
+  inline const texture_t& texture(const uint32_t index) const
+  {
+    return _textures[index];
+  }
+};
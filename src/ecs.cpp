@@ -0,0 +1,207 @@
+#include "ecs.hpp"
+#include <algorithm>
+#include <atomic>
+#include "job_system.hpp"
+
+/*******************************************************************************
+ * COMPONENT POOLS
+ ******************************************************************************/
+
+void component_pool_base_t::align_to(const component_pool_base_t& other)
+{
+  uint32_t next = 0;
+
+  for (const entity_t e : other.entities()) {
+    const uint32_t pos = find(e);
+    if (pos == NONE) { continue; }
+
+    if (pos != next) {
+      const entity_t moved = _dense[next];
+      std::swap(_dense[pos], _dense[next]);
+      swap_data(pos, next);
+      _sparse[entity_index(e)] = next;
+      _sparse[entity_index(moved)] = pos;
+    }
+
+    ++next;
+  }
+}
+
+
+/*******************************************************************************
+ * REGISTRY
+ ******************************************************************************/
+
+uint32_t registry_t::next_type_id()
+{
+  static std::atomic<uint32_t> next{0};
+  return next.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+entity_t registry_t::create()
+{
+  uint32_t slot;
+
+  if (!_free_slots.empty()) {
+    slot = _free_slots.back();
+    _free_slots.pop_back();
+  } else {
+    if (_versions.size() > ENTITY_INDEX_MASK) {
+      throw runtime_exception("Too many entities");
+    }
+
+    slot = static_cast<uint32_t>(_versions.size());
+    _versions.push_back(0);
+    _alive.push_back(0);
+  }
+
+  _alive[slot] = 1;
+  ++_size;
+
+  return (static_cast<uint32_t>(_versions[slot]) << ENTITY_INDEX_BITS) | slot;
+}
+
+
+bool registry_t::valid(const entity_t e) const
+{
+  const uint32_t slot = entity_index(e);
+  return slot < _versions.size() && _alive[slot] &&
+         _versions[slot] == (e >> ENTITY_INDEX_BITS);
+}
+
+
+void registry_t::destroy(const entity_t e)
+{
+  if (!valid(e)) { return; }
+
+  for (auto& p : _pools) {
+    if (p) { p->remove(e); }
+  }
+
+  const uint32_t slot = entity_index(e);
+  ++_versions[slot];  // Wraps, ids are reused after 256 destroys
+  _alive[slot] = 0;
+  _free_slots.push_back(slot);
+  --_size;
+}
+
+
+void registry_t::clear()
+{
+  for (auto& p : _pools) {
+    if (p) { p->clear(); }
+  }
+
+  // Versions are kept, old ids stay invalid
+  _free_slots.clear();
+  for (uint32_t slot = static_cast<uint32_t>(_versions.size()); slot > 0;
+       --slot) {
+    if (_alive[slot - 1]) { ++_versions[slot - 1]; }
+    _alive[slot - 1] = 0;
+    _free_slots.push_back(slot - 1);
+  }
+
+  _size = 0;
+}
+
+
+/*******************************************************************************
+ * SYSTEMS
+ ******************************************************************************/
+
+void system_scheduler_t::add(const std::string& name, system_fn_t fn)
+{
+  _systems.push_back({name, std::move(fn), system_access_t(), true});
+  build_stages();
+}
+
+
+void system_scheduler_t::add(const std::string& name,
+                             system_fn_t fn,
+                             system_access_t access)
+{
+  _systems.push_back({name, std::move(fn), std::move(access), false});
+  build_stages();
+}
+
+
+bool system_scheduler_t::conflicts(const system_t& a, const system_t& b)
+{
+  if (a.exclusive || b.exclusive) { return true; }
+
+  auto uses = [](const system_access_t& s, const uint32_t id) {
+    return std::find(s.reads.begin(), s.reads.end(), id) != s.reads.end() ||
+           std::find(s.writes.begin(), s.writes.end(), id) != s.writes.end();
+  };
+
+  for (const uint32_t id : a.access.writes) {
+    if (uses(b.access, id)) { return true; }
+  }
+  for (const uint32_t id : b.access.writes) {
+    if (uses(a.access, id)) { return true; }
+  }
+
+  return false;
+}
+
+
+void system_scheduler_t::build_stages()
+{
+  // Greedy in order, a conflict with the current stage starts a new one so
+  // the declared order is kept between dependent systems
+  _stages.clear();
+
+  for (size_t i = 0; i < _systems.size(); ++i) {
+    bool fits = !_stages.empty();
+    if (fits) {
+      for (const size_t j : _stages.back()) {
+        if (conflicts(_systems[i], _systems[j])) {
+          fits = false;
+          break;
+        }
+      }
+    }
+
+    if (fits) {
+      _stages.back().push_back(i);
+    } else {
+      _stages.push_back({i});
+    }
+  }
+}
+
+
+void system_scheduler_t::run(registry_t& registry, const float dt)
+{
+  for (const auto& stage : _stages) {
+    if (_jobs == nullptr || stage.size() == 1) {
+      for (const size_t i : stage) { _systems[i].fn(registry, dt); }
+      continue;
+    }
+
+    // The first system runs on this thread, which then helps with the others
+    job_counter_t counter;
+    for (size_t k = 1; k < stage.size(); ++k) {
+      const system_t& s = _systems[stage[k]];
+      _jobs->run([&s, &registry, dt] { s.fn(registry, dt); }, &counter);
+    }
+
+    // The jobs hold the registry and the counter, they end before anything
+    // unwinds. A throw here wins over one from the jobs.
+    std::exception_ptr error;
+    try {
+      _systems[stage[0]].fn(registry, dt);
+    } catch (...) {
+      error = std::current_exception();
+    }
+
+    try {
+      _jobs->wait(counter);
+    } catch (...) {
+      if (!error) { error = std::current_exception(); }
+    }
+
+    if (error) { std::rethrow_exception(error); }
+  }
+}
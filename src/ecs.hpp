@@ -0,0 +1,351 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "pixello.hpp"
+
+class job_system_t;
+
+/*******************************************************************************
+ * ENTITIES
+ ******************************************************************************/
+// Low 24 bits are the slot, high 8 bits the version of the slot. A destroyed
+// entity id stays invalid until its slot is reused 256 times.
+using entity_t = uint32_t;
+constexpr entity_t INVALID_ENTITY = UINT32_MAX;
+constexpr uint32_t ENTITY_INDEX_BITS = 24;
+constexpr uint32_t ENTITY_INDEX_MASK = (1u << ENTITY_INDEX_BITS) - 1;
+
+inline uint32_t entity_index(const entity_t e) { return e & ENTITY_INDEX_MASK; }
+
+
+/*******************************************************************************
+ * COMPONENT POOLS
+ ******************************************************************************/
+// Sparse set: the sparse array maps an entity slot to a position in the
+// dense arrays, which stay packed so iteration is linear in memory
+class component_pool_base_t
+{
+protected:
+  static constexpr uint32_t NONE = UINT32_MAX;
+
+  std::vector<uint32_t> _sparse;
+  std::vector<entity_t> _dense;
+
+  // Position of e in the dense arrays, NONE if missing
+  inline uint32_t find(const entity_t e) const
+  {
+    const uint32_t i = entity_index(e);
+    if (i >= _sparse.size()) { return NONE; }
+
+    const uint32_t pos = _sparse[i];
+    return (pos != NONE && _dense[pos] == e) ? pos : NONE;
+  }
+
+  virtual void swap_data(const uint32_t a, const uint32_t b) = 0;
+
+public:
+  virtual ~component_pool_base_t() = default;
+  virtual void remove(const entity_t e) = 0;
+  virtual void clear() = 0;
+
+  inline bool contains(const entity_t e) const { return find(e) != NONE; }
+  inline size_t size() const { return _dense.size(); }
+  inline const std::vector<entity_t>& entities() const { return _dense; }
+
+  // Moves the entities also in other to the front, in the order of other.
+  // A view driven by other then walks this pool in order too.
+  void align_to(const component_pool_base_t& other);
+};
+
+
+template <typename T>
+class component_pool_t : public component_pool_base_t
+{
+private:
+  std::vector<T> _data;
+
+  void swap_data(const uint32_t a, const uint32_t b) override
+  {
+    std::swap(_data[a], _data[b]);
+  }
+
+public:
+  template <typename... Args>
+  T& emplace(const entity_t e, Args&&... args)
+  {
+    const uint32_t pos = find(e);
+    if (pos != NONE) {
+      _data[pos] = T{std::forward<Args>(args)...};
+      return _data[pos];
+    }
+
+    const uint32_t i = entity_index(e);
+    if (i >= _sparse.size()) { _sparse.resize(i + 1, NONE); }
+
+    _sparse[i] = static_cast<uint32_t>(_dense.size());
+    _dense.push_back(e);
+    _data.push_back(T{std::forward<Args>(args)...});
+    return _data.back();
+  }
+
+  // Swap with the last one, the order is not kept
+  void remove(const entity_t e) override
+  {
+    const uint32_t pos = find(e);
+    if (pos == NONE) { return; }
+
+    const uint32_t last = static_cast<uint32_t>(_dense.size() - 1);
+    if (pos != last) {
+      _dense[pos] = _dense[last];
+      _data[pos] = std::move(_data[last]);
+      _sparse[entity_index(_dense[pos])] = pos;
+    }
+
+    _sparse[entity_index(e)] = NONE;
+    _dense.pop_back();
+    _data.pop_back();
+  }
+
+  void clear() override
+  {
+    _sparse.clear();
+    _dense.clear();
+    _data.clear();
+  }
+
+  inline T& get(const entity_t e)
+  {
+    const uint32_t pos = find(e);
+    if (pos == NONE) {
+      throw runtime_exception("Entity without the component: " + STR(e));
+    }
+    return _data[pos];
+  }
+
+  // Without checks, for entities known to have the component
+  inline T& get_unchecked(const entity_t e)
+  {
+    return _data[_sparse[entity_index(e)]];
+  }
+
+  inline T* try_get(const entity_t e)
+  {
+    const uint32_t pos = find(e);
+    return pos == NONE ? nullptr : &_data[pos];
+  }
+
+  // Packed components, in the order of entities()
+  inline T* data() { return _data.data(); }
+};
+
+
+/*******************************************************************************
+ * REGISTRY
+ ******************************************************************************/
+class registry_t;
+
+// Entities that have all the Ts. The smallest pool drives the iteration, the
+// others are looked up. Components can be changed but not added or removed
+// while iterating.
+template <typename... Ts>
+class entity_view_t
+{
+private:
+  std::tuple<component_pool_t<Ts>*...> _pools;
+  const component_pool_base_t* _driver;
+
+  inline bool has_all(const entity_t e) const
+  {
+    return (std::get<component_pool_t<Ts>*>(_pools)->contains(e) && ...);
+  }
+
+public:
+  entity_view_t(component_pool_t<Ts>*... pools) : _pools(pools...)
+  {
+    const component_pool_base_t* all[] = {pools...};
+    _driver = all[0];
+    for (const auto* p : all) {
+      if (p->size() < _driver->size()) { _driver = p; }
+    }
+  }
+
+  // Upper bound of the entities visited, to split the work in ranges
+  inline size_t size_hint() const { return _driver->size(); }
+
+  // fn(entity, Ts&...) for the driving pool positions in [begin, end)
+  template <typename F>
+  void each(const size_t begin, const size_t end, F&& fn) const
+  {
+    const std::vector<entity_t>& entities = _driver->entities();
+    const size_t last = std::min(end, entities.size());
+
+    if constexpr (sizeof...(Ts) == 1) {
+      // Straight over the packed components
+      auto* pool = std::get<0>(_pools);
+      for (size_t i = begin; i < last; ++i) {
+        fn(entities[i], pool->data()[i]);
+      }
+    } else {
+      for (size_t i = begin; i < last; ++i) {
+        const entity_t e = entities[i];
+        if (!has_all(e)) { continue; }
+        fn(e, std::get<component_pool_t<Ts>*>(_pools)->get_unchecked(e)...);
+      }
+    }
+  }
+
+  template <typename F>
+  void each(F&& fn) const
+  {
+    each(0, size_hint(), std::forward<F>(fn));
+  }
+};
+
+
+class registry_t
+{
+private:
+  std::vector<uint8_t> _versions;  // Current version of every slot
+  std::vector<uint8_t> _alive;
+  std::vector<uint32_t> _free_slots;
+  size_t _size = 0;
+
+  std::vector<std::unique_ptr<component_pool_base_t>> _pools;
+
+  static uint32_t next_type_id();
+
+public:
+  // Process wide, the same for every registry
+  template <typename T>
+  static uint32_t type_id()
+  {
+    static const uint32_t id = next_type_id();
+    return id;
+  }
+
+  entity_t create();
+  void destroy(const entity_t e);  // Also removes all its components
+  bool valid(const entity_t e) const;
+  inline size_t size() const { return _size; }
+  void clear();
+
+  template <typename T>
+  component_pool_t<T>& pool()
+  {
+    const uint32_t id = type_id<T>();
+    if (id >= _pools.size()) { _pools.resize(id + 1); }
+    if (!_pools[id]) { _pools[id] = std::make_unique<component_pool_t<T>>(); }
+
+    return static_cast<component_pool_t<T>&>(*_pools[id]);
+  }
+
+  template <typename T, typename... Args>
+  T& add(const entity_t e, Args&&... args)
+  {
+    if (!valid(e)) {
+      throw runtime_exception("Invalid entity: " + STR(e));
+    }
+    return pool<T>().emplace(e, std::forward<Args>(args)...);
+  }
+
+  template <typename T>
+  void remove(const entity_t e)
+  {
+    pool<T>().remove(e);
+  }
+
+  template <typename T>
+  T& get(const entity_t e)
+  {
+    return pool<T>().get(e);
+  }
+
+  template <typename T>
+  bool has(const entity_t e)
+  {
+    return pool<T>().contains(e);
+  }
+
+  template <typename... Ts>
+  entity_view_t<Ts...> view()
+  {
+    return entity_view_t<Ts...>(&pool<Ts>()...);
+  }
+
+  // Orders the T components like the U ones, see align_to()
+  template <typename T, typename U>
+  void align()
+  {
+    pool<T>().align_to(pool<U>());
+  }
+};
+
+
+/*******************************************************************************
+ * SYSTEMS
+ ******************************************************************************/
+using system_fn_t = std::function<void(registry_t&, const float)>;
+
+// Components a system reads and writes, the scheduler runs systems in
+// parallel only when they do not write what the others use
+struct system_access_t
+{
+  std::vector<uint32_t> reads;
+  std::vector<uint32_t> writes;
+
+  template <typename... Ts>
+  system_access_t& read()
+  {
+    (reads.push_back(registry_t::type_id<Ts>()), ...);
+    return *this;
+  }
+
+  template <typename... Ts>
+  system_access_t& write()
+  {
+    (writes.push_back(registry_t::type_id<Ts>()), ...);
+    return *this;
+  }
+};
+
+// Runs the systems in the order they were added, usually once per on_update.
+// Consecutive systems that do not conflict form a stage, and with a job
+// system the systems of a stage run at the same time. Systems running in
+// parallel must not create or destroy entities, nor add or remove
+// components, and the pools they view must already exist (a pool is made on
+// first use).
+class system_scheduler_t
+{
+private:
+  struct system_t
+  {
+    std::string name;
+    system_fn_t fn;
+    system_access_t access;
+    bool exclusive;  // Without declared access, it runs alone
+  };
+
+  std::vector<system_t> _systems;
+  std::vector<std::vector<size_t>> _stages;
+  job_system_t* _jobs;
+
+  static bool conflicts(const system_t& a, const system_t& b);
+  void build_stages();
+
+public:
+  // Serial without a job system, usually pixello::jobs() is given
+  system_scheduler_t(job_system_t* jobs = nullptr) : _jobs(jobs) {}
+
+  void add(const std::string& name, system_fn_t fn);
+  void add(const std::string& name, system_fn_t fn, system_access_t access);
+
+  void run(registry_t& registry, const float dt);
+
+  inline void set_jobs(job_system_t* jobs) { _jobs = jobs; }
+  inline bool parallel() const { return _jobs != nullptr; }
+  inline size_t stages() const { return _stages.size(); }
+};
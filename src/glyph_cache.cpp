@@ -0,0 +1,206 @@
+#include "glyph_cache.hpp"
+#include <algorithm>
+#include "SDL_ttf.h"
+
+/*******************************************************************************
+ * GLYPH CACHE
+ ******************************************************************************/
+
+glyph_cache_t::glyph_cache_t(const pixello& p,
+                             const font_t& font,
+                             const pixel_t& color,
+                             const int32_t page_size)
+    : _pixello(p), _font(font), _color(color), _page_size(page_size)
+{
+  if (!_font._ptr || _font.pointer() == NULL) {
+    throw input_exception("The glyph cache needs a loaded font");
+  }
+
+  _line_h = TTF_FontHeight(_font.pointer());
+}
+
+
+const glyph_t& glyph_cache_t::get(const uint32_t codepoint)
+{
+  if (codepoint < 128) {
+    if (!_ascii_loaded[codepoint]) {
+      _ascii[codepoint] = load(codepoint);
+      _ascii_loaded[codepoint] = true;
+    }
+    return _ascii[codepoint];
+  }
+
+  auto it = _glyphs.find(codepoint);
+  if (it == _glyphs.end()) {
+    it = _glyphs.emplace(codepoint, load(codepoint)).first;
+  }
+
+  return it->second;
+}
+
+
+glyph_t glyph_cache_t::load(const uint32_t codepoint)
+{
+  TTF_Font* font_ptr = _font.pointer();
+  glyph_t glyph;
+
+  int minx, maxx, miny, maxy, advance;
+  if (TTF_GlyphMetrics32(font_ptr, codepoint, &minx, &maxx, &miny, &maxy,
+                         &advance) != 0) {
+    // Missing glyph
+    return codepoint == '?' ? glyph : get('?');
+  }
+
+  glyph.advance = advance;
+
+  const SDL_Color c = {_color.r, _color.g, _color.b, _color.a};
+  SDL_Surface* surface = TTF_RenderGlyph32_Blended(font_ptr, codepoint, c);
+  if (surface == NULL) { return glyph; }
+
+  SDL_Texture* tmp_ptr =
+      SDL_CreateTextureFromSurface(_pixello.renderer(), surface);
+
+  const int32_t w = surface->w;
+  const int32_t h = surface->h;
+  SDL_FreeSurface(surface);
+
+  if (!tmp_ptr) {
+    throw load_exceptions("Failed to create the glyph texture! SDL Error: " +
+                          std::string(SDL_GetError()));
+  }
+
+  const texture_t tmp = _pixello.wrap_texture(tmp_ptr);
+
+  // Copy the pixels as they are, the page is blended when drawn
+  SDL_SetTextureBlendMode(tmp_ptr, SDL_BLENDMODE_NONE);
+
+  if (w > _page_size || h > _page_size) {
+    throw load_exceptions("Glyph bigger than the glyph page");
+  }
+
+  rect_t r;
+  size_t page = 0;
+  while (page < _packers.size() && !_packers[page].pack(w, h, r)) { ++page; }
+
+  const texture_t previous = _pixello.render_target();
+
+  if (page == _packers.size()) {
+    _packers.emplace_back(_page_size, _page_size);
+    (void)_packers.back().pack(w, h, r);
+
+    _pages.push_back(_pixello.create_render_target(_page_size, _page_size));
+    _pixello.set_render_target(_pages.back());
+    _pixello.clear_render_target(0x00000000);
+  } else {
+    _pixello.set_render_target(_pages[page]);
+  }
+
+  _pixello.draw_texture(tmp, r);
+
+  if (previous.is_valid()) {
+    _pixello.set_render_target(previous);
+  } else {
+    _pixello.reset_render_target();
+  }
+
+  glyph.texture = _pixello.create_sub_texture(_pages[page], r);
+
+  return glyph;
+}
+
+
+/*******************************************************************************
+ * TEXT VIEW
+ ******************************************************************************/
+
+void text_view_t::scroll_to_cursor(glyph_cache_t& glyphs,
+                                   const text_buffer_t& text,
+                                   const int32_t width)
+{
+  const size_t cursor = text.cursor();
+
+  if (_scroll > text.size()) { _scroll = text.size(); }
+  if (cursor <= _scroll) {
+    _scroll = cursor;
+    return;
+  }
+
+  // Leave one pixel for the cursor
+  const int32_t max_w = width - 1;
+
+  // Stops as soon as the rect is full, it never walks the whole text
+  int32_t w = 0;
+  size_t pos = _scroll;
+  while (pos < cursor && w <= max_w) {
+    w += glyphs.get(text.decode(pos)).advance;
+  }
+
+  if (w <= max_w) { return; }
+
+  // The cursor is past the right edge, scroll back from it
+  w = 0;
+  pos = cursor;
+  while (pos > 0) {
+    const size_t prev = text.prev(pos);
+    size_t tmp = prev;
+    const int32_t advance = glyphs.get(text.decode(tmp)).advance;
+
+    if (w + advance > max_w) { break; }
+
+    w += advance;
+    pos = prev;
+  }
+
+  _scroll = pos;
+}
+
+
+void text_view_t::draw(const pixello& p,
+                       glyph_cache_t& glyphs,
+                       const text_buffer_t& text,
+                       const rect_t& rect,
+                       const bool show_cursor,
+                       const pixel_t& selection_color)
+{
+  if (rect.w <= 0 || rect.h <= 0) { return; }
+
+  scroll_to_cursor(glyphs, text, rect.w);
+
+  const int32_t line_h = glyphs.line_height();
+  const int32_t y = rect.y + (rect.h - line_h) / 2;
+  const int32_t right = rect.x + rect.w;
+  const size_t cursor = text.cursor();
+  const size_t sel_begin = text.selection_begin();
+  const size_t sel_end = text.selection_end();
+
+  int32_t x = rect.x;
+  int32_t cursor_x = -1;
+  size_t pos = _scroll;
+
+  while (pos < text.size() && x < right) {
+    const size_t start = pos;
+    const glyph_t& g = glyphs.get(text.decode(pos));
+    const int32_t visible_w = std::min(g.advance, right - x);
+
+    if (start == cursor) { cursor_x = x; }
+
+    if (start >= sel_begin && start < sel_end) {
+      p.draw_rect({x, y, visible_w, line_h}, selection_color);
+    }
+
+    if (g.texture.is_valid()) {
+      // The last glyph may be cut by the right edge
+      rect_t clip = g.texture.clip;
+      clip.w = std::min(clip.w, right - x);
+      p.draw_texture(g.texture.page, {x, y, clip.w, clip.h}, clip);
+    }
+
+    x += g.advance;
+  }
+
+  if (cursor == pos && x < right) { cursor_x = x; }
+
+  if (show_cursor && cursor_x >= 0) {
+    p.draw_rect({cursor_x, y, 1, line_h}, glyphs.color());
+  }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+#include "atlas.hpp"
+#include "pixello.hpp"
+#include "text_buffer.hpp"
+
+/*******************************************************************************
+ * GLYPH CACHE
+ ******************************************************************************/
+struct glyph_t
+{
+  sub_texture_t texture;  // Not valid for glyphs without pixels
+  int32_t advance = 0;
+};
+
+// Glyphs of one font and color, rasterized on first use into shared atlas
+// pages so that a line of text is drawn from a single texture.
+class glyph_cache_t
+{
+private:
+  const pixello& _pixello;
+  font_t _font;
+  pixel_t _color;
+  int32_t _page_size;
+  int32_t _line_h;
+
+  std::vector<skyline_packer_t> _packers;
+  std::vector<texture_t> _pages;
+
+  // ASCII is looked up without hashing
+  glyph_t _ascii[128];
+  bool _ascii_loaded[128] = {};
+  std::unordered_map<uint32_t, glyph_t> _glyphs;
+
+  glyph_t load(const uint32_t codepoint);
+
+public:
+  glyph_cache_t(const pixello& p,
+                const font_t& font,
+                const pixel_t& color,
+                const int32_t page_size = 512);
+
+  const glyph_t& get(const uint32_t codepoint);
+
+  inline int32_t line_height() const { return _line_h; }
+  inline const pixel_t& color() const { return _color; }
+};
+
+
+// Single line view over a text buffer. It keeps the cursor visible and only
+// walks the glyphs that fit in the rect, so the cost does not depend on the
+// length of the text.
+class text_view_t
+{
+private:
+  size_t _scroll = 0;  // First visible byte
+
+  void scroll_to_cursor(glyph_cache_t& glyphs,
+                        const text_buffer_t& text,
+                        const int32_t width);
+
+public:
+  void draw(const pixello& p,
+            glyph_cache_t& glyphs,
+            const text_buffer_t& text,
+            const rect_t& rect,
+            const bool show_cursor,
+            const pixel_t& selection_color = 0x3366FF88);
+
+  inline void reset() { _scroll = 0; }
+};
@@ -0,0 +1,548 @@
+#include "image.hpp"
+#include <SDL.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__)
+#define IMAGE_SSE2
+#include <emmintrin.h>
+#endif
+
+/*******************************************************************************
+ * CHANNEL MATH
+ ******************************************************************************/
+// The four channels of a pixel as 32 bit integers, for the running sums of
+// the blurs. In memory a pixel is a, b, g, r from the low byte.
+
+#if defined(IMAGE_SSE2)
+struct sse2_channels_t
+{
+  __m128i v;
+
+  static inline sse2_channels_t widen(const pixel_t& p)
+  {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bytes = _mm_cvtsi32_si128(static_cast<int>(p.n));
+    return {_mm_unpacklo_epi16(_mm_unpacklo_epi8(bytes, zero), zero)};
+  }
+
+  static inline sse2_channels_t add(const sse2_channels_t& a,
+                                    const sse2_channels_t& b)
+  {
+    return {_mm_add_epi32(a.v, b.v)};
+  }
+
+  static inline sse2_channels_t sub(const sse2_channels_t& a,
+                                    const sse2_channels_t& b)
+  {
+    return {_mm_sub_epi32(a.v, b.v)};
+  }
+
+  static inline sse2_channels_t mul(const sse2_channels_t& a, const int32_t k)
+  {
+    // The channels fit the low halves of the lanes, the high halves are zero
+    return {_mm_madd_epi16(a.v, _mm_set1_epi32(k))};
+  }
+
+  static inline pixel_t average(const sse2_channels_t& sum, const float inv)
+  {
+    const __m128 v = _mm_mul_ps(_mm_cvtepi32_ps(sum.v), _mm_set1_ps(inv));
+    __m128i c = _mm_cvtps_epi32(v);
+    c = _mm_packs_epi32(c, c);
+    c = _mm_packus_epi16(c, c);
+    return pixel_t(static_cast<uint32_t>(_mm_cvtsi128_si32(c)));
+  }
+
+  static inline sse2_channels_t zero() { return {_mm_setzero_si128()}; }
+};
+#endif
+
+struct scalar_channels_t
+{
+  int32_t v[4];
+
+  static inline scalar_channels_t widen(const pixel_t& p)
+  {
+    return {{p.a, p.b, p.g, p.r}};
+  }
+
+  static inline scalar_channels_t add(const scalar_channels_t& a,
+                                      const scalar_channels_t& b)
+  {
+    return {{a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2],
+             a.v[3] + b.v[3]}};
+  }
+
+  static inline scalar_channels_t sub(const scalar_channels_t& a,
+                                      const scalar_channels_t& b)
+  {
+    return {{a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2],
+             a.v[3] - b.v[3]}};
+  }
+
+  static inline scalar_channels_t mul(const scalar_channels_t& a,
+                                      const int32_t k)
+  {
+    return {{a.v[0] * k, a.v[1] * k, a.v[2] * k, a.v[3] * k}};
+  }
+
+  static inline pixel_t average(const scalar_channels_t& sum, const float inv)
+  {
+    auto c = [&](const int i) {
+      return static_cast<uint8_t>(std::clamp(
+          static_cast<int32_t>(std::lround(sum.v[i] * inv)), 0, 255));
+    };
+    return pixel_t(c(3), c(2), c(1), c(0));
+  }
+
+  static inline scalar_channels_t zero() { return {{0, 0, 0, 0}}; }
+};
+
+// x * f / 255 rounded, for bytes
+static inline uint8_t mul255(const uint32_t x, const uint32_t f)
+{
+  const uint32_t t = x * f + 128;
+  return static_cast<uint8_t>((t + (t >> 8)) >> 8);
+}
+
+#if defined(IMAGE_SSE2)
+// The same on 16 bit lanes
+static inline __m128i mul255_epi16(const __m128i x, const __m128i f)
+{
+  const __m128i t =
+      _mm_add_epi16(_mm_mullo_epi16(x, f), _mm_set1_epi16(128));
+  return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+#endif
+
+
+/*******************************************************************************
+ * IMAGE
+ ******************************************************************************/
+
+void image_t::allocate(const int32_t w, const int32_t h)
+{
+  if (w < 1 || h < 1) {
+    throw input_exception("Invalid image size: " + STR(w) + "x" + STR(h));
+  }
+
+  constexpr int32_t per_line = ALIGNMENT / sizeof(pixel_t);
+
+  _w = w;
+  _h = h;
+  _stride = (w + per_line - 1) / per_line * per_line;
+  _pixels.reset(static_cast<pixel_t*>(::operator new(
+      count() * sizeof(pixel_t), std::align_val_t(ALIGNMENT))));
+}
+
+
+image_t::image_t(const int32_t w, const int32_t h, const pixel_t& fill)
+{
+  allocate(w, h);
+  std::fill(data(), data() + count(), fill);
+}
+
+
+image_t::image_t(const image_t& other)
+{
+  *this = other;
+}
+
+
+image_t& image_t::operator=(const image_t& other)
+{
+  if (this == &other) { return *this; }
+
+  if (!other.is_valid()) {
+    _pixels.reset();
+    _w = _h = _stride = 0;
+    return *this;
+  }
+
+  allocate(other._w, other._h);
+  std::memcpy(data(), other.data(), count() * sizeof(pixel_t));
+  return *this;
+}
+
+
+image_t image_t::from_surface(SDL_Surface* surface)
+{
+  // Packed 0xRRGGBBAA, the layout of pixel_t
+  SDL_Surface* rgba =
+      SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGBA8888, 0);
+  if (rgba == NULL) {
+    throw load_exceptions("Failed to convert the image! SDL Error: " +
+                          std::string(SDL_GetError()));
+  }
+
+  image_t image(rgba->w, rgba->h);
+
+  SDL_LockSurface(rgba);
+  for (int32_t y = 0; y < image._h; ++y) {
+    std::memcpy(image.row(y), (const uint8_t*)rgba->pixels + y * rgba->pitch,
+                image._w * sizeof(pixel_t));
+  }
+  SDL_UnlockSurface(rgba);
+  SDL_FreeSurface(rgba);
+
+  return image;
+}
+
+
+void image_t::premultiply()
+{
+  pixel_t* p = data();
+  const size_t n = count();
+  size_t i = 0;
+
+#if defined(IMAGE_SSE2)
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i alpha_mask = _mm_set1_epi32(0xFF);
+
+  // Four pixels, two per half. The alpha of each pixel is spread over its
+  // lanes, the alpha byte itself is put back at the end.
+  for (; simd && i < n; i += 4) {
+    const __m128i v = _mm_load_si128((const __m128i*)(p + i));
+    const __m128i lo = _mm_unpacklo_epi8(v, zero);
+    const __m128i hi = _mm_unpackhi_epi8(v, zero);
+    const __m128i a_lo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, 0), 0);
+    const __m128i a_hi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, 0), 0);
+
+    const __m128i r = _mm_packus_epi16(mul255_epi16(lo, a_lo),
+                                       mul255_epi16(hi, a_hi));
+    _mm_store_si128((__m128i*)(p + i),
+                    _mm_or_si128(_mm_andnot_si128(alpha_mask, r),
+                                 _mm_and_si128(alpha_mask, v)));
+  }
+#endif
+
+  for (; i < n; ++i) {
+    pixel_t& c = p[i];
+    c.r = mul255(c.r, c.a);
+    c.g = mul255(c.g, c.a);
+    c.b = mul255(c.b, c.a);
+  }
+}
+
+
+void image_t::tint(const pixel_t& color)
+{
+  pixel_t* p = data();
+  const size_t n = count();
+  size_t i = 0;
+
+#if defined(IMAGE_SSE2)
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i f = _mm_unpacklo_epi8(
+      _mm_set1_epi32(static_cast<int>(color.n)), zero);
+
+  for (; simd && i < n; i += 4) {
+    const __m128i v = _mm_load_si128((const __m128i*)(p + i));
+    const __m128i lo = mul255_epi16(_mm_unpacklo_epi8(v, zero), f);
+    const __m128i hi = mul255_epi16(_mm_unpackhi_epi8(v, zero), f);
+    _mm_store_si128((__m128i*)(p + i), _mm_packus_epi16(lo, hi));
+  }
+#endif
+
+  for (; i < n; ++i) {
+    pixel_t& c = p[i];
+    c = pixel_t(mul255(c.r, color.r), mul255(c.g, color.g),
+                mul255(c.b, color.b), mul255(c.a, color.a));
+  }
+}
+
+
+void image_t::grayscale()
+{
+  // Rec. 601 luma in 8 bit fixed point: 77 r + 150 g + 29 b
+  pixel_t* p = data();
+  const size_t n = count();
+  size_t i = 0;
+
+#if defined(IMAGE_SSE2)
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i weights = _mm_setr_epi16(0, 29, 150, 77, 0, 29, 150, 77);
+  const __m128i alpha_mask = _mm_set1_epi32(0xFF);
+
+  for (; simd && i < n; i += 4) {
+    const __m128i v = _mm_load_si128((const __m128i*)(p + i));
+
+    // Per pixel pairs a*0 + b*29 and g*150 + r*77, then summed
+    __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(v, zero), weights);
+    __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(v, zero), weights);
+    lo = _mm_add_epi32(lo, _mm_shuffle_epi32(lo, _MM_SHUFFLE(2, 3, 0, 1)));
+    hi = _mm_add_epi32(hi, _mm_shuffle_epi32(hi, _MM_SHUFFLE(2, 3, 0, 1)));
+    const __m128i sums = _mm_castps_si128(_mm_shuffle_ps(
+        _mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(2, 0, 2, 0)));
+
+    const __m128i y = _mm_srli_epi32(_mm_add_epi32(sums, _mm_set1_epi32(128)),
+                                     8);
+    const __m128i gray =
+        _mm_or_si128(_mm_or_si128(_mm_slli_epi32(y, 24), _mm_slli_epi32(y, 16)),
+                     _mm_slli_epi32(y, 8));
+    _mm_store_si128((__m128i*)(p + i),
+                    _mm_or_si128(gray, _mm_and_si128(alpha_mask, v)));
+  }
+#endif
+
+  for (; i < n; ++i) {
+    pixel_t& c = p[i];
+    const uint8_t y = static_cast<uint8_t>((77 * c.r + 150 * c.g + 29 * c.b +
+                                            128) >> 8);
+    c = pixel_t(y, y, y, c.a);
+  }
+}
+
+
+// Separable running sums, the cost does not depend on the radius. Edges
+// repeat the border pixels.
+template <typename C>
+static void box_blur_with(image_t& image, const int32_t r)
+{
+  const int32_t w = image.w();
+  const int32_t h = image.h();
+  const float inv = 1.0f / (2 * r + 1);
+  image_t tmp(w, h);
+
+  for (int32_t y = 0; y < h; ++y) {
+    const pixel_t* src = image.row(y);
+    pixel_t* dst = tmp.row(y);
+    auto px = [&](const int32_t x) {
+      return C::widen(src[std::clamp(x, 0, w - 1)]);
+    };
+
+    C acc = C::mul(C::widen(src[0]), r + 1);
+    for (int32_t x = 1; x <= r; ++x) { acc = C::add(acc, px(x)); }
+
+    for (int32_t x = 0; x < w; ++x) {
+      dst[x] = C::average(acc, inv);
+      acc = C::add(acc, px(x + r + 1));
+      acc = C::sub(acc, px(x - r));
+    }
+  }
+
+  // Vertical, one accumulator per column so the rows are read in order
+  std::vector<C> acc(w, C::zero());
+  auto src_row = [&](const int32_t y) {
+    return tmp.row(std::clamp(y, 0, h - 1));
+  };
+
+  for (int32_t k = -r; k <= r; ++k) {
+    const pixel_t* s = src_row(k);
+    for (int32_t x = 0; x < w; ++x) {
+      acc[x] = C::add(acc[x], C::widen(s[x]));
+    }
+  }
+
+  for (int32_t y = 0; y < h; ++y) {
+    pixel_t* dst = image.row(y);
+    const pixel_t* in = src_row(y + r + 1);
+    const pixel_t* out = src_row(y - r);
+
+    for (int32_t x = 0; x < w; ++x) {
+      dst[x] = C::average(acc[x], inv);
+      acc[x] = C::sub(C::add(acc[x], C::widen(in[x])), C::widen(out[x]));
+    }
+  }
+}
+
+
+void image_t::box_blur(const int32_t radius)
+{
+  if (radius < 1 || !is_valid()) { return; }
+
+#if defined(IMAGE_SSE2)
+  if (simd) {
+    box_blur_with<sse2_channels_t>(*this, radius);
+    return;
+  }
+#endif
+
+  box_blur_with<scalar_channels_t>(*this, radius);
+}
+
+
+void image_t::gaussian_blur(const float sigma)
+{
+  if (sigma <= 0.0f) { return; }
+
+  // Three box blurs with the radii that match the variance (W. Jarosz, Fast
+  // image convolutions)
+  const float ideal = std::sqrt(12.0f * sigma * sigma / 3.0f + 1.0f);
+  int32_t lower = static_cast<int32_t>(std::floor(ideal));
+  if (lower % 2 == 0) { --lower; }
+  const int32_t upper = lower + 2;
+
+  const float m_ideal = (12.0f * sigma * sigma - 3.0f * lower * lower -
+                         12.0f * lower - 9.0f) /
+                        (-4.0f * lower - 4.0f);
+  const int32_t m = static_cast<int32_t>(std::round(m_ideal));
+
+  for (int32_t i = 0; i < 3; ++i) {
+    const int32_t size = i < m ? lower : upper;
+    box_blur((size - 1) / 2);
+  }
+}
+
+
+void image_t::alpha_bleed(const int32_t passes)
+{
+  if (!is_valid()) { return; }
+
+  // Pixels with a color to give, the opaque ones at first
+  std::vector<uint8_t> known(static_cast<size_t>(_w) * _h);
+  for (int32_t y = 0; y < _h; ++y) {
+    for (int32_t x = 0; x < _w; ++x) {
+      known[y * _w + x] = at(x, y).a > 0;
+    }
+  }
+
+  std::vector<uint8_t> next = known;
+
+  for (int32_t pass = 0; pass < passes; ++pass) {
+    bool changed = false;
+
+    for (int32_t y = 0; y < _h; ++y) {
+      for (int32_t x = 0; x < _w; ++x) {
+        if (known[y * _w + x]) { continue; }
+
+        uint32_t r = 0, g = 0, b = 0, n = 0;
+        for (int32_t dy = -1; dy <= 1; ++dy) {
+          for (int32_t dx = -1; dx <= 1; ++dx) {
+            const int32_t nx = x + dx;
+            const int32_t ny = y + dy;
+            if (nx < 0 || ny < 0 || nx >= _w || ny >= _h ||
+                !known[ny * _w + nx]) {
+              continue;
+            }
+
+            const pixel_t& c = at(nx, ny);
+            r += c.r;
+            g += c.g;
+            b += c.b;
+            ++n;
+          }
+        }
+
+        if (n == 0) { continue; }
+
+        // Stays transparent
+        at(x, y) = pixel_t(r / n, g / n, b / n, 0);
+        next[y * _w + x] = 1;
+        changed = true;
+      }
+    }
+
+    if (!changed) { break; }
+    known = next;
+  }
+}
+
+
+image_t image_t::scaled(const int32_t w,
+                        const int32_t h,
+                        const scale_filter_t filter) const
+{
+  image_t out(w, h);
+  if (!is_valid()) { return out; }
+
+  const float sx = static_cast<float>(_w) / w;
+  const float sy = static_cast<float>(_h) / h;
+
+  if (filter == scale_filter_t::NEAREST) {
+    std::vector<int32_t> xs(w);
+    for (int32_t x = 0; x < w; ++x) {
+      xs[x] = std::min(static_cast<int32_t>((x + 0.5f) * sx), _w - 1);
+    }
+
+    for (int32_t y = 0; y < h; ++y) {
+      const pixel_t* src =
+          row(std::min(static_cast<int32_t>((y + 0.5f) * sy), _h - 1));
+      pixel_t* dst = out.row(y);
+      for (int32_t x = 0; x < w; ++x) { dst[x] = src[xs[x]]; }
+    }
+
+    return out;
+  }
+
+  // Bilinear on pixel centers, weights in 8 bit fixed point
+  struct tap_t
+  {
+    int32_t i0, i1;
+    uint16_t f;  // Weight of i1, 0 to 256
+  };
+
+  auto taps = [](const int32_t n, const int32_t src_n, const float scale) {
+    std::vector<tap_t> result(n);
+    for (int32_t i = 0; i < n; ++i) {
+      const float s = std::clamp((i + 0.5f) * scale - 0.5f, 0.0f,
+                                 static_cast<float>(src_n - 1));
+      const int32_t i0 = static_cast<int32_t>(s);
+      result[i] = {i0, std::min(i0 + 1, src_n - 1),
+                   static_cast<uint16_t>((s - i0) * 256.0f + 0.5f)};
+    }
+    return result;
+  };
+
+  const std::vector<tap_t> xt = taps(w, _w, sx);
+  const std::vector<tap_t> yt = taps(h, _h, sy);
+
+  for (int32_t y = 0; y < h; ++y) {
+    const pixel_t* top = row(yt[y].i0);
+    const pixel_t* bottom = row(yt[y].i1);
+    const uint16_t fy = yt[y].f;
+    pixel_t* dst = out.row(y);
+
+#if defined(IMAGE_SSE2)
+    if (simd) {
+      const __m128i zero = _mm_setzero_si128();
+      const __m128i wy = _mm_set1_epi16(static_cast<short>(fy));
+      const __m128i wy_inv = _mm_set1_epi16(static_cast<short>(256 - fy));
+
+      for (int32_t x = 0; x < w; ++x) {
+        const tap_t& t = xt[x];
+
+        // Left and right in the two halves: p0 * (256 - f) + p1 * f
+        const __m128i wx =
+            _mm_unpacklo_epi64(_mm_set1_epi16(static_cast<short>(256 - t.f)),
+                               _mm_set1_epi16(static_cast<short>(t.f)));
+        auto lerp_x = [&](const pixel_t* r) {
+          const __m128i p0 = _mm_cvtsi32_si128(static_cast<int>(r[t.i0].n));
+          const __m128i p1 = _mm_cvtsi32_si128(static_cast<int>(r[t.i1].n));
+          const __m128i p =
+              _mm_unpacklo_epi8(_mm_unpacklo_epi32(p0, p1), zero);
+          const __m128i m = _mm_mullo_epi16(p, wx);
+          return _mm_srli_epi16(_mm_add_epi16(m, _mm_srli_si128(m, 8)), 8);
+        };
+
+        const __m128i v = _mm_srli_epi16(
+            _mm_add_epi16(_mm_mullo_epi16(lerp_x(top), wy_inv),
+                          _mm_mullo_epi16(lerp_x(bottom), wy)),
+            8);
+        dst[x] = pixel_t(static_cast<uint32_t>(
+            _mm_cvtsi128_si32(_mm_packus_epi16(v, v))));
+      }
+      continue;
+    }
+#endif
+
+    for (int32_t x = 0; x < w; ++x) {
+      const tap_t& t = xt[x];
+      auto lerp = [](const uint32_t a, const uint32_t b, const uint32_t f) {
+        return (a * (256 - f) + b * f) >> 8;
+      };
+      auto channel = [&](const int shift) {
+        const uint32_t a = lerp((top[t.i0].n >> shift) & 0xFF,
+                                (top[t.i1].n >> shift) & 0xFF, t.f);
+        const uint32_t b = lerp((bottom[t.i0].n >> shift) & 0xFF,
+                                (bottom[t.i1].n >> shift) & 0xFF, t.f);
+        return lerp(a, b, fy) << shift;
+      };
+      dst[x] = pixel_t(channel(0) | channel(8) | channel(16) | channel(24));
+    }
+  }
+
+  return out;
+}
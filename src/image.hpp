@@ -0,0 +1,93 @@
+#pragma once
+
+#include <memory>
+#include <new>
+#include "pixello.hpp"
+
+struct SDL_Surface;
+
+enum class scale_filter_t
+{
+  NEAREST,
+  BILINEAR
+};
+
+/*******************************************************************************
+ * IMAGE
+ ******************************************************************************/
+// CPU side image, rows of pixel_t (0xRRGGBBAA) starting on 64 byte boundaries.
+// The padding at the end of the rows belongs to the image, so the per pixel
+// kernels run over whole rows without tails. Load it with
+// pixello::load_image_data(), process it and pixello::upload() it.
+class image_t
+{
+public:
+  static constexpr size_t ALIGNMENT = 64;
+
+private:
+  struct aligned_delete_t
+  {
+    void operator()(pixel_t* p) const
+    {
+      ::operator delete(p, std::align_val_t(ALIGNMENT));
+    }
+  };
+
+  int32_t _w = 0;
+  int32_t _h = 0;
+  int32_t _stride = 0;  // In pixels
+  std::unique_ptr<pixel_t, aligned_delete_t> _pixels;
+
+  void allocate(const int32_t w, const int32_t h);
+  inline size_t count() const { return static_cast<size_t>(_stride) * _h; }
+
+public:
+  image_t() = default;
+  image_t(const int32_t w, const int32_t h, const pixel_t& fill = 0x00000000);
+
+  image_t(const image_t& other);
+  image_t& operator=(const image_t& other);
+  image_t(image_t&&) = default;
+  image_t& operator=(image_t&&) = default;
+
+  // Copy of a surface of any format
+  static image_t from_surface(SDL_Surface* surface);
+
+  inline int32_t w() const { return _w; }
+  inline int32_t h() const { return _h; }
+  inline int32_t stride() const { return _stride; }
+  inline bool is_valid() const { return _pixels != nullptr; }
+
+  inline pixel_t* data() { return _pixels.get(); }
+  inline const pixel_t* data() const { return _pixels.get(); }
+  inline pixel_t* row(const int32_t y) { return data() + y * _stride; }
+  inline const pixel_t* row(const int32_t y) const
+  {
+    return data() + y * _stride;
+  }
+  inline pixel_t& at(const int32_t x, const int32_t y) { return row(y)[x]; }
+  inline const pixel_t& at(const int32_t x, const int32_t y) const
+  {
+    return row(y)[x];
+  }
+
+  // The SSE2 kernels where the build has them. Off for the plain loops,
+  // which give the same pixels, the blurs within one step of rounding.
+  inline static bool simd = true;
+
+  // Kernels, in place
+  void premultiply();  // Upload with premultiplied set afterwards
+  void tint(const pixel_t& color);  // Multiplies the channels, alpha too
+  void grayscale();                 // Alpha kept
+  void box_blur(const int32_t radius);
+  void gaussian_blur(const float sigma);  // Three box blurs
+
+  // Fills the color of the transparent pixels next to opaque ones with the
+  // average of their neighbors, one ring per pass. Keeps dark or white halos
+  // out of filtered and scaled sprites.
+  void alpha_bleed(const int32_t passes = 1);
+
+  image_t scaled(const int32_t w,
+                 const int32_t h,
+                 const scale_filter_t filter) const;
+};
@@ -0,0 +1,178 @@
+#include "input_record.hpp"
+#include <cstring>
+#include <vector>
+
+static constexpr char MAGIC[4] = {'P', 'X', 'I', 'N'};
+static constexpr uint32_t VERSION = 1;
+
+// Frame flags
+static constexpr uint16_t MOUSE_MOVED = 1 << 0;
+static constexpr uint16_t LEFT_PRESSED = 1 << 1;
+static constexpr uint16_t CENTRAL_PRESSED = 1 << 2;
+static constexpr uint16_t RIGHT_PRESSED = 1 << 3;
+static constexpr uint16_t HAS_TEXT = 1 << 4;
+static constexpr uint16_t BUTTONS_SHIFT = 5;  // Three bits per button
+
+/*******************************************************************************
+ * ENCODING
+ ******************************************************************************/
+// Little endian regardless of the host
+
+static void put(std::vector<uint8_t>& out, const uint64_t v, const int bytes)
+{
+  for (int i = 0; i < bytes; ++i) {
+    out.push_back(static_cast<uint8_t>(v >> (i * 8)));
+  }
+}
+
+
+static bool get(std::ifstream& in, uint64_t& v, const int bytes)
+{
+  uint8_t buffer[8];
+  if (!in.read((char*)buffer, bytes)) { return false; }
+
+  v = 0;
+  for (int i = 0; i < bytes; ++i) {
+    v |= static_cast<uint64_t>(buffer[i]) << (i * 8);
+  }
+
+  return true;
+}
+
+
+static uint16_t button_bits(const button_key_t& b)
+{
+  return (b.state == button_key_t::DOWN ? 1 : 0) | (b.click ? 2 : 0) |
+         (b.double_click ? 4 : 0);
+}
+
+
+static void set_button(button_key_t& b, const uint16_t bits)
+{
+  b.state = (bits & 1) ? button_key_t::DOWN : button_key_t::UP;
+  b.click = bits & 2;
+  b.double_click = bits & 4;
+}
+
+
+/*******************************************************************************
+ * RECORDER
+ ******************************************************************************/
+
+input_recorder_t::input_recorder_t(const std::string& path)
+    : _file(path, std::ios::binary | std::ios::trunc)
+{
+  if (!_file) {
+    throw load_exceptions("Failed to create the input log: " + path);
+  }
+
+  std::vector<uint8_t> header(MAGIC, MAGIC + 4);
+  put(header, VERSION, 4);
+  _file.write((const char*)header.data(), header.size());
+}
+
+
+void input_recorder_t::write(const input_frame_t& frame)
+{
+  const mouse_t& m = frame.mouse;
+
+  uint16_t flags = 0;
+  if (m.did_mouse_moved) { flags |= MOUSE_MOVED; }
+  if (m.left_button_pressed) { flags |= LEFT_PRESSED; }
+  if (m.central_button_pressed) { flags |= CENTRAL_PRESSED; }
+  if (m.right_button_pressed) { flags |= RIGHT_PRESSED; }
+  if (frame.has_text) { flags |= HAS_TEXT; }
+  flags |= button_bits(m.left_button) << BUTTONS_SHIFT;
+  flags |= button_bits(m.central_button) << (BUTTONS_SHIFT + 3);
+  flags |= button_bits(m.right_button) << (BUTTONS_SHIFT + 6);
+
+  std::vector<uint8_t> out;
+  out.reserve(40);
+  put(out, frame.dt_us, 4);
+  put(out, flags, 2);
+  put(out, static_cast<uint32_t>(m.x), 4);
+  put(out, static_cast<uint32_t>(m.y), 4);
+  put(out, static_cast<uint32_t>(m.relative_x), 4);
+  put(out, static_cast<uint32_t>(m.relative_y), 4);
+  put(out, frame.keys, 8);
+
+  if (frame.has_text) {
+    put(out, frame.text.size(), 4);
+    out.insert(out.end(), frame.text.begin(), frame.text.end());
+    put(out, frame.cursor, 4);
+    put(out, frame.anchor, 4);
+  }
+
+  _file.write((const char*)out.data(), out.size());
+}
+
+
+/*******************************************************************************
+ * PLAYER
+ ******************************************************************************/
+
+input_player_t::input_player_t(const std::string& path)
+    : _file(path, std::ios::binary)
+{
+  if (!_file) {
+    throw load_exceptions("Failed to open the input log: " + path);
+  }
+
+  char magic[4];
+  uint64_t version;
+  if (!_file.read(magic, 4) || std::memcmp(magic, MAGIC, 4) != 0 ||
+      !get(_file, version, 4)) {
+    throw load_exceptions("Not an input log: " + path);
+  }
+
+  if (version != VERSION) {
+    throw load_exceptions("Unsupported input log version: " + STR(version));
+  }
+}
+
+
+bool input_player_t::read(input_frame_t& frame)
+{
+  uint64_t dt, flags, x, y, rx, ry, keys;
+
+  // A record cut by a crash ends the replay
+  if (!get(_file, dt, 4) || !get(_file, flags, 2) || !get(_file, x, 4) ||
+      !get(_file, y, 4) || !get(_file, rx, 4) || !get(_file, ry, 4) ||
+      !get(_file, keys, 8)) {
+    return false;
+  }
+
+  frame.dt_us = static_cast<uint32_t>(dt);
+  frame.keys = keys;
+
+  mouse_t& m = frame.mouse;
+  m.x = static_cast<int32_t>(x);
+  m.y = static_cast<int32_t>(y);
+  m.relative_x = static_cast<int32_t>(rx);
+  m.relative_y = static_cast<int32_t>(ry);
+  m.did_mouse_moved = flags & MOUSE_MOVED;
+  m.left_button_pressed = flags & LEFT_PRESSED;
+  m.central_button_pressed = flags & CENTRAL_PRESSED;
+  m.right_button_pressed = flags & RIGHT_PRESSED;
+  set_button(m.left_button, (flags >> BUTTONS_SHIFT) & 7);
+  set_button(m.central_button, (flags >> (BUTTONS_SHIFT + 3)) & 7);
+  set_button(m.right_button, (flags >> (BUTTONS_SHIFT + 6)) & 7);
+
+  frame.has_text = flags & HAS_TEXT;
+  if (frame.has_text) {
+    uint64_t size, cursor, anchor;
+    if (!get(_file, size, 4)) { return false; }
+
+    frame.text.resize(size);
+    if (!_file.read(frame.text.data(), size) || !get(_file, cursor, 4) ||
+        !get(_file, anchor, 4)) {
+      return false;
+    }
+
+    frame.cursor = static_cast<uint32_t>(cursor);
+    frame.anchor = static_cast<uint32_t>(anchor);
+  }
+
+  ++_frames;
+  return true;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <fstream>
+#include <string>
+#include "pixello.hpp"
+
+/*******************************************************************************
+ * INPUT RECORDING
+ ******************************************************************************/
+// The input run() hands to on_update for one frame
+struct input_frame_t
+{
+  uint32_t dt_us = 0;
+  mouse_t mouse;
+  uint64_t keys = 0;  // One bit per keycap_t
+
+  // Only when the text input changed in the frame
+  bool has_text = false;
+  std::string text;
+  uint32_t cursor = 0;
+  uint32_t anchor = 0;
+};
+
+// Binary log, a small header and then one variable sized record per frame
+class input_recorder_t
+{
+private:
+  std::ofstream _file;
+
+public:
+  input_recorder_t(const std::string& path);
+  void write(const input_frame_t& frame);
+};
+
+class input_player_t
+{
+private:
+  std::ifstream _file;
+  uint64_t _frames = 0;
+
+public:
+  input_player_t(const std::string& path);
+
+  // False at the end of the log
+  bool read(input_frame_t& frame);
+  inline uint64_t frames() const { return _frames; }
+};
@@ -0,0 +1,418 @@
+#include "job_system.hpp"
+
+// Empty tries before a waiting thread sleeps
+static constexpr int32_t WAIT_SPINS = 64;
+
+// Deque of the current thread, -1 outside of the job system
+static thread_local const job_system_t* t_owner = nullptr;
+static thread_local int32_t t_index = -1;
+
+/*******************************************************************************
+ * DEQUE
+ ******************************************************************************/
+
+job_system_t::deque_t::deque_t()
+    : _buffer(std::make_unique<std::atomic<job_t*>[]>(CAPACITY))
+{}
+
+
+bool job_system_t::deque_t::push(job_t* job)
+{
+  const int64_t b = _bottom.load(std::memory_order_relaxed);
+  const int64_t t = _top.load(std::memory_order_acquire);
+  if (b - t >= CAPACITY) { return false; }
+
+  _buffer[b & (CAPACITY - 1)].store(job, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  _bottom.store(b + 1, std::memory_order_relaxed);
+
+  return true;
+}
+
+
+job_t* job_system_t::deque_t::pop()
+{
+  const int64_t b = _bottom.load(std::memory_order_relaxed) - 1;
+  _bottom.store(b, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  int64_t t = _top.load(std::memory_order_relaxed);
+
+  if (t > b) {
+    // Empty
+    _bottom.store(b + 1, std::memory_order_relaxed);
+    return nullptr;
+  }
+
+  job_t* job = _buffer[b & (CAPACITY - 1)].load(std::memory_order_relaxed);
+  if (t == b) {
+    // The last one, a thief may be taking it too
+    if (!_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                      std::memory_order_relaxed)) {
+      job = nullptr;
+    }
+    _bottom.store(b + 1, std::memory_order_relaxed);
+  }
+
+  return job;
+}
+
+
+job_t* job_system_t::deque_t::steal()
+{
+  int64_t t = _top.load(std::memory_order_acquire);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  const int64_t b = _bottom.load(std::memory_order_acquire);
+
+  if (t >= b) { return nullptr; }
+
+  job_t* job = _buffer[t & (CAPACITY - 1)].load(std::memory_order_relaxed);
+  if (!_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                    std::memory_order_relaxed)) {
+    return nullptr;
+  }
+
+  return job;
+}
+
+
+/*******************************************************************************
+ * JOB SYSTEM
+ ******************************************************************************/
+
+job_system_t::job_system_t(const int32_t workers)
+    : _main_thread(std::this_thread::get_id())
+{
+  int32_t count = workers;
+  if (count < 0) {
+    count = static_cast<int32_t>(std::thread::hardware_concurrency()) - 1;
+    count = std::max(count, 0);
+  }
+
+  for (int32_t i = 0; i <= count; ++i) {
+    _deques.push_back(std::make_unique<deque_t>());
+  }
+
+  t_owner = this;
+  t_index = 0;
+
+  for (int32_t i = 1; i <= count; ++i) {
+    _threads.emplace_back(&job_system_t::worker_loop, this, i);
+  }
+}
+
+
+job_system_t::~job_system_t()
+{
+  {
+    std::lock_guard<std::mutex> lock(_sleep_mutex);
+    _stop = true;
+  }
+  _wake.notify_all();
+
+  for (auto& t : _threads) { t.join(); }
+
+  // Jobs never run are dropped
+  for (auto& d : _deques) {
+    while (job_t* job = d->pop()) { delete job; }
+  }
+  for (job_t* job : _injected) { delete job; }
+  for (job_t* job : _main_jobs) { delete job; }
+
+  if (t_owner == this) {
+    t_owner = nullptr;
+    t_index = -1;
+  }
+}
+
+
+void job_system_t::run(job_fn_t fn, job_counter_t* counter)
+{
+  if (counter) { counter->_count.fetch_add(1); }
+  submit(new job_t{std::move(fn), counter, false});
+}
+
+
+void job_system_t::run_on_main(job_fn_t fn, job_counter_t* counter)
+{
+  if (counter) { counter->_count.fetch_add(1); }
+  submit(new job_t{std::move(fn), counter, true});
+}
+
+
+void job_system_t::run_after(job_counter_t& dependency,
+                             job_fn_t fn,
+                             job_counter_t* counter)
+{
+  if (counter) { counter->_count.fetch_add(1); }
+  job_t* job = new job_t{std::move(fn), counter, false};
+
+  {
+    // finish() drains the continuations under the same lock
+    std::lock_guard<std::mutex> lock(dependency._mutex);
+    if (!dependency.done()) {
+      dependency._continuations.push_back(job);
+      return;
+    }
+  }
+
+  submit(job);
+}
+
+
+void job_system_t::submit(job_t* job)
+{
+  if (job->main_only) {
+    {
+      std::lock_guard<std::mutex> lock(_main_mutex);
+      _main_jobs.push_back(job);
+    }
+
+    // The main thread may be sleeping in wait()
+    wake_waiters();
+    return;
+  }
+
+  enqueue(job);
+}
+
+
+void job_system_t::enqueue(job_t* job)
+{
+  const bool own_deque = t_owner == this && t_index >= 0;
+  if (!own_deque || !_deques[t_index]->push(job)) {
+    std::lock_guard<std::mutex> lock(_injected_mutex);
+    _injected.push_back(job);
+  }
+
+  // A sleeping worker either sees the job or is woken. It counts itself
+  // before checking _queued, in the same order as here.
+  _queued.fetch_add(1);
+  if (_sleeping.load() > 0) {
+    std::lock_guard<std::mutex> lock(_sleep_mutex);
+    _wake.notify_one();
+  }
+
+  wake_waiters();
+}
+
+
+void job_system_t::wake_waiters()
+{
+  // Same order as in enqueue(), the waiter counts itself before checking
+  if (_waiting.load() > 0) {
+    std::lock_guard<std::mutex> lock(_sleep_mutex);
+    _wake_waiters.notify_all();
+  }
+}
+
+
+job_t* job_system_t::take(const int32_t index)
+{
+  // Threads outside of the job system have no deque and only steal
+  job_t* job = index >= 0 ? _deques[index]->pop() : nullptr;
+
+  if (job == nullptr) {
+    // Starting from the next deque to spread the thieves
+    const int32_t n = static_cast<int32_t>(_deques.size());
+    const int32_t first = std::max(index, 0);
+    for (int32_t k = index >= 0 ? 1 : 0; k < n && job == nullptr; ++k) {
+      job = _deques[(first + k) % n]->steal();
+    }
+  }
+
+  if (job == nullptr) {
+    std::lock_guard<std::mutex> lock(_injected_mutex);
+    if (!_injected.empty()) {
+      job = _injected.front();
+      _injected.pop_front();
+    }
+  }
+
+  if (job) { _queued.fetch_sub(1); }
+  return job;
+}
+
+
+void job_system_t::execute(job_t* job)
+{
+  job_counter_t* counter = job->counter;
+
+  try {
+    job->fn();
+  } catch (...) {
+    // Kept for whoever waits, the first one wins
+    if (counter) {
+      std::lock_guard<std::mutex> lock(counter->_mutex);
+      if (!counter->_error) { counter->_error = std::current_exception(); }
+    } else {
+      std::lock_guard<std::mutex> lock(_error_mutex);
+      if (!_error) { _error = std::current_exception(); }
+    }
+  }
+
+  delete job;
+
+  if (counter) { finish(counter); }
+}
+
+
+void job_system_t::finish(job_counter_t* counter)
+{
+  // Only the last decrement takes the lock. wait() takes it too before
+  // returning, so the counter is not touched after it can be destroyed.
+  std::vector<job_t*> ready;
+
+  while (true) {
+    int32_t count = counter->_count.load();
+    if (count != 1) {
+      if (counter->_count.compare_exchange_weak(count, count - 1)) { return; }
+      continue;
+    }
+
+    std::lock_guard<std::mutex> lock(counter->_mutex);
+    if (counter->_count.compare_exchange_strong(count, 0)) {
+      ready.swap(counter->_continuations);
+      break;
+    }
+    // A job was added meanwhile
+  }
+
+  for (job_t* job : ready) { submit(job); }
+  wake_waiters();
+}
+
+
+void job_system_t::worker_loop(const int32_t index)
+{
+  t_owner = this;
+  t_index = index;
+
+  while (true) {
+    if (job_t* job = take(index)) {
+      execute(job);
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(_sleep_mutex);
+    _sleeping.fetch_add(1);
+    _wake.wait(lock, [this] { return _stop || _queued.load() > 0; });
+    _sleeping.fetch_sub(1);
+
+    if (_stop) { break; }
+  }
+}
+
+
+void job_system_t::wait(job_counter_t& counter)
+{
+  const bool main = is_main_thread();
+  const int32_t index = t_owner == this ? t_index : -1;
+
+  int32_t spins = 0;
+
+  while (!counter.done()) {
+    if (main) { run_main_queue(); }
+
+    if (job_t* job = take(index)) {
+      execute(job);
+      spins = 0;
+      continue;
+    }
+
+    if (++spins < WAIT_SPINS) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    // Sleeps until the counter is done or there is a job to help with
+    std::unique_lock<std::mutex> lock(_sleep_mutex);
+    _waiting.fetch_add(1);
+    _wake_waiters.wait(lock, [&] {
+      if (counter.done() || _queued.load() > 0) { return true; }
+      if (!main) { return false; }
+
+      std::lock_guard<std::mutex> main_lock(_main_mutex);
+      return !_main_jobs.empty();
+    });
+    _waiting.fetch_sub(1);
+  }
+
+  // The last finish() may still hold the lock
+  std::exception_ptr error;
+  {
+    std::lock_guard<std::mutex> lock(counter._mutex);
+    error = std::move(counter._error);
+    counter._error = nullptr;
+  }
+
+  if (error) { std::rethrow_exception(error); }
+}
+
+
+void job_system_t::parallel_for(const size_t begin,
+                                const size_t end,
+                                const size_t grain,
+                                const std::function<void(size_t, size_t)>& fn)
+{
+  if (begin >= end) { return; }
+
+  const size_t step = std::max<size_t>(grain, 1);
+  job_counter_t counter;
+
+  // The first range runs here, after the others were started
+  for (size_t b = begin + step; b < end; b += step) {
+    const size_t e = std::min(b + step, end);
+    run([&fn, b, e] { fn(b, e); }, &counter);
+  }
+
+  // The jobs hold fn and the counter, they end before anything unwinds
+  std::exception_ptr error;
+  try {
+    fn(begin, std::min(begin + step, end));
+  } catch (...) {
+    error = std::current_exception();
+  }
+
+  try {
+    wait(counter);
+  } catch (...) {
+    if (!error) { error = std::current_exception(); }
+  }
+
+  if (error) { std::rethrow_exception(error); }
+}
+
+
+void job_system_t::run_main_jobs()
+{
+  if (!is_main_thread()) {
+    throw runtime_exception("Main thread jobs run on another thread");
+  }
+
+  run_main_queue();
+
+  std::exception_ptr error;
+  {
+    std::lock_guard<std::mutex> lock(_error_mutex);
+    error = std::move(_error);
+    _error = nullptr;
+  }
+
+  if (error) { std::rethrow_exception(error); }
+}
+
+
+void job_system_t::run_main_queue()
+{
+  while (true) {
+    job_t* job = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(_main_mutex);
+      if (_main_jobs.empty()) { return; }
+      job = _main_jobs.front();
+      _main_jobs.pop_front();
+    }
+
+    execute(job);
+  }
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "pixello.hpp"
+
+class job_system_t;
+class job_counter_t;
+
+// A started job, owned by the job system until it ran
+struct job_t
+{
+  std::function<void()> fn;
+  job_counter_t* counter;
+  bool main_only;
+};
+
+/*******************************************************************************
+ * JOB COUNTER
+ ******************************************************************************/
+// Jobs still to finish. Waiting on it, or starting jobs after it, is how jobs
+// depend on each other. It can be reused or destroyed after a wait().
+class job_counter_t
+{
+private:
+  std::atomic<int32_t> _count{0};
+  std::mutex _mutex;
+  std::vector<job_t*> _continuations;  // Started when the count hits 0
+  std::exception_ptr _error;  // First job that threw, for wait()
+
+  friend class job_system_t;
+
+public:
+  job_counter_t() = default;
+  job_counter_t(const job_counter_t&) = delete;
+  job_counter_t& operator=(const job_counter_t&) = delete;
+
+  inline bool done() const { return _count.load() == 0; }
+  inline int32_t pending() const { return _count.load(); }
+};
+
+
+/*******************************************************************************
+ * JOB SYSTEM
+ ******************************************************************************/
+// Worker threads, each with a work stealing deque. Jobs started by a worker
+// go to its own deque and idle workers steal from the others. The thread that
+// made the job system is the main thread, it has a deque too and runs jobs
+// while it waits. Jobs that must run on the main thread, like renderer calls,
+// wait in their own queue until the main thread waits or calls
+// run_main_jobs(). A job that throws still finishes its counter, wait()
+// rethrows the first exception. The ones of jobs without a counter are
+// rethrown by run_main_jobs().
+class job_system_t
+{
+public:
+  using job_fn_t = std::function<void()>;
+
+private:
+  // Chase-Lev deque of fixed size. The owner pushes and pops at the bottom,
+  // the thieves take from the top.
+  class deque_t
+  {
+  private:
+    static constexpr int64_t CAPACITY = 4096;
+
+    alignas(64) std::atomic<int64_t> _top{0};
+    alignas(64) std::atomic<int64_t> _bottom{0};
+    std::unique_ptr<std::atomic<job_t*>[]> _buffer;
+
+  public:
+    deque_t();
+    bool push(job_t* job);  // False when full
+    job_t* pop();
+    job_t* steal();
+  };
+
+  std::vector<std::unique_ptr<deque_t>> _deques;  // 0 is the main thread
+  std::vector<std::thread> _threads;
+  std::thread::id _main_thread;
+
+  // From threads that are not part of the job system
+  std::mutex _injected_mutex;
+  std::deque<job_t*> _injected;
+
+  std::mutex _main_mutex;
+  std::deque<job_t*> _main_jobs;
+
+  // Sleeping workers, and threads in wait() with nothing to help with
+  std::mutex _sleep_mutex;
+  std::condition_variable _wake;
+  std::condition_variable _wake_waiters;
+  std::atomic<int64_t> _queued{0};  // Started, not main only, not taken yet
+  std::atomic<int32_t> _sleeping{0};
+  std::atomic<int32_t> _waiting{0};
+  std::atomic<bool> _stop{false};
+
+  // Thrown by jobs without a counter
+  std::mutex _error_mutex;
+  std::exception_ptr _error;
+
+  void submit(job_t* job);
+  void enqueue(job_t* job);
+  job_t* take(const int32_t index);
+  void execute(job_t* job);
+  void finish(job_counter_t* counter);
+  void wake_waiters();
+  void worker_loop(const int32_t index);
+  void run_main_queue();
+
+public:
+  // Negative picks one worker less than the hardware threads. With 0 workers
+  // the jobs run on the main thread while it waits.
+  job_system_t(const int32_t workers = -1);
+  ~job_system_t();
+
+  job_system_t(const job_system_t&) = delete;
+  job_system_t& operator=(const job_system_t&) = delete;
+
+  // The counter, if any, is increased now and decreased when the job ends
+  void run(job_fn_t fn, job_counter_t* counter = nullptr);
+  void run_on_main(job_fn_t fn, job_counter_t* counter = nullptr);
+
+  // Starts fn once dependency is done
+  void run_after(job_counter_t& dependency,
+                 job_fn_t fn,
+                 job_counter_t* counter = nullptr);
+
+  // Runs other jobs until the counter is done, sleeping when there are none.
+  // Rethrows the exception of a job of the counter.
+  void wait(job_counter_t& counter);
+
+  // fn(begin, end) on ranges of at most grain items, returns when all ran
+  // even if one throws
+  void parallel_for(const size_t begin,
+                    const size_t end,
+                    const size_t grain,
+                    const std::function<void(size_t, size_t)>& fn);
+
+  // Main thread only, runs the main only jobs queued so far. Rethrows the
+  // exception of a job started without a counter.
+  void run_main_jobs();
+
+  inline uint32_t workers() const
+  {
+    return static_cast<uint32_t>(_threads.size());
+  }
+  inline bool is_main_thread() const
+  {
+    return std::this_thread::get_id() == _main_thread;
+  }
+};
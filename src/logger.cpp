@@ -0,0 +1,202 @@
+#include "logger.hpp"
+#include <chrono>
+
+static constexpr size_t BATCH_RESERVE = 64 * 1024;
+static constexpr auto IDLE_WAIT = std::chrono::milliseconds(5);
+
+static const char* LEVEL_NAMES[] = {"TRACE", "DEBUG", "INFO",
+                                    "WARN",  "ERROR", "OFF"};
+
+static uint64_t now_us()
+{
+  using namespace std::chrono;
+  return duration_cast<microseconds>(steady_clock::now().time_since_epoch())
+      .count();
+}
+
+
+/*******************************************************************************
+ * LOGGER
+ ******************************************************************************/
+
+logger_t::logger_t(const log_level_t level,
+                   const std::string& path,
+                   const bool to_stdout,
+                   const size_t ring_size)
+    : _level(level), _to_stdout(to_stdout), _start_us(now_us())
+{
+  size_t size = 2;
+  while (size < ring_size) { size <<= 1; }
+
+  _slots = std::make_unique<slot_t[]>(size);
+  _mask = size - 1;
+  for (size_t i = 0; i < size; ++i) {
+    _slots[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  if (!path.empty()) {
+    _file = std::fopen(path.c_str(), "w");
+    if (_file == NULL) {
+      throw init_exception("Failed to create the log file: " + path);
+    }
+  }
+
+  _thread = std::thread(&logger_t::drain_loop, this);
+}
+
+
+logger_t::~logger_t()
+{
+  _stop.store(true, std::memory_order_release);
+  _thread.join();
+
+  if (_file) { std::fclose(_file); }
+}
+
+
+logger_t::slot_t* logger_t::begin_record(const log_level_t level)
+{
+  if (level < _level.load(std::memory_order_relaxed)) { return NULL; }
+
+  // Bounded MPMC queue, a slot is free when its sequence equals the position
+  size_t pos = _enqueue.load(std::memory_order_relaxed);
+  while (true) {
+    slot_t& slot = _slots[pos & _mask];
+    const size_t seq = slot.sequence.load(std::memory_order_acquire);
+    const intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+
+    if (diff == 0) {
+      if (_enqueue.compare_exchange_weak(pos, pos + 1,
+                                         std::memory_order_relaxed)) {
+        record_t& r = slot.record;
+        r.time_us = now_us() - _start_us;
+        r.level = level;
+        r.length = 0;
+        return &slot;
+      }
+    } else if (diff < 0) {
+      // Full, the drain thread is behind
+      _dropped.fetch_add(1, std::memory_order_relaxed);
+      return NULL;
+    } else {
+      pos = _enqueue.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+
+void logger_t::commit_record(slot_t* slot)
+{
+  // Claimed at pos, readable by the drain thread at pos + 1
+  const size_t pos = slot->sequence.load(std::memory_order_relaxed);
+  slot->sequence.store(pos + 1, std::memory_order_release);
+}
+
+
+void logger_t::write_raw(const log_level_t level, std::string_view msg)
+{
+  do {
+    // Cut between UTF-8 characters
+    size_t n = std::min(msg.size(), MAX_MESSAGE);
+    while (n < msg.size() && n > 0 && (msg[n] & 0xC0) == 0x80) { --n; }
+    if (n == 0) { n = std::min(msg.size(), MAX_MESSAGE); }
+
+    slot_t* slot = begin_record(level);
+    if (slot == NULL) { return; }
+
+    writer_t w = {slot->record};
+    w.put(msg.substr(0, n));
+    commit_record(slot);
+
+    msg.remove_prefix(n);
+  } while (!msg.empty());
+}
+
+
+std::string_view logger_t::put_literal(writer_t& w, std::string_view s)
+{
+  size_t start = 0;
+  for (size_t i = 0; i + 1 < s.size(); ++i) {
+    if (s[i] == '{' && s[i + 1] == '}') {
+      w.put(s.substr(start, i - start));
+      return s.substr(i + 2);
+    }
+
+    if ((s[i] == '{' || s[i] == '}') && s[i + 1] == s[i]) {
+      w.put(s.substr(start, i + 1 - start));
+      start = i + 2;
+      ++i;
+    }
+  }
+
+  w.put(s.substr(start));
+  return std::string_view();
+}
+
+
+size_t logger_t::drain(std::string& batch)
+{
+  size_t count = 0;
+
+  while (true) {
+    slot_t& slot = _slots[_dequeue & _mask];
+    const size_t seq = slot.sequence.load(std::memory_order_acquire);
+    if (seq != _dequeue + 1) { break; }
+
+    const record_t& r = slot.record;
+    char prefix[48];
+    const int n = std::snprintf(
+        prefix, sizeof(prefix), "[%llu.%06llu][%s] ",
+        (unsigned long long)(r.time_us / 1000000),
+        (unsigned long long)(r.time_us % 1000000),
+        LEVEL_NAMES[static_cast<size_t>(r.level)]);
+    batch.append(prefix, n);
+    batch.append(r.text, r.length);
+    batch.push_back('\n');
+
+    // Hands the slot back to the producers, one lap later
+    slot.sequence.store(_dequeue + _mask + 1, std::memory_order_release);
+    ++_dequeue;
+    ++count;
+  }
+
+  return count;
+}
+
+
+void logger_t::drain_loop()
+{
+  std::string batch;
+  batch.reserve(BATCH_RESERVE);
+  uint64_t reported_drops = 0;
+
+  while (true) {
+    // Read before draining, so nothing logged before the stop is lost
+    const bool stop = _stop.load(std::memory_order_acquire);
+
+    batch.clear();
+    const size_t count = drain(batch);
+
+    const uint64_t drops = _dropped.load(std::memory_order_relaxed);
+    if (drops != reported_drops) {
+      batch += "[logger] " + std::to_string(drops - reported_drops) +
+               " messages dropped, the ring was full\n";
+      reported_drops = drops;
+    }
+
+    if (!batch.empty()) {
+      if (_to_stdout) {
+        std::fwrite(batch.data(), 1, batch.size(), stdout);
+        std::fflush(stdout);
+      }
+      if (_file) {
+        std::fwrite(batch.data(), 1, batch.size(), _file);
+        std::fflush(_file);
+      }
+      _written.fetch_add(count, std::memory_order_relaxed);
+    }
+
+    if (stop) { break; }
+    if (count == 0) { std::this_thread::sleep_for(IDLE_WAIT); }
+  }
+}
@@ -0,0 +1,262 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include "pixello.hpp"
+
+/*******************************************************************************
+ * FORMAT STRING
+ ******************************************************************************/
+// Checked at compile time, every {} takes one argument and {{ }} are literal
+// braces
+template <typename... Args>
+struct format_string_t
+{
+  std::string_view str;
+
+  template <typename S>
+  consteval format_string_t(const S& s) : str(s)
+  {
+    size_t placeholders = 0;
+
+    for (size_t i = 0; i < str.size(); ++i) {
+      if (str[i] == '{') {
+        if (i + 1 < str.size() && str[i + 1] == '{') {
+          ++i;
+        } else if (i + 1 < str.size() && str[i + 1] == '}') {
+          ++placeholders;
+          ++i;
+        } else {
+          throw "Only {} placeholders are supported";
+        }
+      } else if (str[i] == '}') {
+        if (i + 1 < str.size() && str[i + 1] == '}') {
+          ++i;
+        } else {
+          throw "Unmatched } in the format string";
+        }
+      }
+    }
+
+    if (placeholders != sizeof...(Args)) {
+      throw "The format string does not match the number of arguments";
+    }
+  }
+};
+
+
+/*******************************************************************************
+ * LOGGER
+ ******************************************************************************/
+// Producers format straight into a slot of a bounded lock free ring, any
+// thread can log. A background thread drains the ring in batches to stdout
+// and/or a file. When the ring is full the message is dropped and counted,
+// logging never blocks.
+class logger_t
+{
+public:
+  static constexpr size_t MAX_MESSAGE = 240;
+
+  struct record_t
+  {
+    uint64_t time_us;
+    log_level_t level;
+    uint16_t length;
+    char text[MAX_MESSAGE];
+  };
+
+private:
+  struct slot_t
+  {
+    std::atomic<size_t> sequence;
+    record_t record;
+  };
+
+  // Appends to a record. A message that does not fit ends with "…".
+  struct writer_t
+  {
+    record_t& r;
+    bool full = false;
+
+    void put(std::string_view s)
+    {
+      if (full) { return; }
+
+      const size_t n = std::min(s.size(), MAX_MESSAGE - r.length);
+      std::memcpy(r.text + r.length, s.data(), n);
+      r.length += static_cast<uint16_t>(n);
+
+      if (n < s.size()) { mark_truncated(); }
+    }
+
+    void mark_truncated()
+    {
+      // Not in the middle of a UTF-8 character
+      size_t end = MAX_MESSAGE - 3;
+      while (end > 0 && (r.text[end] & 0xC0) == 0x80) { --end; }
+
+      std::memcpy(r.text + end, "\xE2\x80\xA6", 3);
+      r.length = static_cast<uint16_t>(end + 3);
+      full = true;
+    }
+
+    template <typename T>
+    void arg(const T& v)
+    {
+      if constexpr (std::is_same_v<T, bool>) {
+        put(v ? "true" : "false");
+      } else if constexpr (std::is_same_v<T, char>) {
+        put(std::string_view(&v, 1));
+      } else if constexpr (std::is_arithmetic_v<T>) {
+        char buffer[32];
+        const auto result = std::to_chars(buffer, buffer + sizeof(buffer), v);
+        put(std::string_view(buffer, result.ptr - buffer));
+      } else if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+        put(std::string_view(v));
+      } else if constexpr (std::is_pointer_v<T>) {
+        char buffer[32];
+        const auto result =
+            std::to_chars(buffer, buffer + sizeof(buffer),
+                          reinterpret_cast<uintptr_t>(v), 16);
+        put("0x");
+        put(std::string_view(buffer, result.ptr - buffer));
+      } else {
+        static_assert(sizeof(T) == 0, "Type not supported by the logger");
+      }
+    }
+  };
+
+  std::unique_ptr<slot_t[]> _slots;
+  size_t _mask;
+  alignas(64) std::atomic<size_t> _enqueue{0};
+  alignas(64) size_t _dequeue = 0;  // Drain thread only
+
+  std::atomic<log_level_t> _level;
+  std::atomic<uint64_t> _written{0};
+  std::atomic<uint64_t> _dropped{0};
+  std::atomic<bool> _stop{false};
+
+  FILE* _file = NULL;
+  bool _to_stdout;
+  std::thread _thread;
+  uint64_t _start_us;
+
+  slot_t* begin_record(const log_level_t level);
+  void commit_record(slot_t* slot);
+  size_t drain(std::string& batch);
+  void drain_loop();
+
+  template <typename Arg, typename... Rest>
+  static void format(writer_t& w,
+                     std::string_view fmt,
+                     const Arg& arg,
+                     const Rest&... rest)
+  {
+    fmt = put_literal(w, fmt);
+    w.arg(arg);
+
+    if constexpr (sizeof...(Rest) > 0) {
+      format(w, fmt, rest...);
+    } else {
+      put_literal(w, fmt);
+    }
+  }
+
+  // Writes up to the next {} with the doubled braces made single, returns
+  // what follows the placeholder
+  static std::string_view put_literal(writer_t& w, std::string_view s);
+
+public:
+  // ring_size is rounded up to a power of two
+  logger_t(const log_level_t level,
+           const std::string& path,
+           const bool to_stdout,
+           const size_t ring_size);
+  ~logger_t();
+
+  logger_t(const logger_t&) = delete;
+  logger_t& operator=(const logger_t&) = delete;
+
+  template <typename... Args>
+  void write(const log_level_t level,
+             format_string_t<std::type_identity_t<Args>...> fmt,
+             const Args&... args)
+  {
+    slot_t* slot = begin_record(level);
+    if (slot == NULL) { return; }
+
+    writer_t w = {slot->record};
+    if constexpr (sizeof...(Args) > 0) {
+      format(w, fmt.str, args...);
+    } else {
+      put_literal(w, fmt.str);
+    }
+
+    commit_record(slot);
+  }
+
+  // Already built messages, like the ones given to pixello::log(). The long
+  // ones are split over several records.
+  void write_raw(const log_level_t level, std::string_view msg);
+
+  template <typename... Args>
+  void trace(format_string_t<std::type_identity_t<Args>...> fmt,
+             const Args&... args)
+  {
+    write(log_level_t::TRACE, fmt, args...);
+  }
+
+  template <typename... Args>
+  void debug(format_string_t<std::type_identity_t<Args>...> fmt,
+             const Args&... args)
+  {
+    write(log_level_t::DEBUG, fmt, args...);
+  }
+
+  template <typename... Args>
+  void info(format_string_t<std::type_identity_t<Args>...> fmt,
+            const Args&... args)
+  {
+    write(log_level_t::INFO, fmt, args...);
+  }
+
+  template <typename... Args>
+  void warn(format_string_t<std::type_identity_t<Args>...> fmt,
+            const Args&... args)
+  {
+    write(log_level_t::WARN, fmt, args...);
+  }
+
+  template <typename... Args>
+  void error(format_string_t<std::type_identity_t<Args>...> fmt,
+             const Args&... args)
+  {
+    write(log_level_t::ERROR, fmt, args...);
+  }
+
+  inline void set_level(const log_level_t level)
+  {
+    _level.store(level, std::memory_order_relaxed);
+  }
+  inline log_level_t level() const
+  {
+    return _level.load(std::memory_order_relaxed);
+  }
+
+  inline uint64_t written() const
+  {
+    return _written.load(std::memory_order_relaxed);
+  }
+  inline uint64_t dropped() const
+  {
+    return _dropped.load(std::memory_order_relaxed);
+  }
+};
@@ -0,0 +1,232 @@
+#include "music_stream.hpp"
+#include <SDL.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+/*******************************************************************************
+ * WAV HEADER
+ ******************************************************************************/
+
+static uint32_t read_u32(const uint8_t* p)
+{
+  return p[0] | (p[1] << 8) | (p[2] << 16) |
+         (static_cast<uint32_t>(p[3]) << 24);
+}
+
+
+static uint16_t read_u16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+
+
+static size_t ring_bytes(const int32_t frequency,
+                         const audio_format_t format,
+                         const int32_t channels,
+                         const uint32_t buffer_ms)
+{
+  const size_t frame = (format == audio_format_t::S16 ? 2 : 4) * channels;
+  const size_t frames = std::max<size_t>(
+      static_cast<size_t>(frequency) * buffer_ms / 1000, 1024);
+  return frames * frame;
+}
+
+
+void music_stream_t::parse_header(const std::string& path,
+                                  uint16_t& format,
+                                  int32_t& channels,
+                                  int32_t& frequency)
+{
+  uint8_t riff[12];
+  if (!_file.read((char*)riff, sizeof(riff)) ||
+      std::memcmp(riff, "RIFF", 4) != 0 ||
+      std::memcmp(riff + 8, "WAVE", 4) != 0) {
+    throw load_exceptions("Only WAV files can be streamed: " + path);
+  }
+
+  bool has_format = false;
+  uint8_t chunk[8];
+
+  while (_file.read((char*)chunk, sizeof(chunk))) {
+    const uint32_t size = read_u32(chunk + 4);
+
+    if (std::memcmp(chunk, "fmt ", 4) == 0) {
+      uint8_t fmt[40] = {0};
+      if (size < 16 || !_file.read((char*)fmt, std::min<uint32_t>(size, 40))) {
+        break;
+      }
+
+      // WAVE_FORMAT_EXTENSIBLE keeps the real tag in the sub format
+      uint16_t tag = read_u16(fmt);
+      if (tag == 0xFFFE && size >= 26) { tag = read_u16(fmt + 24); }
+
+      channels = read_u16(fmt + 2);
+      frequency = static_cast<int32_t>(read_u32(fmt + 4));
+      const uint16_t bits = read_u16(fmt + 14);
+
+      if (tag == 1 && bits == 8) {
+        format = AUDIO_U8;
+      } else if (tag == 1 && bits == 16) {
+        format = AUDIO_S16LSB;
+      } else if (tag == 1 && bits == 32) {
+        format = AUDIO_S32LSB;
+      } else if (tag == 3 && bits == 32) {
+        format = AUDIO_F32LSB;
+      } else {
+        throw load_exceptions("Unsupported WAV encoding: " + path);
+      }
+
+      if (channels < 1 || frequency < 1) {
+        throw load_exceptions("Invalid WAV format: " + path);
+      }
+
+      _source_frame_bytes = (bits / 8) * channels;
+      has_format = true;
+
+      // Chunks are word aligned
+      const uint32_t skip = size + (size & 1) - std::min<uint32_t>(size, 40);
+      _file.seekg(skip, std::ios::cur);
+    } else if (std::memcmp(chunk, "data", 4) == 0) {
+      if (!has_format) { break; }
+
+      _data_start = static_cast<uint64_t>(_file.tellg());
+      _data_size = size - size % _source_frame_bytes;
+      return;
+    } else {
+      _file.seekg(size + (size & 1), std::ios::cur);
+    }
+  }
+
+  throw load_exceptions("Malformed WAV file: " + path);
+}
+
+
+/*******************************************************************************
+ * MUSIC STREAM
+ ******************************************************************************/
+
+music_stream_t::music_stream_t(const std::string& path,
+                               const int32_t frequency,
+                               const audio_format_t format,
+                               const int32_t channels,
+                               const uint32_t buffer_ms,
+                               const bool loop)
+    : _file(path, std::ios::binary),
+      _frame_bytes((format == audio_format_t::S16 ? 2 : 4) * channels),
+      _frequency(frequency),
+      _loop(loop),
+      _block(READ_BLOCK),
+      _ring(ring_bytes(frequency, format, channels, buffer_ms))
+{
+  if (!_file) { throw load_exceptions("Failed to open music: " + path); }
+
+  uint16_t source_format;
+  int32_t source_channels;
+  int32_t source_frequency;
+  parse_header(path, source_format, source_channels, source_frequency);
+
+  const SDL_AudioFormat device_format =
+      format == audio_format_t::S16 ? AUDIO_S16SYS : AUDIO_F32SYS;
+
+  _converter = SDL_NewAudioStream(source_format, source_channels,
+                                  source_frequency, device_format, channels,
+                                  frequency);
+  if (_converter == NULL) {
+    throw load_exceptions("Failed to create the music converter! " +
+                          std::string(SDL_GetError()));
+  }
+
+  // Half a buffer up front, so the first callbacks do not starve
+  while (_ring.size() < _ring.capacity() / 2 && decode_block()) {}
+
+  _thread = std::thread(&music_stream_t::decode_loop, this);
+}
+
+
+music_stream_t::~music_stream_t()
+{
+  _stop.store(true, std::memory_order_relaxed);
+  if (_thread.joinable()) { _thread.join(); }
+
+  if (_converter) { SDL_FreeAudioStream(_converter); }
+}
+
+
+// Does one step of work, false if there is nothing to do for now
+bool music_stream_t::decode_block()
+{
+  // Converted audio goes to the ring first, that bounds the converter
+  const int available = SDL_AudioStreamAvailable(_converter);
+
+  if (available > 0) {
+    size_t n = std::min({_ring.free(), _block.size(),
+                         static_cast<size_t>(available)});
+    n -= n % _frame_bytes;
+    if (n == 0) { return false; }
+
+    const int got = SDL_AudioStreamGet(_converter, _block.data(),
+                                       static_cast<int>(n));
+    if (got <= 0) { return false; }
+
+    (void)_ring.write(_block.data(), static_cast<size_t>(got));
+    return true;
+  }
+
+  if (_flushed) {
+    _ended.store(true, std::memory_order_release);
+    return false;
+  }
+
+  if (_data_pos == _data_size) {
+    if (_loop && _data_size > 0) {
+      // Same converter, no gap or click at the seam
+      _file.clear();
+      _file.seekg(static_cast<std::streamoff>(_data_start));
+      _data_pos = 0;
+      _loops.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      _input_done.store(true, std::memory_order_release);
+      (void)SDL_AudioStreamFlush(_converter);
+      _flushed = true;
+      return true;
+    }
+  }
+
+  uint64_t n = std::min<uint64_t>(_block.size(), _data_size - _data_pos);
+  n -= n % _source_frame_bytes;
+
+  _file.read((char*)_block.data(), static_cast<std::streamsize>(n));
+  const size_t got = static_cast<size_t>(_file.gcount());
+
+  if (got == 0) {
+    // Truncated file, play what was read
+    _data_size = _data_pos;
+    return true;
+  }
+
+  _data_pos += got;
+  (void)SDL_AudioStreamPut(_converter, _block.data(), static_cast<int>(got));
+  return true;
+}
+
+
+void music_stream_t::decode_loop()
+{
+  while (!_stop.load(std::memory_order_relaxed)) {
+    if (decode_block()) { continue; }
+    if (_ended.load(std::memory_order_relaxed)) { return; }
+
+    // Ring full, the audio thread drains it in buffer sized steps
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+}
+
+
+size_t music_stream_t::read(uint8_t* dst, const size_t bytes)
+{
+  const size_t n = _ring.read(dst, bytes);
+
+  if (n < bytes && !_input_done.load(std::memory_order_acquire)) {
+    _underruns.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  return n;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "pixello.hpp"
+#include "spsc_ring.hpp"
+
+struct SDL_AudioStream;
+
+/*******************************************************************************
+ * MUSIC STREAM
+ ******************************************************************************/
+// Reads a WAV file ahead on a background thread, converts it to the device
+// format and keeps it in a fixed size ring. Memory does not depend on the
+// length of the track. The audio thread only reads from the ring.
+class music_stream_t
+{
+private:
+  static constexpr size_t READ_BLOCK = 16384;
+
+  std::ifstream _file;
+  uint64_t _data_start = 0;
+  uint64_t _data_size = 0;
+  uint64_t _data_pos = 0;
+  uint32_t _source_frame_bytes = 0;
+  uint32_t _frame_bytes = 0;
+  int32_t _frequency;
+  bool _loop;
+
+  // Decode thread only, besides construction
+  SDL_AudioStream* _converter = NULL;
+  std::vector<uint8_t> _block;
+  bool _flushed = false;
+
+  spsc_byte_ring_t _ring;
+  std::thread _thread;
+
+  std::atomic<bool> _stop{false};
+  std::atomic<bool> _input_done{false};
+  std::atomic<bool> _ended{false};
+  std::atomic<uint64_t> _underruns{0};
+  std::atomic<uint64_t> _loops{0};
+
+  void parse_header(const std::string& path, uint16_t& format,
+                    int32_t& channels, int32_t& frequency);
+  bool decode_block();
+  void decode_loop();
+
+public:
+  music_stream_t(const std::string& path,
+                 const int32_t frequency,
+                 const audio_format_t format,
+                 const int32_t channels,
+                 const uint32_t buffer_ms,
+                 const bool loop);
+  ~music_stream_t();
+
+  music_stream_t(const music_stream_t&) = delete;
+  music_stream_t& operator=(const music_stream_t&) = delete;
+
+  // Audio thread. Returns less than asked when starving or at the end.
+  size_t read(uint8_t* dst, const size_t bytes);
+  inline bool finished() const
+  {
+    return _ended.load(std::memory_order_acquire) && _ring.size() == 0;
+  }
+
+  inline float fill() const
+  {
+    return _ring.size() / static_cast<float>(_ring.capacity());
+  }
+  inline float buffered_ms() const
+  {
+    return _ring.size() * 1000.0f / (_frame_bytes * _frequency);
+  }
+  inline uint64_t underruns() const
+  {
+    return _underruns.load(std::memory_order_relaxed);
+  }
+  inline uint64_t loops() const
+  {
+    return _loops.load(std::memory_order_relaxed);
+  }
+};
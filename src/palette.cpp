@@ -0,0 +1,267 @@
+#include "palette.hpp"
+#include <SDL.h>
+#include <algorithm>
+#include <cstring>
+
+// The AVX2 path is built for any x86 target and picked at run time
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PALETTE_AVX2
+#include <immintrin.h>
+#endif
+
+/*******************************************************************************
+ * LUT EXPANSION
+ ******************************************************************************/
+
+static void expand_scalar(uint32_t* dst,
+                          const uint8_t* src,
+                          const size_t n,
+                          const uint32_t* lut)
+{
+  size_t i = 0;
+
+  // One load for eight indices, the table stays in L1
+  for (; i + 8 <= n; i += 8) {
+    uint64_t v;
+    std::memcpy(&v, src + i, sizeof(v));
+
+    dst[i + 0] = lut[v & 0xFF];
+    dst[i + 1] = lut[(v >> 8) & 0xFF];
+    dst[i + 2] = lut[(v >> 16) & 0xFF];
+    dst[i + 3] = lut[(v >> 24) & 0xFF];
+    dst[i + 4] = lut[(v >> 32) & 0xFF];
+    dst[i + 5] = lut[(v >> 40) & 0xFF];
+    dst[i + 6] = lut[(v >> 48) & 0xFF];
+    dst[i + 7] = lut[v >> 56];
+  }
+
+  for (; i < n; ++i) {
+    dst[i] = lut[src[i]];
+  }
+}
+
+
+#if defined(PALETTE_AVX2)
+__attribute__((target("avx2"))) static void expand_avx2(uint32_t* dst,
+                                                        const uint8_t* src,
+                                                        const size_t n,
+                                                        const uint32_t* lut)
+{
+  size_t i = 0;
+
+  // Eight indices widened to 32 bits and gathered at once
+  for (; i + 8 <= n; i += 8) {
+    const __m128i bytes = _mm_loadl_epi64((const __m128i*)(src + i));
+    const __m256i idx = _mm256_cvtepu8_epi32(bytes);
+    const __m256i px = _mm256_i32gather_epi32((const int*)lut, idx, 4);
+    _mm256_storeu_si256((__m256i*)(dst + i), px);
+  }
+
+  for (; i < n; ++i) {
+    dst[i] = lut[src[i]];
+  }
+}
+#endif
+
+
+using expand_fn = void (*)(uint32_t*, const uint8_t*, size_t, const uint32_t*);
+
+static expand_fn pick_expand()
+{
+#if defined(PALETTE_AVX2)
+  if (__builtin_cpu_supports("avx2")) { return expand_avx2; }
+#endif
+  return expand_scalar;
+}
+
+
+void palette_framebuffer_t::expand_row(uint32_t* dst,
+                                       const uint8_t* src,
+                                       const size_t n,
+                                       const uint32_t* lut,
+                                       const bool simd)
+{
+  static const expand_fn best = pick_expand();
+  (simd ? best : expand_scalar)(dst, src, n, lut);
+}
+
+
+/*******************************************************************************
+ * PALETTE FRAMEBUFFER
+ ******************************************************************************/
+
+palette_framebuffer_t::palette_framebuffer_t(const pixello& p,
+                                             const int32_t w,
+                                             const int32_t h)
+    : _w(w), _h(h), _texture(p.create_streaming_texture(w, h))
+{
+  _pixels.assign(static_cast<size_t>(w) * h, 0);
+
+  // Gray ramp until a palette is set
+  for (size_t i = 0; i < _palette.size(); ++i) {
+    const uint8_t c = static_cast<uint8_t>(i);
+    _palette[i] = pixel_t(c, c, c, 0xFF);
+  }
+}
+
+
+void palette_framebuffer_t::clear(const uint8_t index)
+{
+  std::fill(_pixels.begin(), _pixels.end(), index);
+  _pixels_dirty = true;
+}
+
+
+void palette_framebuffer_t::fill_rect(const rect_t& rect, const uint8_t index)
+{
+  const int32_t x0 = std::max(rect.x, 0);
+  const int32_t y0 = std::max(rect.y, 0);
+  const int32_t x1 = std::min(rect.x + rect.w, _w);
+  const int32_t y1 = std::min(rect.y + rect.h, _h);
+
+  if (x0 >= x1 || y0 >= y1) { return; }
+
+  for (int32_t y = y0; y < y1; ++y) {
+    std::memset(&_pixels[y * _w + x0], index, x1 - x0);
+  }
+
+  _pixels_dirty = true;
+}
+
+
+void palette_framebuffer_t::draw_line(int32_t x0,
+                                      int32_t y0,
+                                      const int32_t x1,
+                                      const int32_t y1,
+                                      const uint8_t index)
+{
+  // Bresenham
+  const int32_t dx = std::abs(x1 - x0);
+  const int32_t dy = -std::abs(y1 - y0);
+  const int32_t sx = x0 < x1 ? 1 : -1;
+  const int32_t sy = y0 < y1 ? 1 : -1;
+  int32_t err = dx + dy;
+
+  while (true) {
+    set_pixel(x0, y0, index);
+    if (x0 == x1 && y0 == y1) { break; }
+
+    const int32_t e2 = 2 * err;
+    if (e2 >= dy) {
+      err += dy;
+      x0 += sx;
+    }
+    if (e2 <= dx) {
+      err += dx;
+      y0 += sy;
+    }
+  }
+}
+
+
+void palette_framebuffer_t::set_color(const uint8_t index,
+                                      const pixel_t& color)
+{
+  _palette[index] = color;
+  _lut_dirty = true;
+}
+
+
+void palette_framebuffer_t::set_palette(const std::vector<pixel_t>& colors)
+{
+  if (colors.size() > _palette.size()) {
+    throw input_exception("Too many palette colors: " + STR(colors.size()));
+  }
+
+  std::copy(colors.begin(), colors.end(), _palette.begin());
+  _lut_dirty = true;
+}
+
+
+void palette_framebuffer_t::cycle(const uint8_t first,
+                                  const uint32_t count,
+                                  const int32_t steps)
+{
+  if (first + count > _palette.size()) {
+    throw input_exception("Invalid palette range: " + STR(first) + " + " +
+                          STR(count));
+  }
+
+  if (count < 2) { return; }
+
+  const int32_t n = static_cast<int32_t>(count);
+  const int32_t shift = ((steps % n) + n) % n;
+
+  // Moves every color forward by shift
+  auto begin = _palette.begin() + first;
+  std::rotate(begin, begin + (n - shift) % n, begin + n);
+  _lut_dirty = true;
+}
+
+
+void palette_framebuffer_t::fade(const pixel_t& color, const float amount)
+{
+  _fade_color = color;
+  _fade = std::clamp(amount, .0f, 1.0f);
+  _lut_dirty = true;
+}
+
+
+void palette_framebuffer_t::rebuild_lut()
+{
+  const float keep = 1.0f - _fade;
+  const pixel_t& f = _fade_color;
+
+  for (size_t i = 0; i < _palette.size(); ++i) {
+    const pixel_t& c = _palette[i];
+    const uint32_t r = static_cast<uint32_t>(c.r * keep + f.r * _fade);
+    const uint32_t g = static_cast<uint32_t>(c.g * keep + f.g * _fade);
+    const uint32_t b = static_cast<uint32_t>(c.b * keep + f.b * _fade);
+    _lut[i] = (static_cast<uint32_t>(c.a) << 24) | (r << 16) | (g << 8) | b;
+  }
+
+  // Every pixel changes color
+  _lut_dirty = false;
+  _pixels_dirty = true;
+}
+
+
+void palette_framebuffer_t::upload(const pixello& p)
+{
+  if (_lut_dirty) {
+    rebuild_lut();
+  }
+
+  if (!_pixels_dirty) { return; }
+
+  void* raw;
+  int pitch;
+  if (SDL_LockTexture(_texture.pointer(), NULL, &raw, &pitch) != 0) {
+    throw runtime_exception("Failed to lock the framebuffer texture! " +
+                            std::string(SDL_GetError()));
+  }
+
+  // The pitch can be wider than the rows
+  uint8_t* dst = static_cast<uint8_t*>(raw);
+  for (int32_t y = 0; y < _h; ++y) {
+    expand_row((uint32_t*)(dst + y * pitch), &_pixels[y * _w], _w,
+               _lut.data());
+  }
+
+  SDL_UnlockTexture(_texture.pointer());
+  p.count_upload(static_cast<uint64_t>(_w) * _h * sizeof(uint32_t));
+  _pixels_dirty = false;
+}
+
+
+void palette_framebuffer_t::draw(const pixello& p, const rect_t& rect)
+{
+  upload(p);
+  p.draw_texture(_texture, rect);
+}
+
+
+void palette_framebuffer_t::draw(const pixello& p)
+{
+  draw(p, {0, 0, p.width(), p.height()});
+}
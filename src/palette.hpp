@@ -0,0 +1,95 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include "pixello.hpp"
+
+/*******************************************************************************
+ * PALETTE FRAMEBUFFER
+ ******************************************************************************/
+// 8 bit indexed framebuffer. Drawing writes palette indices, once per frame
+// draw() expands them through a lookup table into a streaming texture. The
+// palette effects only rebuild the 256 entries of the table, the pixels are
+// not touched.
+class palette_framebuffer_t
+{
+private:
+  int32_t _w;
+  int32_t _h;
+  std::vector<uint8_t> _pixels;
+  texture_t _texture;
+
+  std::array<pixel_t, 256> _palette;
+  std::array<uint32_t, 256> _lut;  // ARGB, with the fade applied
+  pixel_t _fade_color = 0x000000FF;
+  float _fade = 0.0f;
+
+  bool _pixels_dirty = true;
+  bool _lut_dirty = true;
+
+  void rebuild_lut();
+  void upload(const pixello& p);
+
+public:
+  palette_framebuffer_t(const pixello& p, const int32_t w, const int32_t h);
+
+  // Drawing, clipped to the framebuffer
+  void clear(const uint8_t index = 0);
+  inline void set_pixel(const int32_t x, const int32_t y, const uint8_t index)
+  {
+    if (x < 0 || y < 0 || x >= _w || y >= _h) { return; }
+    _pixels[y * _w + x] = index;
+    _pixels_dirty = true;
+  }
+  inline uint8_t get_pixel(const int32_t x, const int32_t y) const
+  {
+    return _pixels[y * _w + x];
+  }
+  void fill_rect(const rect_t& rect, const uint8_t index);
+  void draw_line(int32_t x0,
+                 int32_t y0,
+                 const int32_t x1,
+                 const int32_t y1,
+                 const uint8_t index);
+
+  // Direct access, rows are w bytes. Call mark_dirty() after writing.
+  inline uint8_t* data() { return _pixels.data(); }
+  inline void mark_dirty() { _pixels_dirty = true; }
+
+  // Palette
+  void set_color(const uint8_t index, const pixel_t& color);
+  void set_palette(const std::vector<pixel_t>& colors);
+  inline const pixel_t& color(const uint8_t index) const
+  {
+    return _palette[index];
+  }
+
+  // The ARGB table the pixels are expanded through, with the fade applied
+  inline const std::array<uint32_t, 256>& lut()
+  {
+    if (_lut_dirty) { rebuild_lut(); }
+    return _lut;
+  }
+
+  // Writes lut[src[i]] for n pixels. The AVX2 path is used when the CPU
+  // has it, simd false forces the plain one.
+  static void expand_row(uint32_t* dst,
+                         const uint8_t* src,
+                         const size_t n,
+                         const uint32_t* lut,
+                         const bool simd = true);
+
+  // Rotates count entries starting at first, by steps (negative goes back)
+  void cycle(const uint8_t first, const uint32_t count, const int32_t steps);
+
+  // Blends every entry toward color, 0 is the plain palette and 1 is color
+  void fade(const pixel_t& color, const float amount);
+
+  // Uploads what changed and draws the framebuffer stretched on rect
+  void draw(const pixello& p, const rect_t& rect);
+  void draw(const pixello& p);
+
+  inline int32_t w() const { return _w; }
+  inline int32_t h() const { return _h; }
+  inline const texture_t& texture() const { return _texture; }
+};
@@ -0,0 +1,239 @@
+#include "particles.hpp"
+#include <SDL.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/*******************************************************************************
+ * PARTICLE SYSTEM
+ ******************************************************************************/
+
+particle_system_t::particle_system_t(const size_t capacity,
+                                     const particle_config_t& config)
+    : _capacity(capacity), _config(config)
+{
+  // Four vertices per particle, indexed with an int
+  if (capacity == 0 || capacity > INT32_MAX / 4) {
+    throw input_exception("Invalid particle capacity: " + STR(capacity));
+  }
+
+  _x.resize(capacity);
+  _y.resize(capacity);
+  _vx.resize(capacity);
+  _vy.resize(capacity);
+  _life.resize(capacity);
+  _inv_life.resize(capacity);
+  _color.resize(capacity);
+  _vertices.resize(capacity * 4);
+
+  // The same two triangles for every particle
+  _indices.resize(capacity * 6);
+  for (size_t i = 0; i < capacity; ++i) {
+    const int v = static_cast<int>(i * 4);
+    int* idx = &_indices[i * 6];
+    idx[0] = v;
+    idx[1] = v + 1;
+    idx[2] = v + 2;
+    idx[3] = v;
+    idx[4] = v + 2;
+    idx[5] = v + 3;
+  }
+}
+
+
+// xorshift, in [0, 1)
+float particle_system_t::random()
+{
+  _seed ^= _seed << 13;
+  _seed ^= _seed >> 17;
+  _seed ^= _seed << 5;
+  return (_seed >> 8) * (1.0f / 16777216.0f);
+}
+
+
+size_t particle_system_t::emit(const particle_burst_t& burst, const size_t n)
+{
+  if (burst.life_min <= .0f || burst.life_max < burst.life_min) {
+    throw input_exception("Invalid particle life: " + STR(burst.life_min) +
+                          " - " + STR(burst.life_max));
+  }
+
+  const size_t spawned = std::min(n, _capacity - _count);
+  const pixel_t c = _config.color_start;
+  const uint32_t color = c.r | (c.g << 8) | (c.b << 16) |
+                         (static_cast<uint32_t>(c.a) << 24);
+
+  for (size_t i = _count; i < _count + spawned; ++i) {
+    const float offset_angle = random() * 6.2831853f;
+    const float offset = std::sqrt(random()) * burst.radius;
+    _x[i] = burst.x + std::cos(offset_angle) * offset;
+    _y[i] = burst.y + std::sin(offset_angle) * offset;
+
+    const float angle = burst.angle + (random() - 0.5f) * burst.spread;
+    const float speed =
+        burst.speed_min + random() * (burst.speed_max - burst.speed_min);
+    _vx[i] = std::cos(angle) * speed;
+    _vy[i] = std::sin(angle) * speed;
+
+    const float life =
+        burst.life_min + random() * (burst.life_max - burst.life_min);
+    _life[i] = life;
+    _inv_life[i] = 1.0f / life;
+    _color[i] = color;
+  }
+
+  _count += spawned;
+  return spawned;
+}
+
+
+void particle_system_t::integrate(const float dt)
+{
+  const float damp = std::max(1.0f - _config.drag * dt, .0f);
+  const float gx = _config.gravity_x * dt;
+  const float gy = _config.gravity_y * dt;
+
+  // Color channels, 0 at the end of the life
+  const pixel_t s = _config.color_start;
+  const pixel_t e = _config.color_end;
+  const float end[4] = {float(e.r), float(e.g), float(e.b), float(e.a)};
+  const float delta[4] = {float(s.r) - e.r, float(s.g) - e.g,
+                          float(s.b) - e.b, float(s.a) - e.a};
+
+  float* x = _x.data();
+  float* y = _y.data();
+  float* vx = _vx.data();
+  float* vy = _vy.data();
+  float* life = _life.data();
+  const float* inv_life = _inv_life.data();
+  uint32_t* color = _color.data();
+
+  size_t i = 0;
+
+#if defined(__SSE2__)
+  const __m128 v_dt = _mm_set1_ps(dt);
+  const __m128 v_damp = _mm_set1_ps(damp);
+  const __m128 v_gx = _mm_set1_ps(gx);
+  const __m128 v_gy = _mm_set1_ps(gy);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.0f);
+
+  for (; i + 4 <= _count; i += 4) {
+    __m128 pvx = _mm_loadu_ps(vx + i);
+    __m128 pvy = _mm_loadu_ps(vy + i);
+    pvx = _mm_mul_ps(_mm_add_ps(pvx, v_gx), v_damp);
+    pvy = _mm_mul_ps(_mm_add_ps(pvy, v_gy), v_damp);
+    _mm_storeu_ps(vx + i, pvx);
+    _mm_storeu_ps(vy + i, pvy);
+
+    _mm_storeu_ps(x + i, _mm_add_ps(_mm_loadu_ps(x + i),
+                                    _mm_mul_ps(pvx, v_dt)));
+    _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i),
+                                    _mm_mul_ps(pvy, v_dt)));
+
+    const __m128 l = _mm_sub_ps(_mm_loadu_ps(life + i), v_dt);
+    _mm_storeu_ps(life + i, l);
+
+    const __m128 t = _mm_min_ps(
+        _mm_max_ps(_mm_mul_ps(l, _mm_loadu_ps(inv_life + i)), zero), one);
+
+    __m128i packed = _mm_setzero_si128();
+    for (int32_t c = 0; c < 4; ++c) {
+      const __m128 v = _mm_add_ps(_mm_set1_ps(end[c]),
+                                  _mm_mul_ps(_mm_set1_ps(delta[c]), t));
+      const __m128i channel = _mm_cvttps_epi32(v);
+      packed = _mm_or_si128(
+          packed, _mm_sll_epi32(channel, _mm_cvtsi32_si128(c * 8)));
+    }
+    _mm_storeu_si128((__m128i*)(color + i), packed);
+  }
+#endif
+
+  for (; i < _count; ++i) {
+    vx[i] = (vx[i] + gx) * damp;
+    vy[i] = (vy[i] + gy) * damp;
+    x[i] += vx[i] * dt;
+    y[i] += vy[i] * dt;
+    life[i] -= dt;
+
+    const float t = std::clamp(life[i] * inv_life[i], .0f, 1.0f);
+    uint32_t packed = 0;
+    for (int32_t c = 0; c < 4; ++c) {
+      packed |= static_cast<uint32_t>(end[c] + delta[c] * t) << (c * 8);
+    }
+    color[i] = packed;
+  }
+}
+
+
+// Dead particles take the last alive one, the order does not matter
+void particle_system_t::compact()
+{
+  size_t i = 0;
+
+  while (i < _count) {
+    if (_life[i] > .0f) {
+      ++i;
+      continue;
+    }
+
+    const size_t last = --_count;
+    _x[i] = _x[last];
+    _y[i] = _y[last];
+    _vx[i] = _vx[last];
+    _vy[i] = _vy[last];
+    _life[i] = _life[last];
+    _inv_life[i] = _inv_life[last];
+    _color[i] = _color[last];
+  }
+}
+
+
+void particle_system_t::update(const float dt)
+{
+  integrate(dt);
+  compact();
+}
+
+
+void particle_system_t::fill_vertices()
+{
+  const float half = _config.size * 0.5f;
+  vertex_t* out = _vertices.data();
+
+  for (size_t i = 0; i < _count; ++i) {
+    const float x0 = _x[i] - half;
+    const float y0 = _y[i] - half;
+    const float x1 = _x[i] + half;
+    const float y1 = _y[i] + half;
+
+    vertex_t* q = out + i * 4;
+    q[0] = {x0, y0, 0, 0, 0, 0, 0.0f, 0.0f};
+    q[1] = {x1, y0, 0, 0, 0, 0, 1.0f, 0.0f};
+    q[2] = {x1, y1, 0, 0, 0, 0, 1.0f, 1.0f};
+    q[3] = {x0, y1, 0, 0, 0, 0, 0.0f, 1.0f};
+
+    for (int32_t v = 0; v < 4; ++v) {
+      std::memcpy(&q[v].r, &_color[i], sizeof(uint32_t));
+    }
+  }
+}
+
+
+void particle_system_t::draw(const pixello& p, const texture_t& t)
+{
+  if (_count == 0) { return; }
+
+  fill_vertices();
+
+  // The buffers are sized for the capacity, only the alive part is drawn
+  SDL_Texture* texture = t.is_valid() ? p.use_texture(t) : NULL;
+  SDL_RenderGeometry(p.renderer(), texture, (SDL_Vertex*)_vertices.data(),
+                     static_cast<int>(_count * 4), _indices.data(),
+                     static_cast<int>(_count * 6));
+  p.count_draw_call(texture);
+}
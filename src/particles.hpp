@@ -0,0 +1,78 @@
+#pragma once
+
+#include <vector>
+#include "pixello.hpp"
+
+/*******************************************************************************
+ * PARTICLES
+ ******************************************************************************/
+
+struct particle_config_t
+{
+  float gravity_x = 0.0f;  // Pixels per second squared
+  float gravity_y = 0.0f;
+  float drag = 0.0f;  // Fraction of the velocity lost per second
+  float size = 2.0f;  // Pixels, quads are centered on the particle
+
+  // Interpolated over the life of each particle
+  pixel_t color_start = 0xFFFFFFFF;
+  pixel_t color_end = 0xFFFFFF00;
+};
+
+struct particle_burst_t
+{
+  float x, y;
+  float radius = 0.0f;  // Spawn area around the point
+  float angle = 0.0f;   // Radians, direction of the burst
+  float spread = 6.2831853f;
+  float speed_min = 50.0f;
+  float speed_max = 100.0f;
+  float life_min = 0.5f;  // Seconds
+  float life_max = 1.0f;
+};
+
+// Structure of arrays storage with a fixed capacity, nothing is allocated
+// after construction. Dead particles are replaced by the last alive one, so
+// the arrays stay packed for the SIMD update. All particles are drawn with
+// one geometry call.
+class particle_system_t
+{
+private:
+  size_t _capacity;
+  size_t _count = 0;
+  particle_config_t _config;
+  uint32_t _seed = 0x9E3779B9;
+
+  std::vector<float> _x;
+  std::vector<float> _y;
+  std::vector<float> _vx;
+  std::vector<float> _vy;
+  std::vector<float> _life;      // Seconds left
+  std::vector<float> _inv_life;  // 1 / initial life
+  std::vector<uint32_t> _color;  // SDL_Color byte order
+
+  // Geometry, indices are built once for the capacity
+  std::vector<vertex_t> _vertices;
+  std::vector<int> _indices;
+
+  float random();
+  void integrate(const float dt);
+  void compact();
+  void fill_vertices();
+
+public:
+  particle_system_t(const size_t capacity,
+                    const particle_config_t& config = particle_config_t());
+
+  // Returns how many were spawned, less than n once the capacity is reached
+  size_t emit(const particle_burst_t& burst, const size_t n);
+  void update(const float dt);
+  void clear() { _count = 0; }
+
+  // Optional texture stretched on every quad, untextured squares otherwise
+  void draw(const pixello& p, const texture_t& t = texture_t());
+
+  inline size_t size() const { return _count; }
+  inline size_t capacity() const { return _capacity; }
+  inline particle_config_t& config() { return _config; }
+};
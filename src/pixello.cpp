@@ -1,7 +1,22 @@
 #include "pixello.hpp"
 #include <SDL_mixer.h>
-#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include "atlas.hpp"
+#include "audio_engine.hpp"
+#include "draw_list.hpp"
+#include "image.hpp"
+#include "input_record.hpp"
+#include "job_system.hpp"
+#include "logger.hpp"
+#include "shapes.hpp"
+#include "texture_residency.hpp"
+
+#ifdef PIXELLO_HAS_SDL2_GFX
 #include "SDL2_gfxPrimitives.h"
+#endif
 #include "SDL_image.h"
 #include "SDL_render.h"
 #include "SDL_ttf.h"
@@ -58,8 +73,14 @@ constexpr SDL_Scancode KEYCAP_MAP[] = {
   SDL_SCANCODE_SPACE,
   SDL_SCANCODE_LSHIFT
 };
+
+static_assert(sizeof(KEYCAP_MAP) / sizeof(KEYCAP_MAP[0]) <= 64,
+              "The key states of a frame are bits of an uint64_t");
 // clang-format on
 
+static_assert(sizeof(vertex_t) == sizeof(SDL_Vertex),
+              "vertex_t must match SDL_Vertex");
+
 
 /*******************************************************************************
  * STRUCTS
@@ -67,10 +88,14 @@ constexpr SDL_Scancode KEYCAP_MAP[] = {
 
 sdl_texture_wrapper_t::~sdl_texture_wrapper_t()
 {
+  // Evicted textures had their bytes counted already
   if (ptr) {
     SDL_DestroyTexture(ptr);
     ptr = NULL;
+    if (counters) { counters->texture_bytes_destroyed += bytes; }
   }
+
+  if (counters) { --counters->textures; }
 }
 
 std_font_wrapper_t::~std_font_wrapper_t()
@@ -79,10 +104,14 @@ std_font_wrapper_t::~std_font_wrapper_t()
     TTF_CloseFont(ptr);
     ptr = NULL;
   }
+
+  if (counters) { --counters->fonts; }
 }
 
 sdl_sound_wrapper_t::~sdl_sound_wrapper_t()
 {
+  if (counters) { --counters->sounds; }
+
   if (music_ptr) {
     Mix_FreeMusic(music_ptr);
     music_ptr = NULL;
@@ -94,6 +123,51 @@ sdl_sound_wrapper_t::~sdl_sound_wrapper_t()
   }
 }
 
+void view_t::to_screen(const float wx,
+                       const float wy,
+                       float& sx,
+                       float& sy) const
+{
+  const float c = cosf(camera.rotation) * camera.zoom;
+  const float s = sinf(camera.rotation) * camera.zoom;
+  const float dx = wx - camera.x;
+  const float dy = wy - camera.y;
+
+  sx = viewport.x + viewport.w * 0.5f + dx * c - dy * s;
+  sy = viewport.y + viewport.h * 0.5f + dx * s + dy * c;
+}
+
+
+void view_t::to_world(const point_t& screen, float& wx, float& wy) const
+{
+  const float c = cosf(camera.rotation) / camera.zoom;
+  const float s = sinf(camera.rotation) / camera.zoom;
+  const float lx = screen.x - viewport.x - viewport.w * 0.5f;
+  const float ly = screen.y - viewport.y - viewport.h * 0.5f;
+
+  wx = camera.x + lx * c + ly * s;
+  wy = camera.y - lx * s + ly * c;
+}
+
+
+void view_t::visible_bounds(float& x0, float& y0, float& x1, float& y1) const
+{
+  const float hw = viewport.w * 0.5f / camera.zoom;
+  const float hh = viewport.h * 0.5f / camera.zoom;
+  const float c = fabsf(cosf(camera.rotation));
+  const float s = fabsf(sinf(camera.rotation));
+
+  // Bounding box of the rotated viewport
+  const float ex = c * hw + s * hh;
+  const float ey = s * hw + c * hh;
+
+  x0 = camera.x - ex;
+  y0 = camera.y - ey;
+  x1 = camera.x + ex;
+  y1 = camera.y + ey;
+}
+
+
 simple_timer::simple_timer()
 {
   start_ticks = 0;
@@ -174,27 +248,99 @@ uint64_t simple_timer::get_ticks() const
  * PIXELLO CLASS
  ******************************************************************************/
 
+static float ms_since(const uint64_t start)
+{
+  const uint64_t now = SDL_GetPerformanceCounter();
+  return (now - start) * 1000.0f /
+         static_cast<float>(SDL_GetPerformanceFrequency());
+}
+
+
+static std::string ms_str(const float ms)
+{
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), "%.2fms", ms);
+  return buffer;
+}
+
+
 pixello::~pixello()
 {
+  // Workers may still use the resources below
+  _jobs.reset();
+
+  // Owned textures go before their renderer
+  _render_target = texture_t();
+  _frame_target = texture_t();
+  _retained_target = texture_t();
+  _circle_batch.reset();
+
   if (_renderer) { SDL_DestroyRenderer(_renderer); }
   if (_window) { SDL_DestroyWindow(_window); }
 
-  Mix_Quit();
-  IMG_Quit();
+  if (_ttf_ready) { TTF_Quit(); }
+
+  if (_audio_ready) {
+    Mix_SetPostMix(NULL, NULL);
+    Mix_HookMusic(NULL, NULL);
+    Mix_CloseAudio();
+    Mix_Quit();
+    _audio_engine.reset();
+  }
+
+  if (_image_ready) { IMG_Quit(); }
+
   SDL_Quit();
+
+  // Drains what is left
+  _logger.reset();
 }
 
 void pixello::log(const std::string& msg)
 {
-  std::cout << msg << std::endl;
+  logger().write_raw(log_level_t::INFO, msg);
+}
+
+
+job_system_t& pixello::jobs() const
+{
+  if (!_jobs) {
+    throw runtime_exception("The job system starts with run()");
+  }
+
+  return *_jobs;
+}
+
+
+void pixello::start_logger()
+{
+  _logger = std::make_shared<logger_t>(_config.log_level, _config.log_path,
+                                       _config.log_to_stdout, _config.log_ring);
+}
+
+
+logger_t& pixello::logger() const
+{
+  return *_logger;
 }
 
 void pixello::init()
 {
   _running = true;
 
-  // Initialize SDL
-  if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) < 0) {
+  const uint64_t init_start = SDL_GetPerformanceCounter();
+  uint64_t phase_start = init_start;
+
+  if (!_config.record_input_path.empty() &&
+      !_config.replay_input_path.empty()) {
+    throw init_exception("Recording and replaying the input at once");
+  }
+
+  // No display needed, a set SDL_VIDEODRIVER wins
+  if (_config.headless) { SDL_setenv("SDL_VIDEODRIVER", "dummy", 0); }
+
+  // Initialize SDL, the other subsystems are brought up when needed
+  if (SDL_Init(SDL_INIT_VIDEO) < 0) {
     throw init_exception("SDL could not initialize! SDL_Error: " +
                          std::string(SDL_GetError()));
   }
@@ -206,6 +352,117 @@ void pixello::init()
                          std::string(SDL_GetError()));
   }
 
+  _init_timings.video_ms = ms_since(phase_start);
+  phase_start = SDL_GetPerformanceCounter();
+
+  // Create window
+  _window = SDL_CreateWindow(_config.name.c_str(), SDL_WINDOWPOS_UNDEFINED,
+                             SDL_WINDOWPOS_UNDEFINED, _config.window_w,
+                             _config.window_h,
+                             _config.headless ? SDL_WINDOW_HIDDEN
+                                              : SDL_WINDOW_SHOWN);
+
+  if (_window == NULL) {
+    throw init_exception("Window could not be created! SDL_Error: " +
+                         std::string(SDL_GetError()));
+  }
+
+  _init_timings.window_ms = ms_since(phase_start);
+  phase_start = SDL_GetPerformanceCounter();
+
+  // Get the window renderer. A replay runs as fast as it can.
+  Uint32 renderer_flags = SDL_RENDERER_ACCELERATED;
+  if (_config.headless) {
+    renderer_flags = SDL_RENDERER_SOFTWARE;
+  } else if (_config.replay_input_path.empty()) {
+    renderer_flags |= SDL_RENDERER_PRESENTVSYNC;
+  }
+
+  _renderer = SDL_CreateRenderer(_window, -1, renderer_flags);
+
+  if (_renderer == NULL) {
+    throw init_exception("Failed to create a window renderer! SDL_Error: " +
+                         std::string(SDL_GetError()));
+  }
+
+  // Initialize renderer color
+  set_draw_color(0xFFFFFFFF);
+
+  // Enable Blend mode
+  set_draw_blend(SDL_BLENDMODE_BLEND);
+
+  // Low res frame, nearest filtered by the scale quality hint
+  if (_config.logical_resolution) {
+    _frame_target = create_render_target(_config.width_in_pixels,
+                                         _config.height_in_pixels);
+    SDL_SetTextureBlendMode(_frame_target.pointer(), SDL_BLENDMODE_NONE);
+    set_target(_frame_target.pointer());
+    update_frame_rect();
+  }
+
+  _init_timings.renderer_ms = ms_since(phase_start);
+
+  _jobs = std::make_shared<job_system_t>(_config.job_workers);
+  _residency = std::make_shared<texture_residency_t>(
+      _renderer, _config.texture_budget_bytes);
+
+  // Input log and timings
+  if (!_config.record_input_path.empty()) {
+    _recorder = std::make_shared<input_recorder_t>(_config.record_input_path);
+  }
+
+  if (!_config.replay_input_path.empty()) {
+    _player = std::make_shared<input_player_t>(_config.replay_input_path);
+  }
+
+  if (!_config.frame_timing_path.empty()) {
+    _frame_timing = std::make_shared<std::ofstream>(_config.frame_timing_path);
+    if (!*_frame_timing) {
+      throw init_exception("Failed to create the frame timing file: " +
+                           _config.frame_timing_path);
+    }
+    *_frame_timing << "frame,dt_ms,update_ms,frame_ms\n";
+  }
+
+  // Subsystems requested up front
+  if (_config.image_init == subsystem_init_t::EAGER) { require_image(); }
+  if (_config.audio_init == subsystem_init_t::EAGER) { require_audio(); }
+  if (_config.ttf_init == subsystem_init_t::EAGER) { require_ttf(); }
+
+  // CALL THE USER INIT
+  phase_start = SDL_GetPerformanceCounter();
+  on_init(_external_data);
+
+  // on_init also includes the lazy subsystems it brought up
+  const init_timings_t& t = _init_timings;
+  _init_timings.on_init_ms = ms_since(phase_start);
+  _init_timings.total_ms = ms_since(init_start);
+
+  auto subsystem_str = [](const bool ready, const subsystem_init_t mode,
+                          const float ms) -> std::string {
+    if (mode == subsystem_init_t::DISABLED) { return "disabled"; }
+    if (!ready) { return "not used yet"; }
+    return ms_str(ms) + (mode == subsystem_init_t::LAZY ? " (lazy)" : "");
+  };
+
+  log("Startup: video " + ms_str(t.video_ms) + ", window " +
+      ms_str(t.window_ms) + ", renderer " + ms_str(t.renderer_ms) +
+      ", image " + subsystem_str(_image_ready, _config.image_init, t.image_ms) +
+      ", audio " + subsystem_str(_audio_ready, _config.audio_init, t.audio_ms) +
+      ", ttf " + subsystem_str(_ttf_ready, _config.ttf_init, t.ttf_ms) +
+      ", on_init " + ms_str(t.on_init_ms) + ", total " + ms_str(t.total_ms));
+}
+
+
+void pixello::require_image() const
+{
+  if (_image_ready) { return; }
+
+  if (_config.image_init == subsystem_init_t::DISABLED) {
+    throw init_exception("The image subsystem is disabled in the config");
+  }
+
+  const uint64_t start = SDL_GetPerformanceCounter();
 
   // Init SDL IMG
   if (!(IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG)) {
@@ -213,45 +470,144 @@ void pixello::init()
                          std::string(IMG_GetError()));
   }
 
+  _image_ready = true;
+  _init_timings.image_ms = ms_since(start);
+}
+
+
+void pixello::require_audio() const
+{
+  if (_audio_ready) { return; }
+
+  if (_config.audio_init == subsystem_init_t::DISABLED) {
+    throw init_exception("The audio subsystem is disabled in the config");
+  }
+
+  const uint64_t start = SDL_GetPerformanceCounter();
+
+  if (SDL_InitSubSystem(SDL_INIT_AUDIO) < 0) {
+    throw init_exception("SDL audio could not initialize! SDL_Error: " +
+                         std::string(SDL_GetError()));
+  }
+
+  const Uint16 format = _config.audio_format == audio_format_t::S16
+                            ? AUDIO_S16SYS
+                            : AUDIO_F32SYS;
+
   // Init SDL Mixer
-  if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) < 0) {
+  if (Mix_OpenAudio(_config.audio_frequency, format, _config.audio_channels,
+                    _config.audio_buffer_frames) < 0) {
     throw init_exception("SDL_mixer could not initialize! SDL_mixer Error: " +
                          std::string(Mix_GetError()));
   }
 
+  // The device may not give exactly what was asked
+  int frequency;
+  Uint16 obtained_format;
+  int channels;
+  Mix_QuerySpec(&frequency, &obtained_format, &channels);
+
+  if (obtained_format != format) {
+    Mix_CloseAudio();
+    throw init_exception("The audio device does not support the format");
+  }
+
+  if (_config.sound_channels < 1) {
+    Mix_CloseAudio();
+    throw init_exception("Invalid number of sound channels: " +
+                         STR(_config.sound_channels));
+  }
+
+  (void)Mix_AllocateChannels(_config.sound_channels);
+  _channels.assign(_config.sound_channels, channel_t());
+
+  _audio_engine = std::make_shared<audio_engine_t>(
+      frequency, _config.audio_format, channels,
+      static_cast<size_t>(std::max(_config.mixer_voices, 0)));
+
+  Mix_SetPostMix(
+      [](void* udata, Uint8* stream, int len) {
+        static_cast<audio_engine_t*>(udata)->postmix(stream, len);
+      },
+      _audio_engine.get());
+
+  _audio_ready = true;
+  _init_timings.audio_ms = ms_since(start);
+}
+
+
+void pixello::require_ttf() const
+{
+  if (_ttf_ready) { return; }
+
+  if (_config.ttf_init == subsystem_init_t::DISABLED) {
+    throw init_exception("The ttf subsystem is disabled in the config");
+  }
+
+  const uint64_t start = SDL_GetPerformanceCounter();
+
   // Initialize SDL_ttf
   if (TTF_Init() == -1) {
     throw init_exception("SDL_ttf could not initialize! SDL_ttf Error: " +
                          std::string(TTF_GetError()));
   }
 
-  // Create window
-  _window = SDL_CreateWindow(_config.name.c_str(), SDL_WINDOWPOS_UNDEFINED,
-                             SDL_WINDOWPOS_UNDEFINED, _config.window_w,
-                             _config.window_h, SDL_WINDOW_SHOWN);
+  _ttf_ready = true;
+  _init_timings.ttf_ms = ms_since(start);
+}
 
-  if (_window == NULL) {
-    throw init_exception("Window could not be created! SDL_Error: " +
-                         std::string(SDL_GetError()));
-  }
 
-  // Get the window renderer
-  _renderer = SDL_CreateRenderer(
-      _window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+// Key state of the frame, then the log is written or read back over the
+// state built from the events
+bool pixello::read_frame_input()
+{
+  const float freq = static_cast<float>(SDL_GetPerformanceFrequency());
+
+  if (_player) {
+    input_frame_t frame;
+    if (!_player->read(frame)) {
+      log("Replay finished after " + STR(_player->frames()) + " frames");
+      _running = false;
+      return false;
+    }
 
-  if (_renderer == NULL) {
-    throw init_exception("Failed to create a window renderer! SDL_Error: " +
-                         std::string(SDL_GetError()));
+    dt = static_cast<uint64_t>(frame.dt_us * (freq / 1000000.0f));
+    _mouse_state = frame.mouse;
+    _keys = frame.keys;
+
+    if (frame.has_text) {
+      _input_buffer.set(frame.text);
+      _input_buffer.set_cursor(frame.anchor);
+      _input_buffer.set_cursor(frame.cursor, true);
+      _render_input_text = true;
+    }
+
+    return true;
   }
 
-  // Initialize renderer color
-  SDL_SetRenderDrawColor(_renderer, 0xFF, 0xFF, 0xFF, 0xFF);
+  const Uint8* states = SDL_GetKeyboardState(NULL);
+  _keys = 0;
+  for (size_t i = 0; i < sizeof(KEYCAP_MAP) / sizeof(KEYCAP_MAP[0]); ++i) {
+    if (states[KEYCAP_MAP[i]]) { _keys |= uint64_t(1) << i; }
+  }
 
-  // Enable Blend mode
-  SDL_SetRenderDrawBlendMode(_renderer, SDL_BLENDMODE_BLEND);
+  if (_recorder) {
+    input_frame_t frame;
+    frame.dt_us = static_cast<uint32_t>(dt * (1000000.0f / freq));
+    frame.mouse = _mouse_state;
+    frame.keys = _keys;
+
+    if (_render_input_text) {
+      frame.has_text = true;
+      frame.text = _input_buffer.str();
+      frame.cursor = static_cast<uint32_t>(_input_buffer.cursor());
+      frame.anchor = static_cast<uint32_t>(_input_buffer.anchor());
+    }
 
-  // CALL THE USER INIT
-  on_init(_external_data);
+    _recorder->write(frame);
+  }
+
+  return true;
 }
 
 
@@ -264,6 +620,7 @@ bool pixello::run()
     uint32_t FPS_counter = 0;
     uint64_t FPS_last_check = SDL_GetPerformanceCounter();
     uint64_t start = SDL_GetPerformanceCounter();
+    _last_input_ms = SDL_GetTicks64();
     /*************************************************************
      *                          MAIN LOOP                        *
      *************************************************************/
@@ -284,18 +641,86 @@ bool pixello::run()
 
       // POLL EVENTS
       while (SDL_PollEvent(&event)) {
+        // A replay only listens to quit
+        if (_player && event.type != SDL_QUIT) { continue; }
+
+        // Any input ends the idle pacing
+        switch (event.type) {
+          case SDL_KEYDOWN:
+          case SDL_KEYUP:
+          case SDL_TEXTINPUT:
+          case SDL_MOUSEMOTION:
+          case SDL_MOUSEBUTTONDOWN:
+          case SDL_MOUSEBUTTONUP:
+          case SDL_MOUSEWHEEL:
+            _last_input_ms = SDL_GetTicks64();
+            _app_idle = false;
+            break;
+        }
+
         switch (event.type) {
           // QUIT
           case SDL_QUIT:
             _running = false;
             break;
 
+          case SDL_WINDOWEVENT:
+            switch (event.window.event) {
+              // Some platforms bring a minimized window back without a
+              // RESTORED event
+              case SDL_WINDOWEVENT_FOCUS_GAINED:
+                _focused = true;
+                if (_minimized) {
+                  _minimized = false;
+                  invalidate();
+                }
+                break;
+              case SDL_WINDOWEVENT_FOCUS_LOST:
+                _focused = false;
+                break;
+              case SDL_WINDOWEVENT_MINIMIZED:
+                _minimized = true;
+                break;
+
+              // The retained frame has to be shown again in full
+              case SDL_WINDOWEVENT_RESTORED:
+              case SDL_WINDOWEVENT_SHOWN:
+              case SDL_WINDOWEVENT_MAXIMIZED:
+                _minimized = false;
+                invalidate();
+                break;
+              case SDL_WINDOWEVENT_EXPOSED:
+              case SDL_WINDOWEVENT_SIZE_CHANGED:
+                invalidate();
+                break;
+            }
+            break;
+
           // MOUSE SECTION
           case SDL_MOUSEMOTION: {
-            _mouse_state.x = event.motion.x;
-            _mouse_state.y = event.motion.y;
-            _mouse_state.relative_x = event.motion.xrel;
-            _mouse_state.relative_y = event.motion.yrel;
+            if (_frame_target.is_valid()) {
+              const point_t p = window_to_logical(event.motion.x,
+                                                  event.motion.y);
+              _mouse_state.x = p.x;
+              _mouse_state.y = p.y;
+
+              // From the motion itself, only the position is clamped. The
+              // fractions add up over the events.
+              const float scale = _output_per_window / _frame_scale;
+              _mouse_rest_x += event.motion.xrel * scale;
+              _mouse_rest_y += event.motion.yrel * scale;
+              const int32_t rx = static_cast<int32_t>(_mouse_rest_x);
+              const int32_t ry = static_cast<int32_t>(_mouse_rest_y);
+              _mouse_rest_x -= rx;
+              _mouse_rest_y -= ry;
+              _mouse_state.relative_x += rx;
+              _mouse_state.relative_y += ry;
+            } else {
+              _mouse_state.x = event.motion.x;
+              _mouse_state.y = event.motion.y;
+              _mouse_state.relative_x = event.motion.xrel;
+              _mouse_state.relative_y = event.motion.yrel;
+            }
             _mouse_state.did_mouse_moved = true;
           } break;
 
@@ -344,12 +769,13 @@ bool pixello::run()
 
             // Special text input event
           case SDL_TEXTINPUT: {
-            // Not copy or pasting
+            // Not a shortcut
+            const char c = event.text.text[0];
             if (!(SDL_GetModState() & KMOD_CTRL &&
-                  (event.text.text[0] == 'c' || event.text.text[0] == 'C' ||
-                   event.text.text[0] == 'v' || event.text.text[0] == 'V'))) {
-              // Append character
-              _input_text += event.text.text;
+                  (c == 'c' || c == 'C' || c == 'v' || c == 'V' || c == 'x' ||
+                   c == 'X' || c == 'a' || c == 'A'))) {
+              // Insert at the cursor
+              _input_buffer.insert(event.text.text);
               _render_input_text = true;
             }
           }
@@ -360,66 +786,148 @@ bool pixello::run()
         if (_text_input_on) {
           switch (event.type) {
             case SDL_KEYDOWN: {
-              // Handle backspace
-              if (event.key.keysym.sym == SDLK_BACKSPACE &&
-                  _input_text.length() > 0) {
-                // lop off character
-                _input_text.pop_back();
-                _render_input_text = true;
-              }
-              // Handle copy
-              else if (event.key.keysym.sym == SDLK_c &&
-                       SDL_GetModState() & KMOD_CTRL) {
-                SDL_SetClipboardText(_input_text.c_str());
-              }
-              // Handle paste
-              else if (event.key.keysym.sym == SDLK_v &&
-                       SDL_GetModState() & KMOD_CTRL) {
-                char* buffer = SDL_GetClipboardText();
-                _input_text = buffer;
-                SDL_free(buffer);
-                _render_input_text = true;
+              const bool ctrl = SDL_GetModState() & KMOD_CTRL;
+              const bool shift = SDL_GetModState() & KMOD_SHIFT;
+
+              switch (event.key.keysym.sym) {
+                // Editing, one code point at a time
+                case SDLK_BACKSPACE:
+                  _input_buffer.erase_back();
+                  _render_input_text = true;
+                  break;
+                case SDLK_DELETE:
+                  _input_buffer.erase_forward();
+                  _render_input_text = true;
+                  break;
+
+                // Cursor, with shift to select
+                case SDLK_LEFT:
+                  _input_buffer.move_left(shift);
+                  _render_input_text = true;
+                  break;
+                case SDLK_RIGHT:
+                  _input_buffer.move_right(shift);
+                  _render_input_text = true;
+                  break;
+                case SDLK_HOME:
+                  _input_buffer.move_home(shift);
+                  _render_input_text = true;
+                  break;
+                case SDLK_END:
+                  _input_buffer.move_end(shift);
+                  _render_input_text = true;
+                  break;
+
+                // Select all
+                case SDLK_a:
+                  if (ctrl) {
+                    _input_buffer.select_all();
+                    _render_input_text = true;
+                  }
+                  break;
+
+                // Copy the selection, or everything if there is none
+                case SDLK_c:
+                  if (ctrl) {
+                    const std::string text = _input_buffer.has_selection()
+                                                 ? _input_buffer.selected_text()
+                                                 : _input_buffer.str();
+                    SDL_SetClipboardText(text.c_str());
+                  }
+                  break;
+
+                // Cut
+                case SDLK_x:
+                  if (ctrl && _input_buffer.has_selection()) {
+                    const std::string text = _input_buffer.selected_text();
+                    SDL_SetClipboardText(text.c_str());
+                    _input_buffer.erase_back();
+                    _render_input_text = true;
+                  }
+                  break;
+
+                // Paste at the cursor
+                case SDLK_v:
+                  if (ctrl) {
+                    char* buffer = SDL_GetClipboardText();
+                    _input_buffer.insert(buffer);
+                    SDL_free(buffer);
+                    _render_input_text = true;
+                  }
+                  break;
               }
             }
           }
         }
       }
 
-      // Clear
-      const pixel_t& bg_color = _config.background_color;
-      SDL_SetRenderDrawColor(_renderer, bg_color.r, bg_color.g, bg_color.b,
-                             bg_color.a);
-      SDL_RenderClear(_renderer);
+      if (!read_frame_input()) { break; }
 
-      // Reset the viewport to entire window
-      // SDL_RenderSetViewport(_renderer, NULL);
+      update_pacing();
+
+      if (_config.retained_frame) {
+        begin_retained_frame();
+      } else {
+        // A target left set by the previous frame is dropped
+        if (_frame_target.is_valid()) {
+          set_target(_frame_target.pointer());
+          release_target(_render_target);
+        }
+
+        // Clear
+        set_draw_color(_config.background_color);
+        SDL_RenderClear(_renderer);
+        count_draw_call(NULL);
+
+        // Reset the viewport to entire window
+        set_viewport(NULL);
+      }
 
       // Set the alpha channel blend mode
-      SDL_SetRenderDrawBlendMode(_renderer, SDL_BLENDMODE_BLEND);
+      set_draw_blend(SDL_BLENDMODE_BLEND);
+
+      // Jobs that need the main thread, like uploads
+      _jobs->run_main_jobs();
+
+      // Release the sounds of the finished custom mixer voices
+      if (_audio_engine) { _audio_engine->collect(); }
+
+      // Close the voice counters of the previous frame
+      _voice_stats.total_played += _voice_stats.played;
+      _voice_stats.total_dropped += _voice_stats.dropped;
+      _voice_stats.total_stolen += _voice_stats.stolen;
+      _last_voice_stats = _voice_stats;
+      _voice_stats.played = 0;
+      _voice_stats.dropped = 0;
+      _voice_stats.stolen = 0;
 
       // USER UPDATE
+      const uint64_t update_start = SDL_GetPerformanceCounter();
       on_update(_external_data);
+      const uint64_t update_end = SDL_GetPerformanceCounter();
 
       // Reset mouse click state
       mouse_reset_clicks();
 
-      // DRAW
-      SDL_RenderPresent(_renderer);
+      // DRAW, a retained frame without damage is not presented
+      const bool changed = has_damage();
+      if (!_config.retained_frame || changed) { present_frame(); }
+      _in_frame = false;
+      close_frame_stats();
 
       // PERFORMANCE
       const uint64_t end = SDL_GetPerformanceCounter();
       const float freq = static_cast<float>(SDL_GetPerformanceFrequency());
       const float elapsed_s = (end - start) / freq;
-      const float sleep_for_s = _config.target_s_per_frame - elapsed_s;
-      const uint64_t sleep_for_ms =
-          static_cast<uint64_t>(sleep_for_s * 1000.0f);
 
-      // log("Sleep for: " + STR(sleep_for_ms) + "ms");
+      if (_frame_timing) {
+        *_frame_timing << _frame_index << ',' << dt * 1000.0f / freq << ','
+                       << (update_end - update_start) * 1000.0f / freq << ','
+                       << elapsed_s * 1000.0f << '\n';
+      }
+      ++_frame_index;
 
-      if (sleep_for_s > 0) { SDL_Delay(sleep_for_ms); }
-      //  else {
-      //   log("Frame too slow");
-      // }
+      if (!_player) { wait_next_frame(elapsed_s, !changed); }
 
       const float FPS_elapsed_s = (end - FPS_last_check) / freq;
       if (FPS_elapsed_s > 1.0f) {
@@ -440,148 +948,938 @@ bool pixello::run()
 }
 
 
-void pixello::draw_pixel(const int32_t x,
-                         const int32_t y,
-                         const pixel_t& p) const
+void pixello::update_pacing()
 {
-  SDL_Rect rect = {x * _config.pixel_size, y * _config.pixel_size,
-                   _config.pixel_size, _config.pixel_size};
-
-  SDL_SetRenderDrawColor(_renderer, p.r, p.g, p.b, p.a);
-  SDL_RenderFillRect(_renderer, &rect);
+  const bool input_idle =
+      _config.idle_timeout_s > 0.0f &&
+      SDL_GetTicks64() - _last_input_ms >=
+          static_cast<uint64_t>(_config.idle_timeout_s * 1000.0f);
+
+  if (_minimized) {
+    _pacing = pacing_t::MINIMIZED;
+  } else if (!_focused && _config.throttle_unfocused) {
+    _pacing = pacing_t::UNFOCUSED;
+  } else if (_app_idle) {
+    _pacing = pacing_t::APP_IDLE;
+  } else if (input_idle) {
+    _pacing = pacing_t::INPUT_IDLE;
+  } else {
+    _pacing = pacing_t::ACTIVE;
+  }
 }
 
 
-void pixello::draw_rect(const rect_t& rect, const pixel_t& p) const
+void pixello::wait_next_frame(const float elapsed_s, const bool undamaged)
 {
-  SDL_SetRenderDrawColor(_renderer, p.r, p.g, p.b, p.a);
-  SDL_RenderFillRect(_renderer, (SDL_Rect*)&rect);
-}
-
+  // Waiting for an event ends early on input, which stays queued for the
+  // next frame
+  const bool retained_idle = _config.retained_frame && undamaged &&
+                             _damage.w == 0 && !_full_damage;
+
+  if (_pacing == pacing_t::APP_IDLE) {
+    SDL_WaitEventTimeout(NULL, static_cast<int>(_config.idle_wait_ms));
+    return;
+  }
+  if (retained_idle) {
+    SDL_WaitEventTimeout(NULL, static_cast<int>(_config.retained_wait_ms));
+    return;
+  }
 
-void pixello::draw_rect_outline(const rect_t& rect, const pixel_t& p) const
-{
-  SDL_SetRenderDrawColor(_renderer, p.r, p.g, p.b, p.a);
-  SDL_RenderDrawRect(_renderer, (SDL_Rect*)&rect);
+  const bool throttled = _pacing != pacing_t::ACTIVE && _config.idle_fps > 0;
+  const float frame_s =
+      throttled ? 1.0f / _config.idle_fps : _config.target_s_per_frame;
+  const float sleep_for_s = frame_s - elapsed_s;
+  if (sleep_for_s <= 0) { return; }
+
+  const uint32_t sleep_for_ms = static_cast<uint32_t>(sleep_for_s * 1000.0f);
+  if (throttled) {
+    SDL_WaitEventTimeout(NULL, static_cast<int>(sleep_for_ms));
+  } else {
+    SDL_Delay(sleep_for_ms);
+  }
 }
 
 
-void pixello::draw_line(const point_t& a,
-                        const point_t& b,
-                        const pixel_t& p) const
+void pixello::update_frame_rect()
 {
-  SDL_SetRenderDrawColor(_renderer, p.r, p.g, p.b, p.a);
-  SDL_RenderDrawLine(_renderer, a.x, a.y, b.x, b.y);
+  int output_w, output_h;
+  int window_w, window_h;
+  SDL_GetRendererOutputSize(_renderer, &output_w, &output_h);
+  SDL_GetWindowSize(_window, &window_w, &window_h);
+
+  const int32_t lw = _config.width_in_pixels;
+  const int32_t lh = _config.height_in_pixels;
+
+  // Largest integer scale that fits, centered with black bars
+  _frame_scale = std::max(std::min(output_w / lw, output_h / lh), 1);
+  _frame_rect.w = lw * _frame_scale;
+  _frame_rect.h = lh * _frame_scale;
+  _frame_rect.x = (output_w - _frame_rect.w) / 2;
+  _frame_rect.y = (output_h - _frame_rect.h) / 2;
+  _output_per_window =
+      window_w > 0 ? static_cast<float>(output_w) / window_w : 1.0f;
 }
 
 
-void pixello::draw_dot(const point_t& a, const pixel_t& p) const
+void pixello::present_frame()
 {
-  SDL_SetRenderDrawColor(_renderer, p.r, p.g, p.b, p.a);
-  SDL_RenderDrawPoint(_renderer, a.x, a.y);
+  if (_retained_target.is_valid()) {
+    set_target(NULL);
+    set_viewport(NULL);
+    set_clip(NULL);
+
+    // The back buffer is undefined after a present, it gets the whole frame
+    SDL_RenderCopy(_renderer, _retained_target.pointer(), NULL, NULL);
+    count_draw_call(_retained_target.pointer());
+  } else if (_frame_target.is_valid()) {
+    set_target(NULL);
+    set_viewport(NULL);
+    set_clip(NULL);
+
+    // The window may have been resized
+    update_frame_rect();
+
+    set_draw_color(0x000000FF);
+    SDL_RenderClear(_renderer);
+    count_draw_call(NULL);
+    SDL_RenderCopy(_renderer, _frame_target.pointer(), NULL,
+                   (SDL_Rect*)&_frame_rect);
+    count_draw_call(_frame_target.pointer());
+  }
+
+  SDL_RenderPresent(_renderer);
+  ++_frame_stats.presents;
 }
 
 
-void pixello::draw_texture(const texture_t& t, const rect_t& rect) const
+SDL_Texture* pixello::frame_texture() const
 {
-  SDL_RenderCopy(_renderer, t.pointer(), NULL, (SDL_Rect*)&rect);
+  if (_frame_target.is_valid()) { return _frame_target.pointer(); }
+  if (_retained_target.is_valid()) { return _retained_target.pointer(); }
+  return NULL;
 }
 
 
-void pixello::draw_texture(const texture_t& t,
-                           const rect_t& rect,
-                           const rect_t& clip) const
+static rect_t rect_union(const rect_t& a, const rect_t& b)
 {
-  SDL_RenderCopy(_renderer, t.pointer(), (SDL_Rect*)&clip, (SDL_Rect*)&rect);
+  if (a.w <= 0 || a.h <= 0) { return b; }
+  if (b.w <= 0 || b.h <= 0) { return a; }
+
+  const int32_t x0 = std::min(a.x, b.x);
+  const int32_t y0 = std::min(a.y, b.y);
+  const int32_t x1 = std::max(a.x + a.w, b.x + b.w);
+  const int32_t y1 = std::max(a.y + a.h, b.y + b.h);
+  return {x0, y0, x1 - x0, y1 - y0};
 }
 
 
-void pixello::draw_texture(const texture_t& t,
-                           const int32_t x,
-                           const int32_t y) const
+// Empty, with a zero size, when they do not overlap
+static rect_t rect_intersection(const rect_t& a, const rect_t& b)
 {
-  const rect_t rect = {x, y, t.w, t.h};
-  draw_texture(t, rect);
+  const int32_t x0 = std::max(a.x, b.x);
+  const int32_t y0 = std::max(a.y, b.y);
+  const int32_t x1 = std::min(a.x + a.w, b.x + b.w);
+  const int32_t y1 = std::min(a.y + a.h, b.y + b.h);
+  return {x0, y0, std::max(x1 - x0, 0), std::max(y1 - y0, 0)};
 }
 
 
-void pixello::play_sound(const sound_t& sound) const
+rect_t pixello::frame_bounds() const
 {
-  (void)Mix_PlayChannel(-1, sound.pointer(), 0);
+  const texture_t& frame =
+      _frame_target.is_valid() ? _frame_target : _retained_target;
+  return {0, 0, frame.w, frame.h};
 }
 
-float pixello::set_sound_volume(const sound_t& sound, const float volume) const
+
+void pixello::invalidate(const rect_t& rect)
 {
-  if (volume >= 1.0f || volume <= .0f) {
-    throw input_exception("Invalid volume value: " + STR(volume));
+  // Outside of a frame, for the next one
+  if (!_in_frame) {
+    _damage = rect_union(_damage, rect);
+    return;
   }
 
-  const int V = static_cast<int>(MIX_MAX_VOLUME * volume);
-  const int old_volume = Mix_VolumeChunk(sound.pointer(), V);
+  const rect_t r = rect_intersection(rect, frame_bounds());
+  if (r.w == 0 || r.h == 0) { return; }
 
-  if (old_volume < 0 || old_volume > MIX_MAX_VOLUME) {
-    throw runtime_exception("Failed to configure the volume for the chunk");
+  _frame_damage = rect_union(_frame_damage, r);
+  clear_damage(r);
+}
+
+
+void pixello::invalidate()
+{
+  if (!_in_frame) {
+    _full_damage = true;
+    return;
   }
 
-  // Normalizing the value
-  const float result = old_volume / static_cast<float>(MIX_MAX_VOLUME);
-  return result;
+  invalidate(frame_bounds());
 }
 
-void pixello::set_master_volume(const float value) const
+
+void pixello::clear_damage(const rect_t& rect)
 {
-  if (value >= 1.0f || value <= .0f) {
-    throw input_exception("Invalid volume value: " + STR(value));
-  }
+  // On the frame, whatever target and viewport the app has set
+  read_view_state();
+  const render_state_t saved = _state;
+  const bool on_frame = !_render_target.is_valid();
 
-  // De-normalizing the value from range [0,1] to range [0, 128]
-  const int volume = static_cast<int>(MIX_MAX_VOLUME * value);
+  if (!on_frame) { set_target(frame_texture()); }
+  set_viewport(NULL);
+  set_clip(&rect);
 
-  (void)Mix_VolumeMusic(volume);
-  (void)Mix_Volume(-1, volume);
+  set_draw_blend(SDL_BLENDMODE_NONE);
+  set_draw_color(_config.background_color);
+  SDL_RenderFillRect(_renderer, (SDL_Rect*)&rect);
+  count_draw_call(NULL);
+  set_draw_blend(saved.blend_known ? saved.blend : SDL_BLENDMODE_BLEND);
+
+  if (!on_frame) { set_target(_render_target.pointer()); }
+  set_viewport(saved.has_viewport ? &saved.viewport : NULL);
+  if (on_frame) {
+    apply_clip(NULL);
+  } else {
+    set_clip(saved.has_clip ? &saved.clip : NULL);
+  }
 }
 
 
-void pixello::set_music_volume(const float value) const
+void pixello::apply_clip(const rect_t* clip) const
 {
-  if (value >= 1.0f || value <= .0f) {
-    throw input_exception("Invalid volume value: " + STR(value));
+  // Draws to a target of the app are not retained
+  if (!_config.retained_frame || _render_target.is_valid()) {
+    set_clip(clip);
+    return;
   }
 
-  // De-normalizing the value from range [0,1] to range [0, 128]
-  const int volume = static_cast<int>(MIX_MAX_VOLUME * value);
+  // The damage is in frame pixels, the clip relative to the viewport
+  read_view_state();
+  rect_t damage = _frame_damage;
+  if (_state.has_viewport) {
+    damage.x -= _state.viewport.x;
+    damage.y -= _state.viewport.y;
+  }
 
-  (void)Mix_VolumeMusic(volume);
+  const rect_t c = clip ? rect_intersection(*clip, damage) : damage;
+  set_clip(&c);
 }
 
 
-void pixello::set_sound_volume(const float value) const
+void pixello::begin_retained_frame()
 {
-  if (value >= 1.0f || value <= .0f) {
-    throw input_exception("Invalid volume value: " + STR(value));
+  // Without a logical resolution the frame is kept in a target of the
+  // output size, made again when the size changes
+  if (!_frame_target.is_valid()) {
+    int output_w, output_h;
+    SDL_GetRendererOutputSize(_renderer, &output_w, &output_h);
+
+    if (!_retained_target.is_valid() || _retained_target.w != output_w ||
+        _retained_target.h != output_h) {
+      release_target(_retained_target);
+      _retained_target = create_render_target(output_w, output_h);
+      SDL_SetTextureBlendMode(_retained_target.pointer(), SDL_BLENDMODE_NONE);
+      _full_damage = true;
+    }
   }
 
-  // De-normalizing the value from range [0,1] to range [0, 128]
-  const int volume = static_cast<int>(MIX_MAX_VOLUME * value);
+  // A target left set by the previous frame is dropped
+  set_target(frame_texture());
+  release_target(_render_target);
+  set_viewport(NULL);
 
-  (void)Mix_Volume(-1, volume);
-}
+  const rect_t pending = _full_damage ? frame_bounds() : _damage;
+  _damage = {0, 0, 0, 0};
+  _full_damage = false;
+  _frame_damage = {0, 0, 0, 0};
+  _in_frame = true;
 
+  // Nothing is drawn out of the damage, empty until something is invalidated
+  apply_clip(NULL);
+  if (pending.w > 0 && pending.h > 0) { invalidate(pending); }
+}
 
-// void pixello::set_current_viewport(const rect_t& rect, const pixel_t& c)
-// {
-//   // Set viewport
-//   SDL_RenderSetViewport(_renderer, (SDL_Rect*)&rect);
 
-//   // Set background color for view port
-//   SDL_Rect rect2 = {0, 0, rect.w, rect.h};
-//   SDL_SetRenderDrawColor(_renderer, c.r, c.g, c.b, c.a);
-//   SDL_RenderFillRect(_renderer, &rect2);
-// }
+/*******************************************************************************
+ * RENDER STATE
+ ******************************************************************************/
+
+void pixello::set_draw_color(const pixel_t& c) const
+{
+  if (_state.color_known && _state.color == c) {
+    ++_frame_stats.state_changes_skipped;
+    return;
+  }
+
+  SDL_SetRenderDrawColor(_renderer, c.r, c.g, c.b, c.a);
+  _state.color = c;
+  _state.color_known = true;
+  count_state();
+}
+
+
+void pixello::set_draw_blend(const int32_t mode) const
+{
+  if (_state.blend_known && _state.blend == mode) {
+    ++_frame_stats.state_changes_skipped;
+    return;
+  }
+
+  SDL_SetRenderDrawBlendMode(_renderer, static_cast<SDL_BlendMode>(mode));
+  _state.blend = mode;
+  _state.blend_known = true;
+  count_state();
+}
+
+
+int pixello::set_target(SDL_Texture* t) const
+{
+  if (_state.target_known && _state.target == t) {
+    ++_frame_stats.state_changes_skipped;
+    return 0;
+  }
+
+  const int result = SDL_SetRenderTarget(_renderer, t);
+  count_state();
+
+  // SDL resets the viewport and the clip rect with the target
+  _state.target_known = result == 0;
+  _state.target = t;
+  _state.viewport_known = false;
+  _state.clip_known = false;
+
+  return result;
+}
+
+
+void pixello::release_target(texture_t& t) const
+{
+  // Another texture can be created at the same address
+  if (t.is_valid() && t.pointer() == _state.target) {
+    _state.target_known = false;
+  }
+
+  t = texture_t();
+}
+
+
+void pixello::set_viewport(const rect_t* rect) const
+{
+  const bool has = rect != NULL;
+  if (_state.viewport_known && _state.has_viewport == has &&
+      (!has || _state.viewport == *rect)) {
+    ++_frame_stats.state_changes_skipped;
+    return;
+  }
+
+  SDL_RenderSetViewport(_renderer, (SDL_Rect*)rect);
+  _state.has_viewport = has;
+  if (has) { _state.viewport = *rect; }
+  _state.viewport_known = true;
+  count_state();
+}
+
+
+void pixello::set_clip(const rect_t* rect) const
+{
+  const bool has = rect != NULL;
+  if (_state.clip_known && _state.has_clip == has &&
+      (!has || _state.clip == *rect)) {
+    ++_frame_stats.state_changes_skipped;
+    return;
+  }
+
+  SDL_RenderSetClipRect(_renderer, (SDL_Rect*)rect);
+  _state.has_clip = has;
+  if (has) { _state.clip = *rect; }
+  _state.clip_known = true;
+  count_state();
+}
+
+
+void pixello::read_view_state() const
+{
+  if (!_state.viewport_known) {
+    SDL_Rect r;
+    SDL_RenderGetViewport(_renderer, &r);
+    _state.has_viewport = true;
+    _state.viewport = {r.x, r.y, r.w, r.h};
+    _state.viewport_known = true;
+  }
+
+  if (!_state.clip_known) {
+    SDL_Rect r = {0, 0, 0, 0};
+    _state.has_clip = SDL_RenderIsClipEnabled(_renderer);
+    if (_state.has_clip) { SDL_RenderGetClipRect(_renderer, &r); }
+    _state.clip = {r.x, r.y, r.w, r.h};
+    _state.clip_known = true;
+  }
+}
+
+
+void pixello::invalidate_render_state() const
+{
+  _state = render_state_t();
+}
+
+
+void pixello::set_texture_mod(const texture_t& t, const pixel_t& color) const
+{
+  sdl_texture_wrapper_t& w = *t._ptr;
+  if (w.mod == color) {
+    ++_frame_stats.state_changes_skipped;
+    return;
+  }
+
+  // Evicted, the mod is set again on upload
+  if (w.ptr == NULL) {
+    w.mod = color;
+    return;
+  }
+
+  // Alpha and color are separate on SDL
+  if (w.mod.r != color.r || w.mod.g != color.g || w.mod.b != color.b) {
+    SDL_SetTextureColorMod(w.ptr, color.r, color.g, color.b);
+    count_state();
+  }
+  if (w.mod.a != color.a) {
+    SDL_SetTextureAlphaMod(w.ptr, color.a);
+    count_state();
+  }
+
+  w.mod = color;
+}
+
+
+// Applies op to every counter of a, paired with the same counter of b
+template <typename A, typename B, typename Op>
+static void for_each_counter(A& a, const B& b, Op op)
+{
+  op(a.draw_calls, b.draw_calls);
+  op(a.state_changes, b.state_changes);
+  op(a.state_changes_skipped, b.state_changes_skipped);
+  op(a.texture_switches, b.texture_switches);
+  op(a.presents, b.presents);
+  op(a.texture_bytes_uploaded, b.texture_bytes_uploaded);
+  op(a.texture_bytes_created, b.texture_bytes_created);
+  op(a.texture_bytes_destroyed, b.texture_bytes_destroyed);
+  op(a.live_textures, b.live_textures);
+  op(a.live_texture_bytes, b.live_texture_bytes);
+  op(a.live_fonts, b.live_fonts);
+  op(a.live_sounds, b.live_sounds);
+  op(a.texture_budget, b.texture_budget);
+  op(a.managed_resident_bytes, b.managed_resident_bytes);
+  op(a.managed_evicted_bytes, b.managed_evicted_bytes);
+  op(a.texture_evictions, b.texture_evictions);
+  op(a.texture_reuploads, b.texture_reuploads);
+}
+
+
+void pixello::close_frame_stats()
+{
+  frame_stats_t& f = _frame_stats;
+  const resource_counters_t& r = *_resources;
+
+  // Evictions first, their bytes are destroyed in this frame
+  if (_residency) { _residency->end_frame(_frame_index, f); }
+
+  f.texture_bytes_created = r.texture_bytes_created - _bytes_created_mark;
+  f.texture_bytes_destroyed = r.texture_bytes_destroyed - _bytes_destroyed_mark;
+  _bytes_created_mark = r.texture_bytes_created;
+  _bytes_destroyed_mark = r.texture_bytes_destroyed;
+
+  f.live_textures = r.textures;
+  f.live_texture_bytes = r.texture_bytes_created - r.texture_bytes_destroyed;
+  f.live_fonts = r.fonts;
+  f.live_sounds = r.sounds;
+
+  // Ring of the last frames
+  const size_t window = std::max<uint32_t>(_config.frame_stats_window, 1);
+  if (_stats_history.size() < window) {
+    _stats_history.push_back(f);
+  } else {
+    _stats_history[_stats_next] = f;
+  }
+  _stats_next = (_stats_next + 1) % window;
+
+  _last_frame_stats = f;
+  _frame_stats = frame_stats_t();
+  _last_texture = NULL;
+}
+
+
+frame_stats_summary_t pixello::frame_stats_summary() const
+{
+  frame_stats_summary_t s;
+  s.frames = static_cast<uint32_t>(_stats_history.size());
+  if (s.frames == 0) { return s; }
+
+  s.min = _stats_history.front();
+  s.max = _stats_history.front();
+
+  for (const frame_stats_t& f : _stats_history) {
+    for_each_counter(s.min, f, [](auto& a, const auto b) {
+      a = std::min(a, b);
+    });
+    for_each_counter(s.max, f, [](auto& a, const auto b) {
+      a = std::max(a, b);
+    });
+    for_each_counter(s.avg, f, [](auto& a, const auto b) { a += b; });
+  }
+
+  const double n = s.frames;
+  for_each_counter(s.avg, s.avg, [n](auto& a, const auto) { a /= n; });
+
+  return s;
+}
+
+
+point_t pixello::window_to_logical(const int32_t x, const int32_t y) const
+{
+  const float ox = x * _output_per_window - _frame_rect.x;
+  const float oy = y * _output_per_window - _frame_rect.y;
+
+  // Clamped, the bars map to the nearest edge
+  const int32_t lx = static_cast<int32_t>(std::floor(ox / _frame_scale));
+  const int32_t ly = static_cast<int32_t>(std::floor(oy / _frame_scale));
+
+  return {std::clamp(lx, 0, _config.width_in_pixels - 1),
+          std::clamp(ly, 0, _config.height_in_pixels - 1)};
+}
+
+
+void pixello::draw_pixel(const int32_t x,
+                         const int32_t y,
+                         const pixel_t& p) const
+{
+  // The logical frame is already at pixel resolution
+  const int32_t size = _frame_target.is_valid() ? 1 : _config.pixel_size;
+  SDL_Rect rect = {x * size, y * size, size, size};
+
+  set_draw_color(p);
+  SDL_RenderFillRect(_renderer, &rect);
+  count_draw_call(NULL);
+}
+
+
+void pixello::draw_rect(const rect_t& rect, const pixel_t& p) const
+{
+  set_draw_color(p);
+  SDL_RenderFillRect(_renderer, (SDL_Rect*)&rect);
+  count_draw_call(NULL);
+}
+
+
+void pixello::draw_rect_outline(const rect_t& rect, const pixel_t& p) const
+{
+  set_draw_color(p);
+  SDL_RenderDrawRect(_renderer, (SDL_Rect*)&rect);
+  count_draw_call(NULL);
+}
+
+
+void pixello::draw_line(const point_t& a,
+                        const point_t& b,
+                        const pixel_t& p) const
+{
+  set_draw_color(p);
+  SDL_RenderDrawLine(_renderer, a.x, a.y, b.x, b.y);
+  count_draw_call(NULL);
+}
+
+
+void pixello::draw_dot(const point_t& a, const pixel_t& p) const
+{
+  set_draw_color(p);
+  SDL_RenderDrawPoint(_renderer, a.x, a.y);
+  count_draw_call(NULL);
+}
+
+
+void pixello::draw_texture(const texture_t& t, const rect_t& rect) const
+{
+  SDL_Texture* texture = use_texture(t);
+  SDL_RenderCopy(_renderer, texture, NULL, (SDL_Rect*)&rect);
+  count_draw_call(texture);
+}
+
+
+void pixello::draw_texture(const texture_t& t,
+                           const rect_t& rect,
+                           const rect_t& clip) const
+{
+  SDL_Texture* texture = use_texture(t);
+  SDL_RenderCopy(_renderer, texture, (SDL_Rect*)&clip, (SDL_Rect*)&rect);
+  count_draw_call(texture);
+}
+
+
+void pixello::draw_texture(const texture_t& t,
+                           const int32_t x,
+                           const int32_t y) const
+{
+  const rect_t rect = {x, y, t.w, t.h};
+  draw_texture(t, rect);
+}
+
+
+void pixello::draw_texture(const sub_texture_t& t,
+                           const int32_t x,
+                           const int32_t y) const
+{
+  const rect_t rect = {x, y, t.clip.w, t.clip.h};
+  draw_texture(t.page, rect, t.clip);
+}
+
+
+void pixello::draw_texture(const sub_texture_t& t, const rect_t& rect) const
+{
+  draw_texture(t.page, rect, t.clip);
+}
+
+
+int pixello::pick_channel(const sound_t& sound) const
+{
+  const sdl_sound_wrapper_t& s = *sound._ptr;
+  const int count = static_cast<int>(_channels.size());
+
+  int free_channel = -1;
+  int instances = 0;
+  int oldest_instance = -1;
+
+  for (int i = 0; i < count; ++i) {
+    channel_t& ch = _channels[i];
+
+    // Forget the channels that finished playing
+    if (ch.chunk && !Mix_Playing(i)) { ch.chunk = NULL; }
+
+    if (!ch.chunk) {
+      if (free_channel < 0) { free_channel = i; }
+      continue;
+    }
+
+    if (ch.chunk == s.chunk_ptr) {
+      ++instances;
+      if (oldest_instance < 0 || ch.seq < _channels[oldest_instance].seq) {
+        oldest_instance = i;
+      }
+    }
+  }
+
+  const voice_steal_t policy = _config.voice_stealing;
+
+  // Over the cap the sound restarts its own oldest instance
+  if (s.max_instances > 0 && instances >= s.max_instances) {
+    if (policy == voice_steal_t::NONE) { return -1; }
+
+    ++_voice_stats.stolen;
+    return oldest_instance;
+  }
+
+  if (free_channel >= 0) { return free_channel; }
+
+  if (policy == voice_steal_t::NONE) { return -1; }
+
+  // Lowest priority first, then the policy decides
+  int victim = -1;
+  int victim_volume = 0;
+
+  for (int i = 0; i < count; ++i) {
+    const channel_t& ch = _channels[i];
+    if (ch.priority > s.priority) { continue; }
+
+    const int volume = Mix_Volume(i, -1) * ch.chunk->volume;
+
+    if (victim >= 0) {
+      const channel_t& v = _channels[victim];
+
+      if (ch.priority > v.priority) { continue; }
+
+      if (ch.priority == v.priority) {
+        const bool better = policy == voice_steal_t::OLDEST
+                                ? ch.seq < v.seq
+                                : volume < victim_volume;
+        if (!better) { continue; }
+      }
+    }
+
+    victim = i;
+    victim_volume = volume;
+  }
+
+  if (victim >= 0) { ++_voice_stats.stolen; }
+
+  return victim;
+}
+
+
+void pixello::play_sound(const sound_t& sound) const
+{
+  require_audio();
+
+  const int channel = pick_channel(sound);
+
+  if (channel < 0) {
+    ++_voice_stats.dropped;
+    return;
+  }
+
+  (void)Mix_HaltChannel(channel);
+
+  if (Mix_PlayChannel(channel, sound.pointer(), 0) < 0) {
+    ++_voice_stats.dropped;
+    _channels[channel].chunk = NULL;
+    return;
+  }
+
+  channel_t& ch = _channels[channel];
+  ch.chunk = sound.pointer();
+  ch.priority = sound._ptr->priority;
+  ch.seq = _channel_seq++;
+
+  ++_voice_stats.played;
+}
+
+float pixello::set_sound_volume(const sound_t& sound, const float volume) const
+{
+  require_audio();
+
+  if (volume >= 1.0f || volume <= .0f) {
+    throw input_exception("Invalid volume value: " + STR(volume));
+  }
+
+  const int V = static_cast<int>(MIX_MAX_VOLUME * volume);
+  const int old_volume = Mix_VolumeChunk(sound.pointer(), V);
+
+  if (old_volume < 0 || old_volume > MIX_MAX_VOLUME) {
+    throw runtime_exception("Failed to configure the volume for the chunk");
+  }
+
+  // Normalizing the value
+  const float result = old_volume / static_cast<float>(MIX_MAX_VOLUME);
+  return result;
+}
+
+bool pixello::play_voice(const sound_t& sound, const float gain) const
+{
+  require_audio();
+
+  if (gain < .0f) {
+    throw input_exception("Invalid voice gain: " + STR(gain));
+  }
+
+  return _audio_engine->play(sound, gain);
+}
+
+
+audio_stats_t pixello::audio_stats() const
+{
+  if (!_audio_ready) { return audio_stats_t(); }
+  return _audio_engine->stats();
+}
+
+
+void pixello::set_master_volume(const float value) const
+{
+  require_audio();
+
+  if (value >= 1.0f || value <= .0f) {
+    throw input_exception("Invalid volume value: " + STR(value));
+  }
+
+  // De-normalizing the value from range [0,1] to range [0, 128]
+  const int volume = static_cast<int>(MIX_MAX_VOLUME * value);
+
+  (void)Mix_VolumeMusic(volume);
+  (void)Mix_Volume(-1, volume);
+}
+
+
+void pixello::set_music_volume(const float value) const
+{
+  require_audio();
+
+  if (value >= 1.0f || value <= .0f) {
+    throw input_exception("Invalid volume value: " + STR(value));
+  }
+
+  // De-normalizing the value from range [0,1] to range [0, 128]
+  const int volume = static_cast<int>(MIX_MAX_VOLUME * value);
+
+  (void)Mix_VolumeMusic(volume);
+}
+
+
+void pixello::set_sound_volume(const float value) const
+{
+  require_audio();
+
+  if (value >= 1.0f || value <= .0f) {
+    throw input_exception("Invalid volume value: " + STR(value));
+  }
+
+  // De-normalizing the value from range [0,1] to range [0, 128]
+  const int volume = static_cast<int>(MIX_MAX_VOLUME * value);
+
+  (void)Mix_Volume(-1, volume);
+}
+
+
+void pixello::set_current_viewport(const rect_t& rect, const pixel_t& c) const
+{
+  // Set viewport
+  set_viewport(&rect);
+  apply_clip(NULL);
+
+  // Set background color for view port
+  SDL_Rect rect2 = {0, 0, rect.w, rect.h};
+  set_draw_color(c);
+  SDL_RenderFillRect(_renderer, &rect2);
+  count_draw_call(NULL);
+}
+
+
+void pixello::reset_viewport() const
+{
+  set_viewport(NULL);
+  apply_clip(NULL);
+}
+
+
+void pixello::draw_geometry(const std::vector<vertex_t>& vertices,
+                            const std::vector<int>& indices,
+                            const texture_t& t) const
+{
+  if (vertices.empty()) { return; }
+
+  SDL_Texture* texture = t.is_valid() ? use_texture(t) : NULL;
+  const int* idx = indices.empty() ? NULL : indices.data();
+
+  SDL_RenderGeometry(_renderer, texture, (SDL_Vertex*)vertices.data(),
+                     static_cast<int>(vertices.size()), idx,
+                     static_cast<int>(indices.size()));
+  count_draw_call(texture);
+}
+
+
+void pixello::flush_batch(SDL_Texture* texture) const
+{
+  if (_batch_indices.empty()) { return; }
+
+  SDL_RenderGeometry(_renderer, texture, (SDL_Vertex*)_batch_vertices.data(),
+                     static_cast<int>(_batch_vertices.size()),
+                     _batch_indices.data(),
+                     static_cast<int>(_batch_indices.size()));
+  count_draw_call(texture);
+
+  _batch_vertices.clear();
+  _batch_indices.clear();
+}
+
+
+void pixello::submit(const draw_list_t& list, const view_t& view) const
+{
+  // The caller's viewport and clip, put back at the end
+  read_view_state();
+  const render_state_t saved = _state;
+
+  const rect_t& vp = view.viewport;
+  set_viewport(&vp);
+
+  // The clip rect is relative to the viewport
+  const rect_t clip = {0, 0, vp.w, vp.h};
+  apply_clip(&clip);
+
+  float bx0, by0, bx1, by1;
+  view.visible_bounds(bx0, by0, bx1, by1);
+
+  const camera_t& cam = view.camera;
+  const float c = cosf(cam.rotation) * cam.zoom;
+  const float s = sinf(cam.rotation) * cam.zoom;
+  const float ox = vp.w * 0.5f;
+  const float oy = vp.h * 0.5f;
+
+  _batch_vertices.clear();
+  _batch_indices.clear();
+
+  uint32_t current = draw_list_t::NO_TEXTURE;
+  SDL_Texture* current_ptr = NULL;
+  float inv_w = 0.0f;
+  float inv_h = 0.0f;
+
+  for (const auto& cmd : list.commands()) {
+    // Cull against the world box seen by the camera
+    if (cmd.x > bx1 || cmd.y > by1 || cmd.x + cmd.w < bx0 ||
+        cmd.y + cmd.h < by0) {
+      continue;
+    }
+
+    // A new texture closes the batch
+    if (cmd.texture != current) {
+      flush_batch(current_ptr);
+      current = cmd.texture;
+
+      if (current == draw_list_t::NO_TEXTURE) {
+        current_ptr = NULL;
+      } else {
+        const texture_t& t = list.texture(current);
+        current_ptr = use_texture(t);
+        inv_w = 1.0f / t.w;
+        inv_h = 1.0f / t.h;
+      }
+    }
+
+    float u0 = 0.0f, v0 = 0.0f, u1 = 0.0f, v1 = 0.0f;
+    if (current_ptr) {
+      u0 = cmd.clip.x * inv_w;
+      v0 = cmd.clip.y * inv_h;
+      u1 = (cmd.clip.x + cmd.clip.w) * inv_w;
+      v1 = (cmd.clip.y + cmd.clip.h) * inv_h;
+    }
+
+    // Top left corner and the two transformed edges
+    const float dx = cmd.x - cam.x;
+    const float dy = cmd.y - cam.y;
+    const float px = ox + dx * c - dy * s;
+    const float py = oy + dx * s + dy * c;
+    const float ex_x = cmd.w * c;
+    const float ex_y = cmd.w * s;
+    const float ey_x = -cmd.h * s;
+    const float ey_y = cmd.h * c;
+
+    const pixel_t& col = cmd.color;
+    const int base = static_cast<int>(_batch_vertices.size());
+
+    _batch_vertices.push_back({px, py, col.r, col.g, col.b, col.a, u0, v0});
+    _batch_vertices.push_back(
+        {px + ex_x, py + ex_y, col.r, col.g, col.b, col.a, u1, v0});
+    _batch_vertices.push_back({px + ex_x + ey_x, py + ex_y + ey_y, col.r, col.g,
+                               col.b, col.a, u1, v1});
+    _batch_vertices.push_back(
+        {px + ey_x, py + ey_y, col.r, col.g, col.b, col.a, u0, v1});
+
+    _batch_indices.push_back(base);
+    _batch_indices.push_back(base + 1);
+    _batch_indices.push_back(base + 2);
+    _batch_indices.push_back(base);
+    _batch_indices.push_back(base + 2);
+    _batch_indices.push_back(base + 3);
+  }
+
+  flush_batch(current_ptr);
+
+  // The clip is relative to the viewport, it goes back after it
+  set_viewport(saved.has_viewport ? &saved.viewport : NULL);
+  set_clip(saved.has_clip ? &saved.clip : NULL);
+}
 
 
 void pixello::play_music(const music_t& music) const
 {
+  require_audio();
+  unhook_music_stream();
+
   const int result = Mix_PlayMusic(music.pointer(), -1);
 
   if (result == -1) {
@@ -593,36 +1891,123 @@ void pixello::play_music(const music_t& music) const
 
 void pixello::pause_sounds() const
 {
+  if (!_audio_ready) { return; }
+
   Mix_Pause(-1);
 }
 
 
 void pixello::resume_sounds() const
 {
+  if (!_audio_ready) { return; }
+
   Mix_Resume(-1);
 }
 
 
 void pixello::pause_music() const
 {
+  if (!_audio_ready) { return; }
+
   Mix_PauseMusic();
+  _audio_engine->pause_streams(true);
 }
 
 
 void pixello::resume_music() const
 {
+  if (!_audio_ready) { return; }
+
   Mix_ResumeMusic();
+  _audio_engine->pause_streams(false);
 }
 
 
 void pixello::stop_music() const
 {
+  if (!_audio_ready) { return; }
+
+  (void)Mix_HaltMusic();
+  _audio_engine->stop_streams(.0f);
+}
+
+
+void pixello::play_music_stream(const std::string& path,
+                                const float crossfade_s,
+                                const bool loop) const
+{
+  require_audio();
+
+  if (crossfade_s < .0f) {
+    throw input_exception("Invalid crossfade: " + STR(crossfade_s));
+  }
+
+  _audio_engine->play_stream(path, _config.music_stream_buffer_ms,
+                             crossfade_s, loop);
+
+  if (_music_hooked) { return; }
+
+  // The hook replaces the SDL_mixer music player
   (void)Mix_HaltMusic();
+  Mix_HookMusic(
+      [](void* udata, Uint8* stream, int len) {
+        static_cast<audio_engine_t*>(udata)->music(stream, len);
+      },
+      _audio_engine.get());
+  _music_hooked = true;
+}
+
+
+void pixello::stop_music_stream(const float fade_s) const
+{
+  if (!_music_hooked) { return; }
+
+  if (fade_s < .0f) { throw input_exception("Invalid fade: " + STR(fade_s)); }
+
+  _audio_engine->stop_streams(fade_s);
+}
+
+
+music_stream_stats_t pixello::music_stream_stats() const
+{
+  if (!_music_hooked) { return music_stream_stats_t(); }
+  return _audio_engine->stream_stats();
+}
+
+
+void pixello::unhook_music_stream() const
+{
+  if (!_music_hooked) { return; }
+
+  // Once removed the hook is not running, the streams can go right away
+  Mix_HookMusic(NULL, NULL);
+  _audio_engine->reset_streams();
+  _music_hooked = false;
+}
+
+
+texture_t pixello::wrap_texture(SDL_Texture* ptr) const
+{
+  texture_t t;
+  t._ptr = std::make_shared<sdl_texture_wrapper_t>(ptr);
+
+  Uint32 format;
+  SDL_QueryTexture(ptr, &format, NULL, &t.w, &t.h);
+
+  sdl_texture_wrapper_t& w = *t._ptr;
+  w.counters = _resources;
+  w.bytes = static_cast<uint64_t>(t.w) * t.h * SDL_BYTESPERPIXEL(format);
+  _resources->texture_bytes_created += w.bytes;
+  ++_resources->textures;
+
+  return t;
 }
 
 
 texture_t pixello::load_image(const std::string& img_path) const
 {
+  require_image();
+
   SDL_Texture* tmp_ptr = IMG_LoadTexture(_renderer, img_path.c_str());
 
   if (!tmp_ptr) {
@@ -630,15 +2015,355 @@ texture_t pixello::load_image(const std::string& img_path) const
                           "! SDL Error: " + std::string(IMG_GetError()));
   }
 
-  texture_t t;
-  t._ptr = std::make_shared<sdl_texture_wrapper_t>(tmp_ptr);
+  return wrap_texture(tmp_ptr);
+}
+
+
+image_t pixello::load_image_data(const std::string& img_path) const
+{
+  require_image();
+
+  SDL_Surface* surface = IMG_Load(img_path.c_str());
+
+  if (!surface) {
+    throw load_exceptions("Unable to load image: " + img_path +
+                          "! SDL Error: " + std::string(IMG_GetError()));
+  }
+
+  try {
+    image_t image = image_t::from_surface(surface);
+    SDL_FreeSurface(surface);
+    return image;
+  } catch (...) {
+    SDL_FreeSurface(surface);
+    throw;
+  }
+}
+
+
+void pixello::save_image(const image_t& image, const std::string& path) const
+{
+  if (!image.is_valid()) { throw input_exception("Saving an empty image"); }
+
+  // The surface only borrows the pixels
+  SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormatFrom(
+      (void*)image.data(), image.w(), image.h(), 32,
+      image.stride() * static_cast<int>(sizeof(pixel_t)),
+      SDL_PIXELFORMAT_RGBA8888);
+
+  if (!surface) {
+    throw runtime_exception("Failed to create the image surface! "
+                            "SDL Error: " +
+                            std::string(SDL_GetError()));
+  }
+
+  const bool bmp = path.size() >= 4 &&
+                   (path.compare(path.size() - 4, 4, ".bmp") == 0 ||
+                    path.compare(path.size() - 4, 4, ".BMP") == 0);
+
+  int result;
+  if (bmp) {
+    result = SDL_SaveBMP(surface, path.c_str());
+  } else {
+    require_image();
+    result = IMG_SavePNG(surface, path.c_str());
+  }
+  SDL_FreeSurface(surface);
+
+  if (result != 0) {
+    throw runtime_exception("Unable to save image: " + path +
+                            "! SDL Error: " + std::string(SDL_GetError()));
+  }
+}
+
+
+texture_t pixello::upload(const image_t& image, const bool premultiplied) const
+{
+  if (!image.is_valid()) { throw input_exception("Uploading an empty image"); }
+
+  SDL_Texture* tmp_ptr =
+      SDL_CreateTexture(_renderer, SDL_PIXELFORMAT_RGBA8888,
+                        SDL_TEXTUREACCESS_STATIC, image.w(), image.h());
+
+  if (!tmp_ptr) {
+    throw load_exceptions("Failed to create the image texture! " +
+                          std::string(SDL_GetError()));
+  }
+
+  texture_t t = wrap_texture(tmp_ptr);
 
-  SDL_QueryTexture(t._ptr.get()->ptr, NULL, NULL, &t.w, &t.h);
+  const int pitch = image.stride() * static_cast<int>(sizeof(pixel_t));
+  if (SDL_UpdateTexture(tmp_ptr, NULL, image.data(), pitch) != 0) {
+    throw load_exceptions("Failed to upload the image! " +
+                          std::string(SDL_GetError()));
+  }
+  count_upload(static_cast<uint64_t>(pitch) * image.h());
+
+  // dst = src + dst * (1 - src alpha) for premultiplied colors
+  const SDL_BlendMode mode =
+      premultiplied
+          ? SDL_ComposeCustomBlendMode(
+                SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
+                SDL_BLENDOPERATION_ADD, SDL_BLENDFACTOR_ONE,
+                SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD)
+          : SDL_BLENDMODE_BLEND;
+  SDL_SetTextureBlendMode(tmp_ptr, mode);
+
+  return t;
+}
+
+
+texture_t pixello::upload_managed(image_t image,
+                                  const int32_t priority,
+                                  const bool premultiplied) const
+{
+  if (!_residency) {
+    throw runtime_exception("Managed textures need the renderer");
+  }
 
+  texture_t t = upload(image, premultiplied);
+  _residency->add(t, std::make_shared<image_t>(std::move(image)), priority);
   return t;
 }
 
 
+texture_t pixello::load_managed_image(const std::string& img_path,
+                                      const int32_t priority) const
+{
+  return upload_managed(load_image_data(img_path), priority);
+}
+
+
+void pixello::set_texture_priority(const texture_t& t,
+                                   const int32_t priority) const
+{
+  t._ptr->priority = priority;
+}
+
+
+void pixello::set_texture_budget(const uint64_t bytes)
+{
+  _config.texture_budget_bytes = bytes;
+  if (_residency) { _residency->set_budget(bytes); }
+}
+
+
+void pixello::make_resident(sdl_texture_wrapper_t& w) const
+{
+  count_upload(_residency->make_resident(w, _frame_index));
+}
+
+
+atlas_t pixello::load_atlas(const std::vector<std::string>& img_paths,
+                            const int32_t page_size,
+                            const int32_t padding) const
+{
+  if (page_size < 1) {
+    throw input_exception("Invalid atlas page size: " + STR(page_size));
+  }
+  if (padding < 0) {
+    throw input_exception("Invalid atlas padding: " + STR(padding));
+  }
+
+  require_image();
+
+  using surface_ptr = std::unique_ptr<SDL_Surface, decltype(&SDL_FreeSurface)>;
+
+  struct entry_t
+  {
+    const std::string* path;
+    surface_ptr surface;
+    size_t page;
+    rect_t rect;
+  };
+
+  // Decode all the images on the CPU side first
+  std::vector<entry_t> images;
+  images.reserve(img_paths.size());
+
+  for (const auto& path : img_paths) {
+    surface_ptr surface(IMG_Load(path.c_str()), &SDL_FreeSurface);
+
+    if (!surface) {
+      throw load_exceptions("Unable to load image for the atlas: " + path +
+                            "! SDL Error: " + std::string(IMG_GetError()));
+    }
+
+    if (surface->w + 2 * padding > page_size ||
+        surface->h + 2 * padding > page_size) {
+      throw load_exceptions("Image " + path + " is bigger than the atlas page");
+    }
+
+    images.push_back({&path, std::move(surface), 0, {0, 0, 0, 0}});
+  }
+
+  // Tallest first gives a flatter skyline
+  std::sort(images.begin(), images.end(),
+            [](const entry_t& a, const entry_t& b) {
+              if (a.surface->h != b.surface->h) {
+                return a.surface->h > b.surface->h;
+              }
+              return a.surface->w > b.surface->w;
+            });
+
+  std::vector<skyline_packer_t> packers;
+
+  for (auto& e : images) {
+    const int32_t w = e.surface->w + 2 * padding;
+    const int32_t h = e.surface->h + 2 * padding;
+
+    rect_t r;
+    size_t page = 0;
+    while (page < packers.size() && !packers[page].pack(w, h, r)) { ++page; }
+
+    if (page == packers.size()) {
+      packers.emplace_back(page_size, page_size);
+      (void)packers.back().pack(w, h, r);
+    }
+
+    e.page = page;
+    e.rect = {r.x + padding, r.y + padding, e.surface->w, e.surface->h};
+  }
+
+  // Compose the pages and upload them
+  atlas_t atlas;
+  atlas.pages.reserve(packers.size());
+
+  for (size_t page = 0; page < packers.size(); ++page) {
+    // Cut to what was packed, a few icons do not need a full page
+    const skyline_packer_t& packer = packers[page];
+    surface_ptr page_surface(
+        SDL_CreateRGBSurfaceWithFormat(0, packer.used_width(),
+                                       packer.used_height(), 32,
+                                       SDL_PIXELFORMAT_RGBA32),
+        &SDL_FreeSurface);
+
+    if (!page_surface) {
+      throw load_exceptions("Failed to create the atlas page surface! "
+                            "SDL Error: " +
+                            std::string(SDL_GetError()));
+    }
+
+    for (auto& e : images) {
+      if (e.page != page) { continue; }
+
+      // Copy the pixels as they are, alpha included
+      SDL_SetSurfaceBlendMode(e.surface.get(), SDL_BLENDMODE_NONE);
+      SDL_Rect dst = {e.rect.x, e.rect.y, e.rect.w, e.rect.h};
+      SDL_BlitSurface(e.surface.get(), NULL, page_surface.get(), &dst);
+    }
+
+    SDL_Texture* tmp_ptr =
+        SDL_CreateTextureFromSurface(_renderer, page_surface.get());
+
+    if (!tmp_ptr) {
+      throw load_exceptions("Failed to create the atlas page texture! "
+                            "SDL Error: " +
+                            std::string(SDL_GetError()));
+    }
+
+    SDL_SetTextureBlendMode(tmp_ptr, SDL_BLENDMODE_BLEND);
+
+    atlas.pages.push_back(wrap_texture(tmp_ptr));
+  }
+
+  for (const auto& e : images) {
+    atlas.entries[*e.path] = {atlas.pages[e.page], e.rect};
+  }
+
+  return atlas;
+}
+
+
+sub_texture_t pixello::create_sub_texture(const texture_t& t,
+                                          const rect_t& clip) const
+{
+  if (clip.x < 0 || clip.y < 0 || clip.x + clip.w > t.w ||
+      clip.y + clip.h > t.h) {
+    throw input_exception("Sub texture clip is outside of the texture");
+  }
+
+  sub_texture_t result;
+  result.page = t;
+  result.clip = clip;
+
+  return result;
+}
+
+
+texture_t pixello::create_render_target(const int32_t w,
+                                        const int32_t h) const
+{
+  if (w < 1 || h < 1) {
+    throw input_exception("Invalid render target size: " + STR(w) + "x" +
+                          STR(h));
+  }
+
+  SDL_Texture* tmp_ptr = SDL_CreateTexture(_renderer, SDL_PIXELFORMAT_RGBA8888,
+                                           SDL_TEXTUREACCESS_TARGET, w, h);
+
+  if (!tmp_ptr) {
+    throw load_exceptions("Failed to create the render target! SDL Error: " +
+                          std::string(SDL_GetError()));
+  }
+
+  SDL_SetTextureBlendMode(tmp_ptr, SDL_BLENDMODE_BLEND);
+
+  return wrap_texture(tmp_ptr);
+}
+
+
+texture_t pixello::create_streaming_texture(const int32_t w,
+                                           const int32_t h) const
+{
+  if (w < 1 || h < 1) {
+    throw input_exception("Invalid streaming texture size: " + STR(w) + "x" +
+                          STR(h));
+  }
+
+  SDL_Texture* tmp_ptr = SDL_CreateTexture(_renderer, SDL_PIXELFORMAT_ARGB8888,
+                                           SDL_TEXTUREACCESS_STREAMING, w, h);
+
+  if (!tmp_ptr) {
+    throw load_exceptions("Failed to create the streaming texture! " +
+                          std::string(SDL_GetError()));
+  }
+
+  return wrap_texture(tmp_ptr);
+}
+
+
+void pixello::set_render_target(const texture_t& t) const
+{
+  if (set_target(t.pointer()) != 0) {
+    throw runtime_exception("Failed to set the render target! SDL Error: " +
+                            std::string(SDL_GetError()));
+  }
+
+  if (_render_target._ptr != t._ptr) { release_target(_render_target); }
+  _render_target = t;
+}
+
+
+void pixello::reset_render_target() const
+{
+  // Back to the low res or retained frame when there is one
+  set_target(frame_texture());
+  release_target(_render_target);
+
+  // The target change dropped the damage clip
+  apply_clip(NULL);
+}
+
+
+void pixello::clear_render_target(const pixel_t& color) const
+{
+  set_draw_color(color);
+  SDL_RenderClear(_renderer);
+  count_draw_call(NULL);
+}
+
+
 texture_t pixello::create_text(const std::string& text,
                                const pixel_t& color,
                                const font_t& font) const
@@ -668,22 +2393,17 @@ texture_t pixello::create_text(const std::string& text,
                           " Error: " + std::string(TTF_GetError()));
   }
 
-  texture_t t;
-  t._ptr = std::make_shared<sdl_texture_wrapper_t>(tmp);
-
-  // Get image dimensions
-  t.w = txt_surface->w;
-  t.h = txt_surface->h;
-
   // Get rid of old surface
   SDL_FreeSurface(txt_surface);
 
-  return t;
+  return wrap_texture(tmp);
 }
 
 
 sound_t pixello::load_sound(const std::string& sound_path) const
 {
+  require_audio();
+
   auto tmp = Mix_LoadWAV(sound_path.c_str());
 
   if (!tmp) {
@@ -693,6 +2413,8 @@ sound_t pixello::load_sound(const std::string& sound_path) const
 
   sound_t sound;
   sound._ptr = std::make_shared<sdl_sound_wrapper_t>(tmp);
+  sound._ptr->counters = _resources;
+  ++_resources->sounds;
 
   return sound;
 }
@@ -700,6 +2422,8 @@ sound_t pixello::load_sound(const std::string& sound_path) const
 
 music_t pixello::load_music(const std::string& music_path) const
 {
+  require_audio();
+
   auto tmp = Mix_LoadMUS(music_path.c_str());
 
   if (!tmp) {
@@ -709,6 +2433,8 @@ music_t pixello::load_music(const std::string& music_path) const
 
   music_t music;
   music._ptr = std::make_shared<sdl_sound_wrapper_t>(tmp);
+  music._ptr->counters = _resources;
+  ++_resources->sounds;
 
   return music;
 }
@@ -726,10 +2452,33 @@ bool pixello::is_mouse_in(const rect_t& rect) const
 void pixello::draw_circle(const int32_t x,
                           const int32_t y,
                           const int32_t r,
-                          const pixel_t& color) const
+                          const pixel_t& color,
+                          const bool antialias) const
+{
+  if (!_circle_batch) { _circle_batch = std::make_shared<shape_batch_t>(); }
+
+  _circle_batch->clear();
+  _circle_batch->set_antialias(antialias);
+  // Centered on the pixel and covering it, like the SDL2_gfx circles
+  _circle_batch->add_circle(x + 0.5f, y + 0.5f, r + 0.5f, color);
+  _circle_batch->draw(*this);
+}
+
+
+#ifdef PIXELLO_HAS_SDL2_GFX
+void pixello::draw_circle_gfx(const int32_t x,
+                              const int32_t y,
+                              const int32_t r,
+                              const pixel_t& color) const
 {
   filledCircleRGBA(_renderer, x, y, r, color.r, color.g, color.b, color.a);
+  count_draw_call(NULL);
+
+  // SDL2_gfx sets the color and the blend mode on its own
+  _state.color_known = false;
+  _state.blend_known = false;
 }
+#endif
 
 
 button_t pixello::create_button(const rect_t& rect,
@@ -791,13 +2540,9 @@ void pixello::mouse_set_FPS_mode(const bool enable) const
 
 bool pixello::is_key_pressed(const keycap_t k) const
 {
+  // Snapshot of the frame, so a replay sees the recorded keys
   const int index = static_cast<int>(k);
-  const SDL_Scancode code = KEYCAP_MAP[index];
-  const Uint8* current_key_states = SDL_GetKeyboardState(NULL);
-
-  const bool result = static_cast<bool>(current_key_states[code]);
-
-  return result;
+  return (_keys >> index) & 1;
 }
 
 
@@ -813,6 +2558,8 @@ font_t pixello::load_font(const std::string& path,
                           STR(size_in_pixels));
   }
 
+  require_ttf();
+
   // Load the font id required
   TTF_Font* f = TTF_OpenFont(path.c_str(), size_in_pixels);
 
@@ -826,6 +2573,8 @@ font_t pixello::load_font(const std::string& path,
 
   font_t font;
   font._ptr = std::make_shared<std_font_wrapper_t>(f);
+  font._ptr->counters = _resources;
+  ++_resources->fonts;
 
   return font;
 }
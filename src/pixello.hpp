@@ -2,9 +2,13 @@
 
 #include <inttypes.h>
 #include <exception>
+#include <iosfwd>
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <unordered_map>
+#include <vector>
+#include "text_buffer.hpp"
 
 /*******************************************************************************
  * VALUES
@@ -95,6 +99,15 @@ public:
 struct SDL_Window;
 struct SDL_Renderer;
 struct SDL_Texture;
+class draw_list_t;
+class audio_engine_t;
+class shape_batch_t;
+class input_recorder_t;
+class input_player_t;
+class logger_t;
+class job_system_t;
+class image_t;
+class texture_residency_t;
 struct _TTF_Font;
 struct _Mix_Music;
 struct Mix_Chunk;
@@ -182,16 +195,50 @@ inline bool operator!=(const pixel_t& lhs, const pixel_t& rhs)
 }
 
 
+// Totals of the resources created through pixello. Every wrapper holds them,
+// so a resource released after pixello is still counted.
+struct resource_counters_t
+{
+  uint64_t texture_bytes_created = 0;
+  uint64_t texture_bytes_destroyed = 0;
+  uint32_t textures = 0;
+  uint32_t fonts = 0;
+  uint32_t sounds = 0;
+};
+
+
 struct sdl_texture_wrapper_t
 {
   SDL_Texture* ptr = NULL;
 
+  std::shared_ptr<resource_counters_t> counters;
+  uint64_t bytes = 0;
+
+  // Color and alpha mod last set, see pixello::set_texture_mod()
+  pixel_t mod = 0xFFFFFFFF;
+
+  // Residency, see pixello::upload_managed(). An evicted texture has no ptr
+  // and is uploaded again from the image when drawn.
+  std::shared_ptr<image_t> image;
+  int32_t priority = 0;
+  int32_t blend = 0;  // SDL_BlendMode
+  uint64_t last_used = 0;  // Frame index
+
   sdl_texture_wrapper_t() = delete;
 
   sdl_texture_wrapper_t(SDL_Texture* p) : ptr(p) {}
   ~sdl_texture_wrapper_t();
 };
 
+// Same memory layout of SDL_Vertex
+struct vertex_t
+{
+  float x, y;
+  uint8_t r, g, b, a;
+  float u, v;
+};
+
+
 struct texture_t
 {
   int32_t w = 0;
@@ -210,10 +257,40 @@ struct texture_t
 };
 
 
+// A region of a texture, usually a single image packed in an atlas page
+struct sub_texture_t
+{
+  texture_t page;
+  rect_t clip = {0, 0, 0, 0};
+
+  inline int32_t w() const { return clip.w; }
+  inline int32_t h() const { return clip.h; }
+  inline bool is_valid() const { return page.is_valid(); }
+};
+
+
+struct atlas_t
+{
+  std::vector<texture_t> pages;
+  std::unordered_map<std::string, sub_texture_t> entries;
+
+  inline const sub_texture_t& get(const std::string& name) const
+  {
+    const auto it = entries.find(name);
+    if (it == entries.end()) {
+      throw runtime_exception("Image not found in atlas: " + name);
+    }
+    return it->second;
+  }
+};
+
+
 struct std_font_wrapper_t
 {
   _TTF_Font* ptr = NULL;
 
+  std::shared_ptr<resource_counters_t> counters;
+
   std_font_wrapper_t() = delete;
 
   std_font_wrapper_t(_TTF_Font* p) : ptr(p) {}
@@ -235,6 +312,12 @@ struct sdl_sound_wrapper_t
   _Mix_Music* music_ptr = NULL;
   Mix_Chunk* chunk_ptr = NULL;
 
+  // Voice management of play_sound()
+  int32_t priority = 0;
+  int32_t max_instances = 0;  // 0 is unlimited
+
+  std::shared_ptr<resource_counters_t> counters;
+
   sdl_sound_wrapper_t() = delete;
   sdl_sound_wrapper_t(_Mix_Music* p) : music_ptr(p), chunk_ptr(NULL) {}
   sdl_sound_wrapper_t(Mix_Chunk* p) : music_ptr(NULL), chunk_ptr(p) {}
@@ -247,6 +330,13 @@ struct sound_t
 
   sound_t() {}
   inline Mix_Chunk* pointer() const { return _ptr.get()->chunk_ptr; }
+
+  // Higher priority sounds can steal the channels of lower priority ones
+  inline void set_priority(const int32_t p) { _ptr.get()->priority = p; }
+  inline void set_max_instances(const int32_t n)
+  {
+    _ptr.get()->max_instances = n;
+  }
 };
 
 struct music_t
@@ -257,6 +347,160 @@ struct music_t
   inline _Mix_Music* pointer() const { return _ptr.get()->music_ptr; }
 };
 
+enum class subsystem_init_t
+{
+  LAZY,   // Initialized on first use
+  EAGER,  // Initialized in init(), before on_init
+  DISABLED
+};
+
+enum class audio_format_t
+{
+  S16,
+  F32
+};
+
+enum class voice_steal_t
+{
+  NONE,      // Drop the new sound if no channel is free
+  OLDEST,    // Stop the oldest sound with lower or equal priority
+  QUIETEST,  // Stop the quietest sound with lower or equal priority
+};
+
+// Main loop rate, see config_t::idle_fps. Anything but ACTIVE is a good time
+// to pause expensive simulation.
+enum class pacing_t
+{
+  ACTIVE,      // target_fps
+  UNFOCUSED,   // idle_fps
+  MINIMIZED,   // idle_fps
+  INPUT_IDLE,  // idle_fps, no input for idle_timeout_s
+  APP_IDLE     // Waiting for events, see pixello::set_idle()
+};
+
+enum class log_level_t
+{
+  TRACE,
+  DEBUG,
+  INFO,
+  WARN,
+  ERROR,
+  OFF
+};
+
+struct voice_stats_t
+{
+  // Last completed frame
+  uint32_t played = 0;
+  uint32_t dropped = 0;
+  uint32_t stolen = 0;
+
+  uint64_t total_played = 0;
+  uint64_t total_dropped = 0;
+  uint64_t total_stolen = 0;
+};
+
+struct audio_stats_t
+{
+  int32_t frequency = 0;
+  int32_t channels = 0;
+  audio_format_t format = audio_format_t::S16;
+
+  // Measured from the mixer callbacks
+  int32_t buffer_frames = 0;
+  float buffer_ms = 0.0f;
+  // Not measurable through SDL, estimated as one buffer playing plus one
+  // being mixed. The driver and device buffers come on top.
+  float estimated_latency_ms = 0.0f;
+  float avg_callback_interval_ms = 0.0f;
+  float max_callback_interval_ms = 0.0f;
+  uint64_t late_callbacks = 0;  // Likely underruns
+
+  // Custom mixer voices
+  uint32_t active_voices = 0;
+  uint64_t dropped_voices = 0;
+};
+
+struct music_stream_stats_t
+{
+  bool playing = false;
+  float fill = 0.0f;  // Of the decode buffer, from 0 to 1
+  float buffered_ms = 0.0f;
+  uint64_t underruns = 0;  // Callbacks the decode thread did not keep up with
+  uint64_t loops = 0;
+};
+
+// Renderer work of one frame, from the clear to the present
+struct frame_stats_t
+{
+  uint32_t draw_calls = 0;        // Clears, fills, lines, copies and geometry
+  uint32_t state_changes = 0;     // Color, blend, target, viewport, clip, mods
+  uint32_t state_changes_skipped = 0;  // Already set, no SDL call made
+  uint32_t texture_switches = 0;  // Draws using another texture than the last
+  uint32_t presents = 0;
+  uint64_t texture_bytes_uploaded = 0;  // Streaming writes and re-uploads
+  uint64_t texture_bytes_created = 0;
+  uint64_t texture_bytes_destroyed = 0;
+
+  // At the end of the frame
+  uint32_t live_textures = 0;
+  uint64_t live_texture_bytes = 0;
+  uint32_t live_fonts = 0;
+  uint32_t live_sounds = 0;
+
+  // Managed textures, see pixello::upload_managed()
+  uint64_t texture_budget = 0;
+  uint64_t managed_resident_bytes = 0;
+  uint64_t managed_evicted_bytes = 0;  // Only on the CPU
+  uint32_t texture_evictions = 0;
+  uint32_t texture_reuploads = 0;
+};
+
+// The counters of frame_stats_t averaged over frames, not rounded
+struct frame_stats_avg_t
+{
+  double draw_calls = 0.0;
+  double state_changes = 0.0;
+  double state_changes_skipped = 0.0;
+  double texture_switches = 0.0;
+  double presents = 0.0;
+  double texture_bytes_uploaded = 0.0;
+  double texture_bytes_created = 0.0;
+  double texture_bytes_destroyed = 0.0;
+
+  double live_textures = 0.0;
+  double live_texture_bytes = 0.0;
+  double live_fonts = 0.0;
+  double live_sounds = 0.0;
+
+  double texture_budget = 0.0;
+  double managed_resident_bytes = 0.0;
+  double managed_evicted_bytes = 0.0;
+  double texture_evictions = 0.0;
+  double texture_reuploads = 0.0;
+};
+
+// Each counter over the last frames, see config_t::frame_stats_window
+struct frame_stats_summary_t
+{
+  uint32_t frames = 0;
+  frame_stats_t min;
+  frame_stats_avg_t avg;
+  frame_stats_t max;
+};
+
+struct init_timings_t
+{
+  float video_ms = 0.0f;
+  float window_ms = 0.0f;
+  float renderer_ms = 0.0f;
+  float image_ms = 0.0f;
+  float audio_ms = 0.0f;
+  float ttf_ms = 0.0f;
+  float on_init_ms = 0.0f;
+  float total_ms = 0.0f;
+};
+
 struct config_t
 {
   int32_t pixel_size;
@@ -274,6 +518,79 @@ struct config_t
 
   pixel_t background_color;
 
+  subsystem_init_t audio_init = subsystem_init_t::LAZY;
+  subsystem_init_t image_init = subsystem_init_t::LAZY;
+  subsystem_init_t ttf_init = subsystem_init_t::LAZY;
+
+  // Output device. Smaller buffers lower the latency but need a mixer that
+  // keeps up, 256 or 512 frames are fine for UI sounds.
+  int32_t audio_frequency = 44100;
+  audio_format_t audio_format = audio_format_t::S16;
+  int32_t audio_channels = 2;
+  int32_t audio_buffer_frames = 2048;
+
+  // SDL_mixer channels used by play_sound()
+  int32_t sound_channels = 8;
+  voice_steal_t voice_stealing = voice_steal_t::OLDEST;
+
+  // Draw everything at width_in_pixels x height_in_pixels into one low res
+  // target, upscaled by the largest integer factor that fits when presenting.
+  // draw_pixel() then draws single pixels, width() and height() are the
+  // logical size and the mouse is reported in logical pixels.
+  bool logical_resolution = false;
+
+  // Voices of the custom mixer used by play_voice(), 0 to disable it
+  int32_t mixer_voices = 0;
+
+  // Audio decoded ahead by each streamed music track
+  uint32_t music_stream_buffer_ms = 500;
+
+  // Input log of every frame. A replay ignores the real input and does not
+  // sleep between frames. on_update gets the recorded dt of each frame, not
+  // a fixed timestep, so the replay follows the timing of the recording.
+  std::string record_input_path;
+  std::string replay_input_path;
+
+  // Hidden window and software renderer, on the dummy video driver unless
+  // SDL_VIDEODRIVER says otherwise
+  bool headless = false;
+
+  // CSV with the timings of every frame, empty to disable
+  std::string frame_timing_path;
+
+  // Frames kept for frame_stats_summary()
+  uint32_t frame_stats_window = 120;
+
+  // Bytes of managed textures kept in video memory, 0 for no limit
+  uint64_t texture_budget_bytes = 0;
+
+  // The frame is kept between frames instead of cleared. Draws are clipped
+  // to what the frame passed to invalidate(), and only frames with damage
+  // are presented. Without damage the loop waits for an event, at most
+  // retained_wait_ms.
+  bool retained_frame = false;
+  uint32_t retained_wait_ms = 250;
+
+  // Main loop pacing. Unfocused or minimized windows, and no input for
+  // idle_timeout_s (0 for never), run at idle_fps. An app idle by
+  // pixello::set_idle() waits for events, at most idle_wait_ms per frame.
+  // Input brings back target_fps.
+  float idle_fps = 10.0f;
+  float idle_timeout_s = 0.0f;
+  bool throttle_unfocused = true;
+  uint32_t idle_wait_ms = 1000;
+
+  // Threads of the job system besides the main one. Negative picks one less
+  // than the hardware threads, 0 runs the jobs on the main thread.
+  int32_t job_workers = -1;
+
+  // Asynchronous logger. Messages below log_level are discarded, the ring
+  // holds log_ring messages before new ones are dropped.
+  log_level_t log_level = log_level_t::INFO;
+  std::string log_path;  // Empty to not write a file
+  bool log_to_stdout = true;
+  uint32_t log_ring = 4096;
+
   config_t(uint32_t ps, uint32_t ww, uint32_t wh, std::string wname, float Hz)
       : pixel_size(ps),
         window_w(ww),
@@ -291,6 +608,27 @@ struct config_t
   }
 };
 
+struct camera_t
+{
+  float x = 0.0f;  // World point shown at the center of the viewport
+  float y = 0.0f;
+  float zoom = 1.0f;
+  float rotation = 0.0f;  // Radians, clockwise on screen
+};
+
+struct view_t
+{
+  rect_t viewport;
+  camera_t camera;
+
+  // Conversions between world and window coordinates
+  void to_screen(const float wx, const float wy, float& sx, float& sy) const;
+  void to_world(const point_t& screen, float& wx, float& wy) const;
+
+  // World space bounding box of what the view shows
+  void visible_bounds(float& x0, float& y0, float& x1, float& y1) const;
+};
+
 struct button_key_t
 {
   enum state_t
@@ -388,19 +726,152 @@ private:
 
   void* _external_data = nullptr;
 
+  mutable texture_t _render_target;
+
+  // Logical resolution, the frame is drawn here and upscaled at present
+  texture_t _frame_target;
+  texture_t _retained_target;  // Output size, without a logical resolution
+  rect_t _frame_rect = {0, 0, 0, 0};  // Output pixels
+  int32_t _frame_scale = 1;
+  float _output_per_window = 1.0f;  // High DPI output
+
+  // Relative motion in logical pixels not reported yet
+  float _mouse_rest_x = 0.0f;
+  float _mouse_rest_y = 0.0f;
+
+  // Scratch buffers reused by the batched submissions
+  mutable std::vector<vertex_t> _batch_vertices;
+  mutable std::vector<int> _batch_indices;
+  mutable std::shared_ptr<shape_batch_t> _circle_batch;
+
+  void flush_batch(SDL_Texture* texture) const;
+  void update_frame_rect();
+  void present_frame();
+  SDL_Texture* frame_texture() const;
+
+  // Retained frame, bounding boxes of the damage
+  rect_t _damage = {0, 0, 0, 0};  // Invalidated out of a frame
+  rect_t _frame_damage = {0, 0, 0, 0};
+  bool _full_damage = true;
+  bool _in_frame = false;
+  void begin_retained_frame();
+  rect_t frame_bounds() const;
+  void clear_damage(const rect_t& rect);
+  // Sets clip narrowed to the damage, NULL for the damage alone
+  void apply_clip(const rect_t* clip) const;
+
+  // Pacing
+  pacing_t _pacing = pacing_t::ACTIVE;
+  bool _focused = true;
+  bool _minimized = false;
+  bool _app_idle = false;
+  uint64_t _last_input_ms = 0;
+  void update_pacing();
+  void wait_next_frame(const float elapsed_s, const bool undamaged);
+  point_t window_to_logical(const int32_t x, const int32_t y) const;
+
   bool _text_input_on = false;
   const std::string _empty_input_text = " ";
-  std::string _input_text;
+  text_buffer_t _input_buffer;
   bool _render_input_text = false;
 
+  // Keycaps held in the frame, one bit each
+  uint64_t _keys = 0;
+
+  std::shared_ptr<input_recorder_t> _recorder;
+  std::shared_ptr<input_player_t> _player;
+  std::shared_ptr<std::ofstream> _frame_timing;
+  uint64_t _frame_index = 0;
+
+  bool read_frame_input();
+
+  // Renderer counters
+  mutable frame_stats_t _frame_stats;
+  frame_stats_t _last_frame_stats;
+  mutable SDL_Texture* _last_texture = NULL;
+  std::shared_ptr<resource_counters_t> _resources =
+      std::make_shared<resource_counters_t>();
+  uint64_t _bytes_created_mark = 0;
+  uint64_t _bytes_destroyed_mark = 0;
+  std::vector<frame_stats_t> _stats_history;
+  size_t _stats_next = 0;
+
+  std::shared_ptr<texture_residency_t> _residency;
+  void make_resident(sdl_texture_wrapper_t& w) const;
+
+  inline void count_state() const { ++_frame_stats.state_changes; }
+  void close_frame_stats();
+
+  // Render state as last set on SDL, the calls that would not change it are
+  // skipped. Each part is unknown until pixello sets it.
+  struct render_state_t
+  {
+    bool color_known = false;
+    bool blend_known = false;
+    bool target_known = false;
+    bool viewport_known = false;
+    bool clip_known = false;
+
+    pixel_t color;
+    int32_t blend = 0;  // SDL_BlendMode
+    SDL_Texture* target = NULL;
+    bool has_viewport = false;
+    rect_t viewport = {0, 0, 0, 0};
+    bool has_clip = false;
+    rect_t clip = {0, 0, 0, 0};
+  };
+
+  mutable render_state_t _state;
+
+  void set_draw_color(const pixel_t& c) const;
+  void set_draw_blend(const int32_t mode) const;
+  int set_target(SDL_Texture* t) const;
+  // Empties a texture_t holding a target, forgetting it if it is the cached
+  // one as SDL falls back to the screen when it is destroyed
+  void release_target(texture_t& t) const;
+  void set_viewport(const rect_t* rect) const;
+  void set_clip(const rect_t* rect) const;
+  // Reads the viewport and clip back from SDL when they are unknown
+  void read_view_state() const;
+
+  // Subsystems brought up on first use
+  mutable bool _image_ready = false;
+  mutable bool _audio_ready = false;
+  mutable bool _ttf_ready = false;
+  mutable init_timings_t _init_timings;
+  mutable std::shared_ptr<audio_engine_t> _audio_engine;
+  std::shared_ptr<logger_t> _logger;  // From the constructor on
+  void start_logger();
+  std::shared_ptr<job_system_t> _jobs;
+  mutable bool _music_hooked = false;
+
+  struct channel_t
+  {
+    Mix_Chunk* chunk = NULL;
+    int32_t priority = 0;
+    uint64_t seq = 0;  // Start order
+  };
+
+  mutable std::vector<channel_t> _channels;
+  mutable uint64_t _channel_seq = 0;
+  mutable voice_stats_t _voice_stats;
+  voice_stats_t _last_voice_stats;
+
+  int pick_channel(const sound_t& sound) const;
+
   void init();
+  void require_image() const;
+  void require_audio() const;
+  void unhook_music_stream() const;
+  void require_ttf() const;
 
 protected:
   // Have to Override this
   virtual void on_update(void* external_data) = 0;
   virtual void on_init(void* external_data) = 0;
 
-  // You can override this if you want
+  // You can override this if you want, by default it goes to logger() at the
+  // INFO level. The messages of pixello itself come through it too.
   virtual void log(const std::string& msg);
 
 public:
@@ -410,7 +881,9 @@ public:
           float Hz,
           void* external_data = nullptr)
       : _config({1, ww, wh, wname, Hz}), _external_data(external_data)
-  {}
+  {
+    start_logger();
+  }
 
   pixello(uint32_t pixel_size,
           uint32_t ww,
@@ -419,7 +892,15 @@ public:
           float Hz,
           void* external_data = nullptr)
       : _config({pixel_size, ww, wh, wname, Hz}), _external_data(external_data)
-  {}
+  {
+    start_logger();
+  }
+
+  pixello(const config_t& config, void* external_data = nullptr)
+      : _config(config), _external_data(external_data)
+  {
+    start_logger();
+  }
 
   ~pixello();
 
@@ -438,10 +919,34 @@ public:
                     const rect_t& rect,
                     const rect_t& clip) const;
 
+  void draw_texture(const sub_texture_t& t,
+                    const int32_t x,
+                    const int32_t y) const;
+  void draw_texture(const sub_texture_t& t, const rect_t& rect) const;
+
+  // Untextured if the texture is not valid
+  void draw_geometry(const std::vector<vertex_t>& vertices,
+                     const std::vector<int>& indices,
+                     const texture_t& t = texture_t()) const;
+
+  // Draws a recorded list through the view camera, culling the commands
+  // outside of it. The same list can be submitted to many views.
+  void submit(const draw_list_t& list, const view_t& view) const;
+
+  // One geometry call per circle, use a shape_batch_t for many of them
   void draw_circle(const int32_t x,
                    const int32_t y,
                    const int32_t r,
-                   const pixel_t& color) const;
+                   const pixel_t& color,
+                   const bool antialias = false) const;
+
+#ifdef PIXELLO_HAS_SDL2_GFX
+  // The old SDL2_gfx path, kept to compare against
+  void draw_circle_gfx(const int32_t x,
+                       const int32_t y,
+                       const int32_t r,
+                       const pixel_t& color) const;
+#endif
 
   void play_music(const music_t& music) const;
   void play_sound(const sound_t& sound) const;
@@ -455,9 +960,60 @@ public:
   void set_music_volume(const float value) const;
   void set_sound_volume(const float value) const;
 
+  // Custom mixer path, lock free and meant for many short effects. Returns
+  // false if the voice was dropped.
+  bool play_voice(const sound_t& sound, const float gain = 1.0f) const;
+  audio_stats_t audio_stats() const;
+  inline const voice_stats_t& voice_stats() const { return _last_voice_stats; }
+  inline float estimated_audio_latency_ms() const
+  {
+    return audio_stats().estimated_latency_ms;
+  }
+
+  // Streamed music, for long WAV tracks. It is decoded ahead on a thread and
+  // replaces play_music() while playing. A new track crossfades with the
+  // previous one.
+  void play_music_stream(const std::string& path,
+                         const float crossfade_s = 0.0f,
+                         const bool loop = true) const;
+  void stop_music_stream(const float fade_s = 0.0f) const;
+  music_stream_stats_t music_stream_stats() const;
+
 
   font_t load_font(const std::string& path, const int size_in_pixels) const;
   texture_t load_image(const std::string& img_path) const;
+  // CPU side copy for processing, see image.hpp
+  image_t load_image_data(const std::string& img_path) const;
+  void save_image(const image_t& image, const std::string& path) const;
+  // Static texture of the image. A premultiplied image is blended as one.
+  texture_t upload(const image_t& image,
+                   const bool premultiplied = false) const;
+
+  // Textures under config_t::texture_budget_bytes. The image stays on the
+  // CPU, cold textures are evicted over the budget, the lowest priority and
+  // least recently drawn first, and uploaded again when drawn.
+  texture_t upload_managed(image_t image,
+                           const int32_t priority = 0,
+                           const bool premultiplied = false) const;
+  texture_t load_managed_image(const std::string& img_path,
+                               const int32_t priority = 0) const;
+  void set_texture_priority(const texture_t& t, const int32_t priority) const;
+  void set_texture_budget(const uint64_t bytes);
+  // Pages of up to page_size squared, each cut to the images packed in it
+  atlas_t load_atlas(const std::vector<std::string>& img_paths,
+                     const int32_t page_size = 2048,
+                     const int32_t padding = 1) const;
+  sub_texture_t create_sub_texture(const texture_t& t,
+                                   const rect_t& clip) const;
+
+  // Off screen rendering
+  texture_t create_render_target(const int32_t w, const int32_t h) const;
+  // CPU written texture, ARGB8888 in native endianness
+  texture_t create_streaming_texture(const int32_t w, const int32_t h) const;
+  void set_render_target(const texture_t& t) const;
+  void reset_render_target() const;
+  inline const texture_t& render_target() const { return _render_target; }
+  void clear_render_target(const pixel_t& color) const;
   texture_t create_text(const std::string& text,
                         const pixel_t& color,
                         const font_t& font) const;
@@ -465,10 +1021,62 @@ public:
   music_t load_music(const std::string& music_path) const;
 
 
+  inline SDL_Renderer* renderer() const { return _renderer; }
+
+  // For code working on renderer() directly. wrap_texture() takes ownership
+  // of a texture created on it, so it is counted and freed like the others.
+  texture_t wrap_texture(SDL_Texture* ptr) const;
+  // SDL texture for a draw, a managed texture is made resident first
+  inline SDL_Texture* use_texture(const texture_t& t) const
+  {
+    sdl_texture_wrapper_t& w = *t._ptr;
+    if (w.image) { make_resident(w); }
+    return w.ptr;
+  }
+  inline void count_draw_call(SDL_Texture* t) const
+  {
+    ++_frame_stats.draw_calls;
+    if (t != _last_texture) {
+      ++_frame_stats.texture_switches;
+      _last_texture = t;
+    }
+  }
+  inline void count_upload(const uint64_t bytes) const
+  {
+    _frame_stats.texture_bytes_uploaded += bytes;
+  }
+  // After changing the renderer state behind pixello
+  void invalidate_render_state() const;
+
+  // Color and alpha multiplied into every draw of the texture, white and
+  // opaque to draw it as it is
+  void set_texture_mod(const texture_t& t, const pixel_t& color) const;
+
+  // Retained frame damage, see config_t::retained_frame. Invalidating clears
+  // the rect to the background and lets the draws that follow in the frame
+  // touch it, so it comes before redrawing what changed. Out of on_update()
+  // it applies to the next frame. Window events invalidate everything.
+  void invalidate(const rect_t& rect);
+  void invalidate();
+  inline const rect_t& damage() const { return _frame_damage; }
+  inline bool has_damage() const { return _frame_damage.w > 0; }
+
+  // Counters of the last completed frame and over the recent ones
+  inline const frame_stats_t& frame_stats() const { return _last_frame_stats; }
+  frame_stats_summary_t frame_stats_summary() const;
+
   inline int32_t width_in_pixels() const { return _config.width_in_pixels; }
   inline int32_t height_in_pixels() const { return _config.height_in_pixels; }
-  inline int32_t width() const { return _config.window_w; }
-  inline int32_t height() const { return _config.window_h; }
+  inline int32_t width() const
+  {
+    return _config.logical_resolution ? _config.width_in_pixels
+                                      : _config.window_w;
+  }
+  inline int32_t height() const
+  {
+    return _config.logical_resolution ? _config.height_in_pixels
+                                      : _config.window_h;
+  }
   inline mouse_t mouse_state() const { return _mouse_state; }
   bool is_key_pressed(const keycap_t k) const;
 
@@ -487,10 +1095,23 @@ public:
   inline uint32_t FPS() const { return _FPS; }
   inline uint64_t delta_time() const { return dt; }
   inline void stop() { _running = false; }
+
+  // See config_t::idle_fps. Idle lasts until the next input or set_idle(false).
+  inline pacing_t pacing() const { return _pacing; }
+  inline void set_idle(const bool idle) { _app_idle = idle; }
+  inline const init_timings_t& init_timings() const { return _init_timings; }
+
+  // Leveled, formatted logging from any thread, see logger.hpp
+  logger_t& logger() const;
+
+  // Shared thread pool, see job_system.hpp. Started by run(), the jobs queued
+  // for the main thread run before every on_update.
+  job_system_t& jobs() const;
   float get_performance_freq();
 
-  // void set_current_viewport(const rect_t& rect,
-  //                           const pixel_t& color = {0x555555FF});
+  void set_current_viewport(const rect_t& rect,
+                            const pixel_t& color = {0x555555FF}) const;
+  void reset_viewport() const;
 
   bool is_mouse_in(const rect_t& rect) const;
   void show_mouse(const bool show) const;
@@ -509,10 +1130,12 @@ public:
   inline bool should_render_text() const { return _render_input_text; }
   inline const std::string& get_input_text() const
   {
-    if (_input_text.empty()) { return _empty_input_text; }
-    return _input_text;
+    if (_input_buffer.empty()) { return _empty_input_text; }
+    return _input_buffer.str();
   }
+  inline const text_buffer_t& input_buffer() const { return _input_buffer; }
+  inline text_buffer_t& input_buffer() { return _input_buffer; }
   inline bool is_text_input_enabled() const { return _text_input_on; }
   void set_to_clipboard(const std::string& text);
-  inline void clear_input_text_buffer() { _input_text.clear(); }
+  inline void clear_input_text_buffer() { _input_buffer.clear(); }
 };
@@ -0,0 +1,299 @@
+#include "shapes.hpp"
+#include <algorithm>
+#include <cmath>
+
+static constexpr float PI = 3.14159265f;
+
+// Max distance in pixels between the true edge and the polygon
+static constexpr float TOLERANCE = 0.25f;
+
+static constexpr uint32_t MIN_SEGMENTS = 8;
+static constexpr uint32_t MAX_SEGMENTS = 1024;
+
+/*******************************************************************************
+ * SHAPE BATCH
+ ******************************************************************************/
+
+const std::vector<float>& shape_batch_t::unit_circle(const float radius)
+{
+  // Smaller than the tolerance, any polygon is close enough
+  uint32_t n = MIN_SEGMENTS;
+  if (radius > TOLERANCE) {
+    const float step = std::acos(1.0f - TOLERANCE / radius);
+    n = static_cast<uint32_t>(std::ceil(2.0f * PI / std::max(step, 1e-4f)));
+  }
+
+  // Multiple of four, the rounded rect takes one quarter per corner
+  n = std::clamp((n + 3) & ~3u, MIN_SEGMENTS, MAX_SEGMENTS);
+
+  if (_unit_circles.size() <= n) { _unit_circles.resize(n + 1); }
+
+  std::vector<float>& table = _unit_circles[n];
+  if (table.empty()) {
+    table.resize(n * 2);
+    for (uint32_t i = 0; i < n; ++i) {
+      const float angle = 2.0f * PI * i / n;
+      table[i * 2] = std::cos(angle);
+      table[i * 2 + 1] = std::sin(angle);
+    }
+  }
+
+  return table;
+}
+
+
+void shape_batch_t::add_vertex(const float x,
+                               const float y,
+                               const pixel_t& color)
+{
+  _vertices.push_back({x, y, color.r, color.g, color.b, color.a, .0f, .0f});
+}
+
+
+// Outward normals of a convex path going by increasing angle. At the corners
+// they are scaled to keep the offset edges one pixel apart.
+void shape_batch_t::path_normals(const std::vector<float>& path,
+                                 std::vector<float>& normals) const
+{
+  const size_t n = path.size() / 2;
+  normals.resize(path.size());
+
+  auto edge_normal = [&](const size_t a, const size_t b, float& nx, float& ny) {
+    const float ex = path[b * 2] - path[a * 2];
+    const float ey = path[b * 2 + 1] - path[a * 2 + 1];
+    const float len = std::sqrt(ex * ex + ey * ey);
+
+    nx = len > 1e-6f ? ey / len : .0f;
+    ny = len > 1e-6f ? -ex / len : .0f;
+  };
+
+  for (size_t i = 0; i < n; ++i) {
+    float x0, y0, x1, y1;
+    edge_normal((i + n - 1) % n, i, x0, y0);
+    edge_normal(i, (i + 1) % n, x1, y1);
+
+    const float mx = (x0 + x1) * 0.5f;
+    const float my = (y0 + y1) * 0.5f;
+    const float len2 = std::max(mx * mx + my * my, 0.25f);
+
+    normals[i * 2] = mx / len2;
+    normals[i * 2 + 1] = my / len2;
+  }
+}
+
+
+void shape_batch_t::add_convex(const std::vector<float>& path,
+                               const float cx,
+                               const float cy,
+                               const pixel_t& color)
+{
+  const size_t n = path.size() / 2;
+
+  if (_antialias) { path_normals(path, _outer_normals); }
+
+  const int center = static_cast<int>(_vertices.size());
+  add_vertex(cx, cy, color);
+
+  // Half a pixel in, the fringe covers the other half out
+  const float inset = _antialias ? 0.5f : .0f;
+  for (size_t i = 0; i < n; ++i) {
+    const float nx = _antialias ? _outer_normals[i * 2] : .0f;
+    const float ny = _antialias ? _outer_normals[i * 2 + 1] : .0f;
+    add_vertex(path[i * 2] - nx * inset, path[i * 2 + 1] - ny * inset, color);
+  }
+
+  for (size_t i = 0; i < n; ++i) {
+    const int a = center + 1 + static_cast<int>(i);
+    const int b = center + 1 + static_cast<int>((i + 1) % n);
+    _indices.insert(_indices.end(), {center, a, b});
+  }
+
+  if (_antialias) { add_fringe(path, _outer_normals, 1.0f, color); }
+}
+
+
+void shape_batch_t::add_fringe(const std::vector<float>& path,
+                               const std::vector<float>& normals,
+                               const float direction,
+                               const pixel_t& color)
+{
+  const size_t n = path.size() / 2;
+  const int first = static_cast<int>(_vertices.size());
+
+  pixel_t transparent = color;
+  transparent.a = 0;
+
+  for (size_t i = 0; i < n; ++i) {
+    const float nx = normals[i * 2] * direction * 0.5f;
+    const float ny = normals[i * 2 + 1] * direction * 0.5f;
+    add_vertex(path[i * 2] - nx, path[i * 2 + 1] - ny, color);
+    add_vertex(path[i * 2] + nx, path[i * 2 + 1] + ny, transparent);
+  }
+
+  for (size_t i = 0; i < n; ++i) {
+    const int a = first + static_cast<int>(i * 2);
+    const int b = first + static_cast<int>(((i + 1) % n) * 2);
+    _indices.insert(_indices.end(), {a, a + 1, b + 1, a, b + 1, b});
+  }
+}
+
+
+void shape_batch_t::ellipse_path(const float x,
+                                 const float y,
+                                 const float rx,
+                                 const float ry,
+                                 std::vector<float>& out)
+{
+  const std::vector<float>& unit = unit_circle(std::max(rx, ry));
+  out.resize(unit.size());
+
+  for (size_t i = 0; i < unit.size(); i += 2) {
+    out[i] = x + unit[i] * rx;
+    out[i + 1] = y + unit[i + 1] * ry;
+  }
+}
+
+
+void shape_batch_t::add_circle(const float x,
+                               const float y,
+                               const float r,
+                               const pixel_t& color)
+{
+  add_ellipse(x, y, r, r, color);
+}
+
+
+void shape_batch_t::add_ellipse(const float x,
+                                const float y,
+                                const float rx,
+                                const float ry,
+                                const pixel_t& color)
+{
+  if (rx <= .0f || ry <= .0f) { return; }
+
+  ellipse_path(x, y, rx, ry, _outer);
+  add_convex(_outer, x, y, color);
+}
+
+
+void shape_batch_t::add_ring(const float x,
+                             const float y,
+                             const float r,
+                             const float thickness,
+                             const pixel_t& color)
+{
+  if (r <= .0f || thickness <= .0f) { return; }
+
+  if (thickness >= r) {
+    add_circle(x, y, r, color);
+    return;
+  }
+
+  // Same segment count for both edges, picked from the outer radius
+  const std::vector<float>& unit = unit_circle(r);
+  const float inner_r = r - thickness;
+  const size_t n = unit.size() / 2;
+
+  _outer.resize(unit.size());
+  _inner.resize(unit.size());
+  for (size_t i = 0; i < unit.size(); i += 2) {
+    _outer[i] = x + unit[i] * r;
+    _outer[i + 1] = y + unit[i + 1] * r;
+    _inner[i] = x + unit[i] * inner_r;
+    _inner[i + 1] = y + unit[i + 1] * inner_r;
+  }
+
+  if (_antialias) {
+    path_normals(_outer, _outer_normals);
+    path_normals(_inner, _inner_normals);
+  }
+
+  const float inset = _antialias ? 0.5f : .0f;
+  const int first = static_cast<int>(_vertices.size());
+
+  for (size_t i = 0; i < n; ++i) {
+    const float ox = _antialias ? _outer_normals[i * 2] * inset : .0f;
+    const float oy = _antialias ? _outer_normals[i * 2 + 1] * inset : .0f;
+    const float ix = _antialias ? _inner_normals[i * 2] * inset : .0f;
+    const float iy = _antialias ? _inner_normals[i * 2 + 1] * inset : .0f;
+    add_vertex(_outer[i * 2] - ox, _outer[i * 2 + 1] - oy, color);
+    add_vertex(_inner[i * 2] + ix, _inner[i * 2 + 1] + iy, color);
+  }
+
+  for (size_t i = 0; i < n; ++i) {
+    const int a = first + static_cast<int>(i * 2);
+    const int b = first + static_cast<int>(((i + 1) % n) * 2);
+    _indices.insert(_indices.end(), {a, a + 1, b + 1, a, b + 1, b});
+  }
+
+  if (_antialias) {
+    add_fringe(_outer, _outer_normals, 1.0f, color);
+    add_fringe(_inner, _inner_normals, -1.0f, color);
+  }
+}
+
+
+void shape_batch_t::add_rounded_rect(const rect_t& rect,
+                                     const float radius,
+                                     const pixel_t& color)
+{
+  if (rect.w <= 0 || rect.h <= 0) { return; }
+
+  const float x = static_cast<float>(rect.x);
+  const float y = static_cast<float>(rect.y);
+  const float w = static_cast<float>(rect.w);
+  const float h = static_cast<float>(rect.h);
+  const float r = std::clamp(radius, .0f, std::min(w, h) * 0.5f);
+
+  _outer.clear();
+
+  if (r < 0.5f) {
+    // Plain rect, same winding as the arcs
+    _outer.insert(_outer.end(), {x + w, y + h, x, y + h, x, y, x + w, y});
+  } else {
+    const std::vector<float>& unit = unit_circle(r);
+    const size_t quarter = unit.size() / 8;
+
+    // Bottom right, bottom left, top left, top right
+    const float centers[8] = {x + w - r, y + h - r, x + r, y + h - r,
+                              x + r,     y + r,     x + w - r, y + r};
+
+    for (size_t c = 0; c < 4; ++c) {
+      for (size_t i = c * quarter; i <= (c + 1) * quarter; ++i) {
+        const size_t u = (i % (quarter * 4)) * 2;
+        const float px = centers[c * 2] + unit[u] * r;
+        const float py = centers[c * 2 + 1] + unit[u + 1] * r;
+
+        // Arcs touch when the straight side has no length
+        const size_t size = _outer.size();
+        if (size > 0 && std::abs(_outer[size - 2] - px) < 1e-3f &&
+            std::abs(_outer[size - 1] - py) < 1e-3f) {
+          continue;
+        }
+
+        _outer.push_back(px);
+        _outer.push_back(py);
+      }
+    }
+
+    if (std::abs(_outer[0] - _outer[_outer.size() - 2]) < 1e-3f &&
+        std::abs(_outer[1] - _outer[_outer.size() - 1]) < 1e-3f) {
+      _outer.resize(_outer.size() - 2);
+    }
+  }
+
+  add_convex(_outer, x + w * 0.5f, y + h * 0.5f, color);
+}
+
+
+void shape_batch_t::clear()
+{
+  _vertices.clear();
+  _indices.clear();
+}
+
+
+void shape_batch_t::draw(const pixello& p) const
+{
+  p.draw_geometry(_vertices, _indices);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+#include "pixello.hpp"
+
+/*******************************************************************************
+ * SHAPE BATCH
+ ******************************************************************************/
+// Filled shapes tessellated into triangles and drawn with one geometry call
+// per batch. The unit circle points are cached per segment count, which only
+// depends on the radius. With anti aliasing every edge gets a one pixel
+// fringe fading to transparent.
+class shape_batch_t
+{
+private:
+  bool _antialias;
+
+  std::vector<vertex_t> _vertices;
+  std::vector<int> _indices;
+
+  // Cos and sin pairs, indexed by the segment count
+  std::vector<std::vector<float>> _unit_circles;
+  std::vector<float> _outer;  // Scratch paths, x and y pairs
+  std::vector<float> _inner;
+  std::vector<float> _outer_normals;
+  std::vector<float> _inner_normals;
+
+  const std::vector<float>& unit_circle(const float radius);
+  void add_vertex(const float x, const float y, const pixel_t& color);
+  void path_normals(const std::vector<float>& path,
+                    std::vector<float>& normals) const;
+  void add_convex(const std::vector<float>& path,
+                  const float cx,
+                  const float cy,
+                  const pixel_t& color);
+  void add_fringe(const std::vector<float>& path,
+                  const std::vector<float>& normals,
+                  const float direction,
+                  const pixel_t& color);
+  void ellipse_path(const float x,
+                    const float y,
+                    const float rx,
+                    const float ry,
+                    std::vector<float>& out);
+
+public:
+  shape_batch_t(const bool antialias = true) : _antialias(antialias) {}
+
+  void add_circle(const float x,
+                  const float y,
+                  const float r,
+                  const pixel_t& color);
+  void add_ring(const float x,
+                const float y,
+                const float r,
+                const float thickness,
+                const pixel_t& color);
+  void add_ellipse(const float x,
+                   const float y,
+                   const float rx,
+                   const float ry,
+                   const pixel_t& color);
+  void add_rounded_rect(const rect_t& rect,
+                        const float radius,
+                        const pixel_t& color);
+
+  void clear();
+  inline size_t vertex_count() const { return _vertices.size(); }
+  inline bool antialias() const { return _antialias; }
+  inline void set_antialias(const bool value) { _antialias = value; }
+
+  // Draws everything added since the last clear()
+  void draw(const pixello& p) const;
+};
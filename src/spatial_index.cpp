@@ -0,0 +1,398 @@
+#include "spatial_index.hpp"
+#include <algorithm>
+#include <cmath>
+
+/*******************************************************************************
+ * SPATIAL ITEMS
+ ******************************************************************************/
+
+spatial_id_t spatial_items_t::add_item(const rect_t& rect, const int32_t z)
+{
+  spatial_id_t id;
+
+  if (_free_ids.empty()) {
+    id = static_cast<spatial_id_t>(_items.size());
+    _items.push_back({rect, z, _seq++, true});
+  } else {
+    id = _free_ids.back();
+    _free_ids.pop_back();
+    _items[id] = {rect, z, _seq++, true};
+  }
+
+  ++_size;
+  return id;
+}
+
+
+void spatial_items_t::remove_item(const spatial_id_t id)
+{
+  _items[id].alive = false;
+  _free_ids.push_back(id);
+  --_size;
+}
+
+
+void spatial_items_t::check_id(const spatial_id_t id) const
+{
+  if (id >= _items.size() || !_items[id].alive) {
+    throw input_exception("Invalid spatial index id: " + STR(id));
+  }
+}
+
+
+/*******************************************************************************
+ * GRID INDEX
+ ******************************************************************************/
+
+grid_index_t::grid_index_t(const int32_t cell_size) : _cell_size(cell_size)
+{
+  if (cell_size < 1) {
+    throw input_exception("Invalid grid cell size: " + STR(cell_size));
+  }
+}
+
+
+int32_t grid_index_t::cell_coord(const int32_t v) const
+{
+  // Floor division, also for negative coordinates
+  int32_t c = v / _cell_size;
+  if (v < 0 && c * _cell_size != v) { --c; }
+  return c;
+}
+
+
+grid_index_t::cell_range_t grid_index_t::cell_range(const rect_t& rect) const
+{
+  const int32_t w = std::max(rect.w, 1);
+  const int32_t h = std::max(rect.h, 1);
+
+  return {cell_coord(rect.x), cell_coord(rect.y), cell_coord(rect.x + w - 1),
+          cell_coord(rect.y + h - 1)};
+}
+
+
+void grid_index_t::link(const spatial_id_t id, const cell_range_t& range)
+{
+  for (int32_t y = range.y0; y <= range.y1; ++y) {
+    for (int32_t x = range.x0; x <= range.x1; ++x) {
+      _cells[key(x, y)].push_back(id);
+    }
+  }
+}
+
+
+void grid_index_t::unlink(const spatial_id_t id, const cell_range_t& range)
+{
+  for (int32_t y = range.y0; y <= range.y1; ++y) {
+    for (int32_t x = range.x0; x <= range.x1; ++x) {
+      auto it = _cells.find(key(x, y));
+      if (it == _cells.end()) { continue; }
+
+      auto& cell = it->second;
+      auto pos = std::find(cell.begin(), cell.end(), id);
+      if (pos != cell.end()) {
+        *pos = cell.back();
+        cell.pop_back();
+      }
+
+      if (cell.empty()) { _cells.erase(it); }
+    }
+  }
+}
+
+
+spatial_id_t grid_index_t::insert(const rect_t& rect, const int32_t z)
+{
+  const spatial_id_t id = add_item(rect, z);
+
+  if (_stamps.size() < _items.size()) { _stamps.resize(_items.size(), 0); }
+
+  link(id, cell_range(rect));
+  return id;
+}
+
+
+void grid_index_t::move(const spatial_id_t id, const rect_t& rect)
+{
+  check_id(id);
+
+  const cell_range_t old_range = cell_range(_items[id].rect);
+  const cell_range_t new_range = cell_range(rect);
+
+  _items[id].rect = rect;
+
+  // Most of the moves stay in the same cells
+  if (old_range.x0 == new_range.x0 && old_range.y0 == new_range.y0 &&
+      old_range.x1 == new_range.x1 && old_range.y1 == new_range.y1) {
+    return;
+  }
+
+  unlink(id, old_range);
+  link(id, new_range);
+}
+
+
+void grid_index_t::remove(const spatial_id_t id)
+{
+  check_id(id);
+  unlink(id, cell_range(_items[id].rect));
+  remove_item(id);
+}
+
+
+void grid_index_t::clear()
+{
+  _cells.clear();
+  _items.clear();
+  _free_ids.clear();
+  _stamps.clear();
+  _size = 0;
+}
+
+
+void grid_index_t::query(const point_t& p,
+                         std::vector<spatial_id_t>& out) const
+{
+  auto it = _cells.find(key(cell_coord(p.x), cell_coord(p.y)));
+  if (it == _cells.end()) { return; }
+
+  for (const spatial_id_t id : it->second) {
+    if (contains(_items[id].rect, p)) { out.push_back(id); }
+  }
+}
+
+
+void grid_index_t::query(const rect_t& r, std::vector<spatial_id_t>& out) const
+{
+  if (r.w <= 0 || r.h <= 0) { return; }
+
+  if (++_stamp == 0) {
+    // Wrapped around, the old stamps are not reliable anymore
+    std::fill(_stamps.begin(), _stamps.end(), 0);
+    _stamp = 1;
+  }
+
+  const cell_range_t range = cell_range(r);
+
+  for (int32_t y = range.y0; y <= range.y1; ++y) {
+    for (int32_t x = range.x0; x <= range.x1; ++x) {
+      auto it = _cells.find(key(x, y));
+      if (it == _cells.end()) { continue; }
+
+      for (const spatial_id_t id : it->second) {
+        if (_stamps[id] == _stamp) { continue; }
+        _stamps[id] = _stamp;
+
+        if (overlaps(_items[id].rect, r)) { out.push_back(id); }
+      }
+    }
+  }
+}
+
+
+spatial_id_t grid_index_t::pick(const point_t& p) const
+{
+  spatial_id_t result = INVALID_SPATIAL_ID;
+
+  auto it = _cells.find(key(cell_coord(p.x), cell_coord(p.y)));
+  if (it == _cells.end()) { return result; }
+
+  for (const spatial_id_t id : it->second) {
+    if (contains(_items[id].rect, p) && is_above(id, result)) { result = id; }
+  }
+
+  return result;
+}
+
+
+/*******************************************************************************
+ * LOOSE QUADTREE
+ ******************************************************************************/
+
+quadtree_t::quadtree_t(const rect_t& bounds, const int32_t max_depth)
+    : _bounds(bounds)
+{
+  if (bounds.w < 1 || bounds.h < 1) {
+    throw input_exception("Invalid quadtree bounds");
+  }
+
+  if (max_depth < 0 || max_depth > 12) {
+    throw input_exception("Invalid quadtree depth: " + STR(max_depth));
+  }
+
+  _levels.resize(max_depth + 1);
+
+  for (int32_t d = 0; d <= max_depth; ++d) {
+    level_t& level = _levels[d];
+    level.side = 1 << d;
+    level.cell_w = static_cast<float>(bounds.w) / level.side;
+    level.cell_h = static_cast<float>(bounds.h) / level.side;
+    level.cells.resize(static_cast<size_t>(level.side) * level.side);
+  }
+}
+
+
+quadtree_t::location_t quadtree_t::locate(const rect_t& rect) const
+{
+  const bool inside = rect.x >= _bounds.x && rect.y >= _bounds.y &&
+                      rect.x + rect.w <= _bounds.x + _bounds.w &&
+                      rect.y + rect.h <= _bounds.y + _bounds.h;
+
+  if (!inside) { return {0, 0}; }
+
+  // Deepest level whose cells are still as big as the rect
+  uint32_t d = 0;
+  while (d + 1 < _levels.size() && rect.w <= _levels[d + 1].cell_w &&
+         rect.h <= _levels[d + 1].cell_h) {
+    ++d;
+  }
+
+  const level_t& level = _levels[d];
+  const float cx = (rect.x - _bounds.x) + rect.w * 0.5f;
+  const float cy = (rect.y - _bounds.y) + rect.h * 0.5f;
+  const int32_t ix = std::min(static_cast<int32_t>(cx / level.cell_w),
+                              level.side - 1);
+  const int32_t iy = std::min(static_cast<int32_t>(cy / level.cell_h),
+                              level.side - 1);
+
+  return {d, static_cast<uint32_t>(iy * level.side + ix)};
+}
+
+
+void quadtree_t::link(const spatial_id_t id, const location_t& loc)
+{
+  _levels[loc.level].cells[loc.cell].push_back(id);
+}
+
+
+void quadtree_t::unlink(const spatial_id_t id, const location_t& loc)
+{
+  auto& cell = _levels[loc.level].cells[loc.cell];
+  auto pos = std::find(cell.begin(), cell.end(), id);
+  if (pos != cell.end()) {
+    *pos = cell.back();
+    cell.pop_back();
+  }
+}
+
+
+spatial_id_t quadtree_t::insert(const rect_t& rect, const int32_t z)
+{
+  const spatial_id_t id = add_item(rect, z);
+  const location_t loc = locate(rect);
+
+  if (_locations.size() < _items.size()) { _locations.resize(_items.size()); }
+
+  _locations[id] = loc;
+  link(id, loc);
+
+  return id;
+}
+
+
+void quadtree_t::move(const spatial_id_t id, const rect_t& rect)
+{
+  check_id(id);
+
+  _items[id].rect = rect;
+
+  const location_t loc = locate(rect);
+  const location_t old_loc = _locations[id];
+  if (loc.level == old_loc.level && loc.cell == old_loc.cell) { return; }
+
+  unlink(id, old_loc);
+  link(id, loc);
+  _locations[id] = loc;
+}
+
+
+void quadtree_t::remove(const spatial_id_t id)
+{
+  check_id(id);
+  unlink(id, _locations[id]);
+  remove_item(id);
+}
+
+
+void quadtree_t::clear()
+{
+  for (auto& level : _levels) {
+    for (auto& cell : level.cells) {
+      cell.clear();
+    }
+  }
+
+  _items.clear();
+  _free_ids.clear();
+  _locations.clear();
+  _size = 0;
+}
+
+
+template <typename F>
+void quadtree_t::visit(const rect_t& r, F&& fn) const
+{
+  // The root also holds everything outside of the bounds
+  for (const spatial_id_t id : _levels[0].cells[0]) {
+    fn(id);
+  }
+
+  const float qx0 = static_cast<float>(r.x - _bounds.x);
+  const float qy0 = static_cast<float>(r.y - _bounds.y);
+  const float qx1 = qx0 + r.w;
+  const float qy1 = qy0 + r.h;
+
+  for (size_t d = 1; d < _levels.size(); ++d) {
+    const level_t& level = _levels[d];
+
+    // Loose cells extend half a cell on every side
+    const int32_t x0 =
+        std::max(static_cast<int32_t>(floorf(qx0 / level.cell_w - 0.5f)), 0);
+    const int32_t y0 =
+        std::max(static_cast<int32_t>(floorf(qy0 / level.cell_h - 0.5f)), 0);
+    const int32_t x1 =
+        std::min(static_cast<int32_t>(floorf(qx1 / level.cell_w + 0.5f)),
+                 level.side - 1);
+    const int32_t y1 =
+        std::min(static_cast<int32_t>(floorf(qy1 / level.cell_h + 0.5f)),
+                 level.side - 1);
+
+    for (int32_t y = y0; y <= y1; ++y) {
+      for (int32_t x = x0; x <= x1; ++x) {
+        for (const spatial_id_t id : level.cells[y * level.side + x]) {
+          fn(id);
+        }
+      }
+    }
+  }
+}
+
+
+void quadtree_t::query(const point_t& p, std::vector<spatial_id_t>& out) const
+{
+  visit({p.x, p.y, 1, 1}, [&](const spatial_id_t id) {
+    if (contains(_items[id].rect, p)) { out.push_back(id); }
+  });
+}
+
+
+void quadtree_t::query(const rect_t& r, std::vector<spatial_id_t>& out) const
+{
+  if (r.w <= 0 || r.h <= 0) { return; }
+
+  visit(r, [&](const spatial_id_t id) {
+    if (overlaps(_items[id].rect, r)) { out.push_back(id); }
+  });
+}
+
+
+spatial_id_t quadtree_t::pick(const point_t& p) const
+{
+  spatial_id_t result = INVALID_SPATIAL_ID;
+
+  visit({p.x, p.y, 1, 1}, [&](const spatial_id_t id) {
+    if (contains(_items[id].rect, p) && is_above(id, result)) { result = id; }
+  });
+
+  return result;
+}
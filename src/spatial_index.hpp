@@ -0,0 +1,157 @@
+#pragma once
+
+#include <vector>
+#include "pixello.hpp"
+
+/*******************************************************************************
+ * SPATIAL INDEX
+ ******************************************************************************/
+using spatial_id_t = uint32_t;
+constexpr spatial_id_t INVALID_SPATIAL_ID = UINT32_MAX;
+
+// Item storage shared by the spatial indexes. Ids are recycled after remove.
+// The topmost item is the one with the highest z, the most recently inserted
+// one on ties.
+class spatial_items_t
+{
+protected:
+  struct item_t
+  {
+    rect_t rect;
+    int32_t z;
+    uint64_t seq;
+    bool alive;
+  };
+
+  std::vector<item_t> _items;
+  std::vector<spatial_id_t> _free_ids;
+  uint64_t _seq = 0;
+  size_t _size = 0;
+
+  spatial_id_t add_item(const rect_t& rect, const int32_t z);
+  void remove_item(const spatial_id_t id);
+  void check_id(const spatial_id_t id) const;
+
+  inline bool is_above(const spatial_id_t a, const spatial_id_t b) const
+  {
+    if (b == INVALID_SPATIAL_ID) { return true; }
+    const item_t& ia = _items[a];
+    const item_t& ib = _items[b];
+    return ia.z > ib.z || (ia.z == ib.z && ia.seq > ib.seq);
+  }
+
+  static inline bool contains(const rect_t& r, const point_t& p)
+  {
+    return p.x >= r.x && p.x < r.x + r.w && p.y >= r.y && p.y < r.y + r.h;
+  }
+
+  static inline bool overlaps(const rect_t& a, const rect_t& b)
+  {
+    return a.x < b.x + b.w && b.x < a.x + a.w && a.y < b.y + b.h &&
+           b.y < a.y + a.h;
+  }
+
+public:
+  inline size_t size() const { return _size; }
+  inline const rect_t& rect(const spatial_id_t id) const
+  {
+    check_id(id);
+    return _items[id].rect;
+  }
+  inline int32_t z(const spatial_id_t id) const
+  {
+    check_id(id);
+    return _items[id].z;
+  }
+};
+
+
+// Uniform grid hash. Best when the items have similar sizes and the world is
+// unbounded.
+class grid_index_t : public spatial_items_t
+{
+private:
+  struct cell_range_t
+  {
+    int32_t x0, y0;
+    int32_t x1, y1;
+  };
+
+  int32_t _cell_size;
+  std::unordered_map<uint64_t, std::vector<spatial_id_t>> _cells;
+
+  // Used to report every item only once in the rect queries
+  mutable std::vector<uint32_t> _stamps;
+  mutable uint32_t _stamp = 0;
+
+  int32_t cell_coord(const int32_t v) const;
+  cell_range_t cell_range(const rect_t& rect) const;
+  void link(const spatial_id_t id, const cell_range_t& range);
+  void unlink(const spatial_id_t id, const cell_range_t& range);
+
+  static inline uint64_t key(const int32_t x, const int32_t y)
+  {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) |
+           static_cast<uint32_t>(y);
+  }
+
+public:
+  grid_index_t(const int32_t cell_size = 64);
+
+  spatial_id_t insert(const rect_t& rect, const int32_t z = 0);
+  void move(const spatial_id_t id, const rect_t& rect);
+  void remove(const spatial_id_t id);
+  void clear();
+
+  void query(const point_t& p, std::vector<spatial_id_t>& out) const;
+  void query(const rect_t& r, std::vector<spatial_id_t>& out) const;
+  spatial_id_t pick(const point_t& p) const;
+};
+
+
+// Loose quadtree over fixed bounds, with loose factor 2. Every item is stored
+// in exactly one node: the deepest one whose cell contains the item center and
+// is at least as big as the item. Items outside of the bounds go in the root.
+class quadtree_t : public spatial_items_t
+{
+private:
+  struct level_t
+  {
+    int32_t side;  // Cells per side
+    float cell_w;
+    float cell_h;
+    std::vector<std::vector<spatial_id_t>> cells;
+  };
+
+  struct location_t
+  {
+    uint32_t level;
+    uint32_t cell;
+  };
+
+  rect_t _bounds;
+  std::vector<level_t> _levels;
+  std::vector<location_t> _locations;
+
+  location_t locate(const rect_t& rect) const;
+  void link(const spatial_id_t id, const location_t& loc);
+  void unlink(const spatial_id_t id, const location_t& loc);
+
+  // Calls fn(id) for every item whose loose node intersects the rect
+  template <typename F>
+  void visit(const rect_t& r, F&& fn) const;
+
+public:
+  quadtree_t(const rect_t& bounds, const int32_t max_depth = 8);
+
+  spatial_id_t insert(const rect_t& rect, const int32_t z = 0);
+  void move(const spatial_id_t id, const rect_t& rect);
+  void remove(const spatial_id_t id);
+  void clear();
+
+  void query(const point_t& p, std::vector<spatial_id_t>& out) const;
+  void query(const rect_t& r, std::vector<spatial_id_t>& out) const;
+  spatial_id_t pick(const point_t& p) const;
+
+  inline const rect_t& bounds() const { return _bounds; }
+};
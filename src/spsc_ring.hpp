@@ -0,0 +1,109 @@
+#pragma once
+
+#include <inttypes.h>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+
+/*******************************************************************************
+ * SPSC RING
+ ******************************************************************************/
+// Bounded lock free queue for exactly one producer and one consumer thread,
+// used to talk with the audio callback without locks or allocations.
+template <typename T, size_t N>
+class spsc_ring_t
+{
+  static_assert((N & (N - 1)) == 0, "The ring size must be a power of two");
+
+private:
+  T _items[N];
+  alignas(64) std::atomic<size_t> _head{0};  // Next to pop
+  alignas(64) std::atomic<size_t> _tail{0};  // Next to push
+
+public:
+  bool push(const T& item)
+  {
+    const size_t tail = _tail.load(std::memory_order_relaxed);
+    if (tail - _head.load(std::memory_order_acquire) == N) { return false; }
+
+    _items[tail & (N - 1)] = item;
+    _tail.store(tail + 1, std::memory_order_release);
+
+    return true;
+  }
+
+  bool pop(T& item)
+  {
+    const size_t head = _head.load(std::memory_order_relaxed);
+    if (head == _tail.load(std::memory_order_acquire)) { return false; }
+
+    item = _items[head & (N - 1)];
+    _head.store(head + 1, std::memory_order_release);
+
+    return true;
+  }
+
+  inline size_t size() const
+  {
+    return _tail.load(std::memory_order_acquire) -
+           _head.load(std::memory_order_acquire);
+  }
+};
+
+
+// Byte stream variant, for audio data produced and consumed in blocks of
+// different sizes.
+class spsc_byte_ring_t
+{
+private:
+  std::unique_ptr<uint8_t[]> _data;
+  size_t _capacity;
+  alignas(64) std::atomic<size_t> _head{0};
+  alignas(64) std::atomic<size_t> _tail{0};
+
+public:
+  spsc_byte_ring_t(const size_t capacity)
+      : _data(new uint8_t[capacity]), _capacity(capacity)
+  {}
+
+  size_t write(const uint8_t* src, const size_t bytes)
+  {
+    const size_t tail = _tail.load(std::memory_order_relaxed);
+    const size_t head = _head.load(std::memory_order_acquire);
+    const size_t n = std::min(bytes, _capacity - (tail - head));
+
+    // At most two copies, before and after the wrap
+    const size_t offset = tail % _capacity;
+    const size_t first = std::min(n, _capacity - offset);
+    std::memcpy(&_data[offset], src, first);
+    std::memcpy(&_data[0], src + first, n - first);
+
+    _tail.store(tail + n, std::memory_order_release);
+    return n;
+  }
+
+  size_t read(uint8_t* dst, const size_t bytes)
+  {
+    const size_t head = _head.load(std::memory_order_relaxed);
+    const size_t tail = _tail.load(std::memory_order_acquire);
+    const size_t n = std::min(bytes, tail - head);
+
+    const size_t offset = head % _capacity;
+    const size_t first = std::min(n, _capacity - offset);
+    std::memcpy(dst, &_data[offset], first);
+    std::memcpy(dst + first, &_data[0], n - first);
+
+    _head.store(head + n, std::memory_order_release);
+    return n;
+  }
+
+  inline size_t size() const
+  {
+    return _tail.load(std::memory_order_acquire) -
+           _head.load(std::memory_order_acquire);
+  }
+  inline size_t free() const { return _capacity - size(); }
+  inline size_t capacity() const { return _capacity; }
+};
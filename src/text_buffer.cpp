@@ -0,0 +1,290 @@
+#include "text_buffer.hpp"
+#include <algorithm>
+#include <cstring>
+
+/*******************************************************************************
+ * TEXT BUFFER
+ ******************************************************************************/
+
+constexpr size_t MIN_GAP = 64;
+
+
+static inline bool is_continuation(const char c)
+{
+  return (static_cast<uint8_t>(c) & 0xC0) == 0x80;
+}
+
+
+text_buffer_t::text_buffer_t()
+{
+  _data.resize(MIN_GAP);
+  _gap_end = MIN_GAP;
+}
+
+
+void text_buffer_t::changed()
+{
+  ++_version;
+  _str_valid = false;
+}
+
+
+void text_buffer_t::move_gap(const size_t pos)
+{
+  if (pos == _gap_start) { return; }
+
+  const size_t gap = _gap_end - _gap_start;
+
+  if (pos < _gap_start) {
+    // Move the bytes between pos and the gap after the gap
+    const size_t n = _gap_start - pos;
+    std::memmove(&_data[pos + gap], &_data[pos], n);
+  } else {
+    const size_t n = pos - _gap_start;
+    std::memmove(&_data[_gap_start], &_data[_gap_end], n);
+  }
+
+  _gap_start = pos;
+  _gap_end = pos + gap;
+}
+
+
+void text_buffer_t::reserve_gap(const size_t bytes)
+{
+  const size_t gap = _gap_end - _gap_start;
+  if (gap >= bytes) { return; }
+
+  // Grow geometrically so that repeated typing stays amortized O(1)
+  const size_t tail = _data.size() - _gap_end;
+  const size_t new_size = std::max(_data.size() * 2, size() + bytes + MIN_GAP);
+
+  _data.resize(new_size);
+  // Pointer arithmetic, the tail may be empty at the end of the data
+  std::memmove(_data.data() + new_size - tail, _data.data() + _gap_end, tail);
+  _gap_end = new_size - tail;
+}
+
+
+void text_buffer_t::erase_range(const size_t from, const size_t to)
+{
+  if (from >= to) { return; }
+
+  move_gap(from);
+  _gap_end += to - from;
+  _anchor = _gap_start;
+}
+
+
+void text_buffer_t::insert(const std::string& text)
+{
+  if (has_selection()) { erase_range(selection_begin(), selection_end()); }
+
+  reserve_gap(text.size());
+  std::memcpy(_data.data() + _gap_start, text.data(), text.size());
+  _gap_start += text.size();
+  _anchor = _gap_start;
+
+  changed();
+}
+
+
+void text_buffer_t::erase_back()
+{
+  if (has_selection()) {
+    erase_range(selection_begin(), selection_end());
+  } else if (_gap_start > 0) {
+    erase_range(prev(_gap_start), _gap_start);
+  } else {
+    return;
+  }
+
+  changed();
+}
+
+
+void text_buffer_t::erase_forward()
+{
+  if (has_selection()) {
+    erase_range(selection_begin(), selection_end());
+  } else if (_gap_start < size()) {
+    erase_range(_gap_start, next(_gap_start));
+  } else {
+    return;
+  }
+
+  changed();
+}
+
+
+void text_buffer_t::clear()
+{
+  _gap_start = 0;
+  _gap_end = _data.size();
+  _anchor = 0;
+
+  changed();
+}
+
+
+void text_buffer_t::set(const std::string& text)
+{
+  clear();
+  insert(text);
+}
+
+
+void text_buffer_t::set_cursor(const size_t pos, const bool select)
+{
+  // Back to the start of the code point pos falls in
+  size_t clamped = std::min(pos, size());
+  if (clamped < size() && is_continuation(at(clamped))) {
+    clamped = prev(clamped);
+  }
+  const size_t old_anchor = _anchor;
+
+  if (clamped == _gap_start && (select || _anchor == _gap_start)) { return; }
+
+  move_gap(clamped);
+  _anchor = select ? old_anchor : clamped;
+
+  ++_version;
+}
+
+
+void text_buffer_t::move_left(const bool select)
+{
+  // Without shift a selection collapses to its start
+  if (!select && has_selection()) {
+    set_cursor(selection_begin());
+    return;
+  }
+
+  set_cursor(prev(_gap_start), select);
+}
+
+
+void text_buffer_t::move_right(const bool select)
+{
+  if (!select && has_selection()) {
+    set_cursor(selection_end());
+    return;
+  }
+
+  set_cursor(next(_gap_start), select);
+}
+
+
+void text_buffer_t::move_home(const bool select)
+{
+  set_cursor(0, select);
+}
+
+
+void text_buffer_t::move_end(const bool select)
+{
+  set_cursor(size(), select);
+}
+
+
+void text_buffer_t::select_all()
+{
+  move_gap(size());
+  _anchor = 0;
+  ++_version;
+}
+
+
+size_t text_buffer_t::next(const size_t pos) const
+{
+  const size_t n = size();
+  if (pos >= n) { return n; }
+
+  size_t result = pos + 1;
+  while (result < n && is_continuation(at(result))) { ++result; }
+
+  return result;
+}
+
+
+size_t text_buffer_t::prev(const size_t pos) const
+{
+  if (pos == 0) { return 0; }
+
+  size_t result = pos - 1;
+  while (result > 0 && is_continuation(at(result))) { --result; }
+
+  return result;
+}
+
+
+uint32_t text_buffer_t::decode(size_t& pos) const
+{
+  const uint8_t c = static_cast<uint8_t>(at(pos));
+  const size_t end = next(pos);
+
+  uint32_t cp;
+  size_t extra;
+
+  if (c < 0x80) {
+    cp = c;
+    extra = 0;
+  } else if ((c & 0xE0) == 0xC0) {
+    cp = c & 0x1F;
+    extra = 1;
+  } else if ((c & 0xF0) == 0xE0) {
+    cp = c & 0x0F;
+    extra = 2;
+  } else if ((c & 0xF8) == 0xF0) {
+    cp = c & 0x07;
+    extra = 3;
+  } else {
+    pos = end;
+    return 0xFFFD;
+  }
+
+  // Truncated sequence
+  if (pos + 1 + extra != end) {
+    pos = end;
+    return 0xFFFD;
+  }
+
+  for (size_t i = 1; i <= extra; ++i) {
+    cp = (cp << 6) | (static_cast<uint8_t>(at(pos + i)) & 0x3F);
+  }
+
+  pos = end;
+  return cp;
+}
+
+
+std::string text_buffer_t::substr(const size_t from, const size_t to) const
+{
+  std::string result;
+  if (from >= to) { return result; }
+
+  result.reserve(to - from);
+
+  // At most two contiguous pieces, before and after the gap
+  if (from < _gap_start) {
+    result.append(&_data[from], std::min(to, _gap_start) - from);
+  }
+
+  if (to > _gap_start) {
+    const size_t start = std::max(from, _gap_start);
+    const size_t gap = _gap_end - _gap_start;
+    result.append(&_data[start + gap], to - start);
+  }
+
+  return result;
+}
+
+
+const std::string& text_buffer_t::str() const
+{
+  if (!_str_valid) {
+    _str = substr(0, size());
+    _str_valid = true;
+  }
+
+  return _str;
+}
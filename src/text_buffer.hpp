@@ -0,0 +1,82 @@
+#pragma once
+
+#include <inttypes.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+/*******************************************************************************
+ * TEXT BUFFER
+ ******************************************************************************/
+// UTF-8 gap buffer. The gap always sits at the cursor, so typing, deleting
+// and pasting at the cursor only touch the bytes being edited. Positions are
+// byte offsets and always lie on a code point boundary.
+class text_buffer_t
+{
+private:
+  std::vector<char> _data;
+  size_t _gap_start = 0;
+  size_t _gap_end = 0;
+  size_t _anchor = 0;  // Selection anchor, equal to the cursor if none
+  uint64_t _version = 0;
+
+  mutable std::string _str;
+  mutable bool _str_valid = true;
+
+  void move_gap(const size_t pos);
+  void reserve_gap(const size_t bytes);
+  void erase_range(const size_t from, const size_t to);
+  void changed();
+
+public:
+  text_buffer_t();
+
+  // Editing, the selection is replaced or erased if present
+  void insert(const std::string& text);
+  void erase_back();
+  void erase_forward();
+  void clear();
+  void set(const std::string& text);
+
+  // Cursor movement, extends the selection if select is true
+  void move_left(const bool select = false);
+  void move_right(const bool select = false);
+  void move_home(const bool select = false);
+  void move_end(const bool select = false);
+  // A pos inside a code point moves to its start
+  void set_cursor(const size_t pos, const bool select = false);
+  void select_all();
+
+  inline size_t size() const { return _data.size() - (_gap_end - _gap_start); }
+  inline bool empty() const { return size() == 0; }
+  inline size_t cursor() const { return _gap_start; }
+  inline size_t anchor() const { return _anchor; }
+  inline bool has_selection() const { return _anchor != _gap_start; }
+  inline size_t selection_begin() const
+  {
+    return std::min(_anchor, _gap_start);
+  }
+  inline size_t selection_end() const { return std::max(_anchor, _gap_start); }
+
+  // Incremented on every change of text, cursor or selection
+  inline uint64_t version() const { return _version; }
+
+  inline char at(const size_t pos) const
+  {
+    return pos < _gap_start ? _data[pos] : _data[pos + _gap_end - _gap_start];
+  }
+
+  // Decodes the code point at pos and moves pos to the next one
+  uint32_t decode(size_t& pos) const;
+  size_t next(const size_t pos) const;
+  size_t prev(const size_t pos) const;
+
+  std::string substr(const size_t from, const size_t to) const;
+  inline std::string selected_text() const
+  {
+    return substr(selection_begin(), selection_end());
+  }
+
+  // Contiguous copy, rebuilt only after a change
+  const std::string& str() const;
+};
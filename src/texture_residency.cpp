@@ -0,0 +1,150 @@
+#include "texture_residency.hpp"
+#include <SDL.h>
+#include <algorithm>
+#include "image.hpp"
+
+/*******************************************************************************
+ * TEXTURE RESIDENCY
+ ******************************************************************************/
+
+texture_residency_t::texture_residency_t(SDL_Renderer* renderer,
+                                         const uint64_t budget)
+    : _renderer(renderer), _budget(budget)
+{}
+
+
+void texture_residency_t::add(const texture_t& t,
+                              std::shared_ptr<image_t> image,
+                              const int32_t priority)
+{
+  sdl_texture_wrapper_t& w = *t._ptr;
+
+  SDL_BlendMode blend = SDL_BLENDMODE_BLEND;
+  SDL_GetTextureBlendMode(w.ptr, &blend);
+
+  w.image = std::move(image);
+  w.priority = priority;
+  w.blend = static_cast<int32_t>(blend);
+
+  _textures.push_back(t._ptr);
+  _resident_bytes += w.bytes;
+}
+
+
+void texture_residency_t::recount()
+{
+  _resident_bytes = 0;
+  _evicted_bytes = 0;
+
+  // Dropping the dead ones
+  size_t alive = 0;
+  for (size_t i = 0; i < _textures.size(); ++i) {
+    const auto w = _textures[i].lock();
+    if (!w) { continue; }
+
+    if (w->ptr) {
+      _resident_bytes += w->bytes;
+    } else {
+      _evicted_bytes += w->bytes;
+    }
+    if (alive != i) { _textures[alive] = std::move(_textures[i]); }
+    ++alive;
+  }
+  _textures.resize(alive);
+}
+
+
+void texture_residency_t::evict(sdl_texture_wrapper_t& w)
+{
+  SDL_DestroyTexture(w.ptr);
+  w.ptr = NULL;
+
+  if (w.counters) { w.counters->texture_bytes_destroyed += w.bytes; }
+  _resident_bytes -= w.bytes;
+  _evicted_bytes += w.bytes;
+  ++_evictions;
+}
+
+
+void texture_residency_t::fit(const uint64_t frame, const uint64_t extra)
+{
+  if (_budget == 0 || _resident_bytes + extra <= _budget) { return; }
+
+  recount();
+  if (_resident_bytes + extra <= _budget) { return; }
+
+  // Textures of this frame may still be in a batch, they stay
+  std::vector<std::shared_ptr<sdl_texture_wrapper_t>> cold;
+  for (const auto& weak : _textures) {
+    auto w = weak.lock();
+    if (w && w->ptr && w->last_used < frame) { cold.push_back(std::move(w)); }
+  }
+
+  std::sort(cold.begin(), cold.end(), [](const auto& a, const auto& b) {
+    if (a->priority != b->priority) { return a->priority < b->priority; }
+    return a->last_used < b->last_used;
+  });
+
+  for (const auto& w : cold) {
+    if (_resident_bytes + extra <= _budget) { break; }
+    evict(*w);
+  }
+}
+
+
+uint64_t texture_residency_t::make_resident(sdl_texture_wrapper_t& w,
+                                            const uint64_t frame)
+{
+  w.last_used = frame;
+  if (w.ptr) { return 0; }
+
+  // Over the budget when everything is hot, reported by the stats
+  fit(frame, w.bytes);
+
+  const image_t& image = *w.image;
+  SDL_Texture* ptr =
+      SDL_CreateTexture(_renderer, SDL_PIXELFORMAT_RGBA8888,
+                        SDL_TEXTUREACCESS_STATIC, image.w(), image.h());
+
+  if (!ptr) {
+    throw load_exceptions("Failed to upload an evicted texture! " +
+                          std::string(SDL_GetError()));
+  }
+
+  const int pitch = image.stride() * static_cast<int>(sizeof(pixel_t));
+  if (SDL_UpdateTexture(ptr, NULL, image.data(), pitch) != 0) {
+    const std::string error = SDL_GetError();
+    SDL_DestroyTexture(ptr);
+    throw load_exceptions("Failed to upload an evicted texture! " + error);
+  }
+
+  // State the texture had
+  SDL_SetTextureBlendMode(ptr, static_cast<SDL_BlendMode>(w.blend));
+  SDL_SetTextureColorMod(ptr, w.mod.r, w.mod.g, w.mod.b);
+  SDL_SetTextureAlphaMod(ptr, w.mod.a);
+
+  w.ptr = ptr;
+  if (w.counters) { w.counters->texture_bytes_created += w.bytes; }
+  _resident_bytes += w.bytes;
+  _evicted_bytes -= std::min(_evicted_bytes, w.bytes);
+  ++_reuploads;
+
+  return w.bytes;
+}
+
+
+void texture_residency_t::end_frame(const uint64_t frame, frame_stats_t& stats)
+{
+  // The textures drawn in this frame are the hot ones
+  fit(frame, 0);
+  recount();
+
+  stats.texture_budget = _budget;
+  stats.managed_resident_bytes = _resident_bytes;
+  stats.managed_evicted_bytes = _evicted_bytes;
+  stats.texture_evictions = _evictions;
+  stats.texture_reuploads = _reuploads;
+
+  _evictions = 0;
+  _reuploads = 0;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "pixello.hpp"
+
+/*******************************************************************************
+ * TEXTURE RESIDENCY
+ ******************************************************************************/
+// Managed textures keep their image on the CPU. Over the budget the cold ones,
+// not drawn in the current frame, lose their SDL texture: lowest priority
+// first, then least recently drawn. A draw uploads them again. A budget of 0
+// only tracks the usage.
+class texture_residency_t
+{
+private:
+  SDL_Renderer* _renderer;
+  uint64_t _budget;
+
+  std::vector<std::weak_ptr<sdl_texture_wrapper_t>> _textures;
+  uint64_t _resident_bytes = 0;  // Can include dead textures until recount()
+  uint64_t _evicted_bytes = 0;
+
+  // Since the last end_frame()
+  uint32_t _evictions = 0;
+  uint32_t _reuploads = 0;
+
+  void recount();
+  void evict(sdl_texture_wrapper_t& w);
+  void fit(const uint64_t frame, const uint64_t extra);
+
+public:
+  texture_residency_t(SDL_Renderer* renderer, const uint64_t budget);
+
+  void add(const texture_t& t,
+           std::shared_ptr<image_t> image,
+           const int32_t priority);
+
+  // Uploads an evicted texture again, making room for it first. Returns the
+  // bytes uploaded.
+  uint64_t make_resident(sdl_texture_wrapper_t& w, const uint64_t frame);
+
+  // Evicts down to the budget and reports the usage
+  void end_frame(const uint64_t frame, frame_stats_t& stats);
+
+  inline uint64_t budget() const { return _budget; }
+  inline void set_budget(const uint64_t bytes) { _budget = bytes; }
+};
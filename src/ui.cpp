@@ -0,0 +1,476 @@
+#include "ui.hpp"
+#include <algorithm>
+#include "SDL_ttf.h"
+
+/*******************************************************************************
+ * RETAINED UI
+ ******************************************************************************/
+
+ui_t::ui_t(const pixello& p, const font_t& font, const ui_style_t& style)
+    : _pixello(p), _font(font), _style(style)
+{
+  if (!_font._ptr || _font.pointer() == NULL) {
+    throw input_exception("The ui needs a loaded font");
+  }
+
+  _line_h = TTF_FontHeight(_font.pointer());
+
+  widget_t root;
+  root.type = widget_type_t::PANEL;
+  root.parent = INVALID_WIDGET_ID;
+  _widgets.push_back(root);
+}
+
+
+void ui_t::check_id(const widget_id_t id) const
+{
+  if (id >= _widgets.size()) {
+    throw input_exception("Invalid widget id: " + STR(id));
+  }
+}
+
+
+widget_id_t ui_t::add_widget(const widget_id_t parent,
+                             const widget_type_t type)
+{
+  check_id(parent);
+
+  if (_widgets[parent].type != widget_type_t::PANEL) {
+    throw input_exception("Widgets can be added only to panels");
+  }
+
+  const widget_id_t id = static_cast<widget_id_t>(_widgets.size());
+
+  widget_t w;
+  w.type = type;
+  w.parent = parent;
+  _widgets.push_back(w);
+  _widgets[parent].children.push_back(id);
+
+  _layout_dirty = true;
+
+  return id;
+}
+
+
+widget_id_t ui_t::add_panel(const widget_id_t parent, const layout_t layout)
+{
+  const widget_id_t id = add_widget(parent, widget_type_t::PANEL);
+  _widgets[id].layout = layout;
+  return id;
+}
+
+
+widget_id_t ui_t::add_button(const widget_id_t parent,
+                             const std::string& text,
+                             const int32_t min_w,
+                             const int32_t min_h)
+{
+  const widget_id_t id = add_widget(parent, widget_type_t::BUTTON);
+  _widgets[id].min_w = min_w;
+  _widgets[id].min_h = min_h;
+  set_text(id, text);
+  return id;
+}
+
+
+widget_id_t ui_t::add_label(const widget_id_t parent, const std::string& text)
+{
+  const widget_id_t id = add_widget(parent, widget_type_t::LABEL);
+  set_text(id, text);
+  return id;
+}
+
+
+widget_id_t ui_t::add_text_field(const widget_id_t parent, const int32_t w)
+{
+  const widget_id_t id = add_widget(parent, widget_type_t::TEXT_FIELD);
+  _widgets[id].min_w = w;
+  return id;
+}
+
+
+void ui_t::set_text(const widget_id_t id, const std::string& text)
+{
+  check_id(id);
+
+  widget_t& w = _widgets[id];
+  if (w.type == widget_type_t::PANEL) {
+    throw input_exception("Panels have no text");
+  }
+
+  if (w.text == text) { return; }
+
+  w.text = text;
+  w.text_dirty = true;
+}
+
+
+void ui_t::bind_text_buffer(const widget_id_t id, const text_buffer_t* buffer)
+{
+  check_id(id);
+
+  widget_t& w = _widgets[id];
+  if (w.type != widget_type_t::TEXT_FIELD) {
+    throw input_exception("Only text fields can be bound to a text buffer");
+  }
+
+  if (buffer && !_field_glyphs) {
+    _field_glyphs = std::make_unique<glyph_cache_t>(_pixello, _font,
+                                                    _style.field_text_color);
+  }
+
+  w.buffer = buffer;
+  w.buffer_version = buffer ? buffer->version() : 0;
+  w.view.reset();
+  mark_dirty(id);
+}
+
+
+const std::string& ui_t::text(const widget_id_t id) const
+{
+  check_id(id);
+  return _widgets[id].text;
+}
+
+
+const rect_t& ui_t::rect(const widget_id_t id)
+{
+  check_id(id);
+  layout();
+  return _widgets[id].rect;
+}
+
+
+void ui_t::mark_dirty(const widget_id_t id)
+{
+  if (id == INVALID_WIDGET_ID) { return; }
+
+  if (std::find(_dirty.begin(), _dirty.end(), id) == _dirty.end()) {
+    _dirty.push_back(id);
+  }
+}
+
+
+void ui_t::refresh_text(widget_t& w)
+{
+  const int32_t old_w = w.text_texture.w;
+  const int32_t old_h = w.text_texture.h;
+
+  pixel_t color;
+  switch (w.type) {
+    case widget_type_t::BUTTON:
+      color = _style.button_text_color;
+      break;
+    case widget_type_t::TEXT_FIELD:
+      color = _style.field_text_color;
+      break;
+    default:
+      color = _style.label_color;
+      break;
+  }
+
+  // The glyph run is rendered once and reused until the text changes
+  if (w.text.empty()) {
+    w.text_texture = texture_t();
+  } else {
+    w.text_texture = _pixello.create_text(w.text, color, _font);
+  }
+
+  w.text_dirty = false;
+
+  // Only labels and buttons are sized by their text
+  if (w.type != widget_type_t::TEXT_FIELD &&
+      (w.text_texture.w != old_w || w.text_texture.h != old_h)) {
+    _layout_dirty = true;
+  }
+}
+
+
+void ui_t::measure(const widget_id_t id)
+{
+  widget_t& w = _widgets[id];
+  const int32_t p = _style.padding;
+
+  switch (w.type) {
+    case widget_type_t::LABEL:
+      w.rect.w = w.text_texture.w;
+      w.rect.h = std::max(w.text_texture.h, _line_h);
+      break;
+
+    case widget_type_t::BUTTON:
+      w.rect.w = std::max(w.min_w, w.text_texture.w + 2 * p);
+      w.rect.h = std::max(w.min_h, _line_h + 2 * p);
+      break;
+
+    case widget_type_t::TEXT_FIELD:
+      w.rect.w = w.min_w;
+      w.rect.h = _line_h + 2 * p;
+      break;
+
+    case widget_type_t::PANEL: {
+      int32_t along = 0;
+      int32_t across = 0;
+
+      for (const widget_id_t c : w.children) {
+        const rect_t& r = _widgets[c].rect;
+        const bool vertical = w.layout == layout_t::VERTICAL;
+        along += vertical ? r.h : r.w;
+        across = std::max(across, vertical ? r.w : r.h);
+      }
+
+      if (!w.children.empty()) {
+        along += _style.spacing * static_cast<int32_t>(w.children.size() - 1);
+      }
+
+      if (w.layout == layout_t::VERTICAL) {
+        w.rect.w = across + 2 * p;
+        w.rect.h = along + 2 * p;
+      } else {
+        w.rect.w = along + 2 * p;
+        w.rect.h = across + 2 * p;
+      }
+    } break;
+  }
+}
+
+
+void ui_t::place(const widget_id_t id, const int32_t x, const int32_t y)
+{
+  widget_t& w = _widgets[id];
+  w.rect.x = x;
+  w.rect.y = y;
+
+  if (w.type != widget_type_t::PANEL) { return; }
+
+  int32_t cx = x + _style.padding;
+  int32_t cy = y + _style.padding;
+
+  for (const widget_id_t c : w.children) {
+    // Children come after the parent, they are placed by the caller loop
+    _widgets[c].rect.x = cx;
+    _widgets[c].rect.y = cy;
+
+    if (w.layout == layout_t::VERTICAL) {
+      cy += _widgets[c].rect.h + _style.spacing;
+    } else {
+      cx += _widgets[c].rect.w + _style.spacing;
+    }
+  }
+}
+
+
+void ui_t::layout()
+{
+  for (auto& w : _widgets) {
+    if (w.text_dirty) { refresh_text(w); }
+  }
+
+  if (!_layout_dirty) { return; }
+
+  // Parents always have a lower id than their children, so sizes go
+  // bottom-up in reverse order and positions top-down in order
+  for (size_t i = _widgets.size(); i > 0; --i) {
+    measure(static_cast<widget_id_t>(i - 1));
+  }
+
+  place(root(), 0, 0);
+  for (size_t i = 1; i < _widgets.size(); ++i) {
+    place(static_cast<widget_id_t>(i), _widgets[i].rect.x, _widgets[i].rect.y);
+  }
+
+  // Rebuild the hit index
+  _hit_index.clear();
+  _hit_widgets.clear();
+
+  for (size_t i = 0; i < _widgets.size(); ++i) {
+    widget_t& w = _widgets[i];
+
+    if (w.type == widget_type_t::BUTTON ||
+        w.type == widget_type_t::TEXT_FIELD) {
+      w.hit_id = _hit_index.insert(w.rect);
+      _hit_widgets.push_back(static_cast<widget_id_t>(i));
+    } else {
+      w.hit_id = INVALID_SPATIAL_ID;
+    }
+  }
+
+  _layout_dirty = false;
+  _full_redraw = true;
+}
+
+
+void ui_t::update(const mouse_t& mouse)
+{
+  layout();
+
+  _clicked = INVALID_WIDGET_ID;
+
+  const point_t local = {mouse.x - _origin.x, mouse.y - _origin.y};
+  const spatial_id_t hit = _hit_index.pick(local);
+  const widget_id_t hovered =
+      hit == INVALID_SPATIAL_ID ? INVALID_WIDGET_ID : _hit_widgets[hit];
+
+  if (hovered != _hovered) {
+    mark_dirty(_hovered);
+    mark_dirty(hovered);
+    _hovered = hovered;
+  }
+
+  const widget_id_t pressed =
+      mouse.left_button.state == button_key_t::DOWN ? hovered
+                                                    : INVALID_WIDGET_ID;
+
+  if (pressed != _pressed) {
+    mark_dirty(_pressed);
+    mark_dirty(pressed);
+    _pressed = pressed;
+  }
+
+  if (mouse.left_button.click) {
+    widget_id_t focused = INVALID_WIDGET_ID;
+
+    if (hovered != INVALID_WIDGET_ID) {
+      if (_widgets[hovered].type == widget_type_t::BUTTON) {
+        _clicked = hovered;
+      } else {
+        focused = hovered;
+      }
+    }
+
+    if (focused != _focused) {
+      mark_dirty(_focused);
+      mark_dirty(focused);
+      _focused = focused;
+    }
+  }
+}
+
+
+pixel_t ui_t::background(const widget_id_t id) const
+{
+  const widget_t& w = _widgets[id];
+
+  switch (w.type) {
+    case widget_type_t::PANEL:
+      return _style.panel_color;
+
+    case widget_type_t::BUTTON:
+      if (_pressed == id) { return _style.button_pressed_color; }
+      if (_hovered == id) { return _style.button_hover_color; }
+      return _style.button_color;
+
+    case widget_type_t::TEXT_FIELD:
+      return _focused == id ? _style.field_focus_color : _style.field_color;
+
+    case widget_type_t::LABEL:
+    default:
+      return background(w.parent);
+  }
+}
+
+
+void ui_t::render_widget(const widget_id_t id, const bool clear_background)
+{
+  const widget_t& w = _widgets[id];
+  const int32_t p = _style.padding;
+
+  // Labels have no background of their own
+  if (clear_background || w.type != widget_type_t::LABEL) {
+    _pixello.draw_rect(w.rect, background(id));
+  }
+
+  if (w.buffer) {
+    const rect_t inner = {w.rect.x + p, w.rect.y, w.rect.w - 2 * p, w.rect.h};
+    _widgets[id].view.draw(_pixello, *_field_glyphs, *w.buffer, inner,
+                           _focused == id);
+    return;
+  }
+
+  const texture_t& t = w.text_texture;
+  if (!t.is_valid()) { return; }
+
+  switch (w.type) {
+    case widget_type_t::BUTTON:
+      _pixello.draw_texture(t, w.rect.x + (w.rect.w - t.w) / 2,
+                            w.rect.y + (w.rect.h - t.h) / 2);
+      break;
+
+    case widget_type_t::TEXT_FIELD: {
+      // Keep the end of the text visible
+      const int32_t visible_w = std::min(t.w, w.rect.w - 2 * p);
+      if (visible_w <= 0) { break; }
+
+      const rect_t clip = {t.w - visible_w, 0, visible_w, t.h};
+      const rect_t dst = {w.rect.x + p, w.rect.y + (w.rect.h - t.h) / 2,
+                          visible_w, t.h};
+      _pixello.draw_texture(t, dst, clip);
+    } break;
+
+    case widget_type_t::LABEL:
+      _pixello.draw_texture(t, w.rect.x, w.rect.y + (w.rect.h - t.h) / 2);
+      break;
+
+    default:
+      break;
+  }
+}
+
+
+void ui_t::draw()
+{
+  // Text changes that keep the widget size only need a partial redraw
+  for (size_t i = 0; i < _widgets.size(); ++i) {
+    widget_t& w = _widgets[i];
+
+    if (w.text_dirty) { mark_dirty(static_cast<widget_id_t>(i)); }
+
+    if (w.buffer && w.buffer->version() != w.buffer_version) {
+      w.buffer_version = w.buffer->version();
+      mark_dirty(static_cast<widget_id_t>(i));
+    }
+  }
+
+  layout();
+
+  const rect_t& root_rect = _widgets[root()].rect;
+  if (!_target.is_valid() || _target.w != root_rect.w ||
+      _target.h != root_rect.h) {
+    _target = _pixello.create_render_target(root_rect.w, root_rect.h);
+    _full_redraw = true;
+  }
+
+  // Back to the target of the caller after the redraw, the frame if none
+  const texture_t previous = _pixello.render_target();
+  auto restore_target = [&] {
+    if (previous.is_valid()) {
+      _pixello.set_render_target(previous);
+    } else {
+      _pixello.reset_render_target();
+    }
+  };
+
+  if (_full_redraw) {
+    _pixello.set_render_target(_target);
+    _pixello.clear_render_target(0x00000000);
+
+    for (size_t i = 0; i < _widgets.size(); ++i) {
+      render_widget(static_cast<widget_id_t>(i), false);
+    }
+
+    restore_target();
+    _full_redraw = false;
+  } else if (!_dirty.empty()) {
+    _pixello.set_render_target(_target);
+
+    for (const widget_id_t id : _dirty) {
+      render_widget(id, true);
+    }
+
+    restore_target();
+  }
+
+  _dirty.clear();
+
+  _pixello.draw_texture(_target, _origin.x, _origin.y);
+}
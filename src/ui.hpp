@@ -0,0 +1,143 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "glyph_cache.hpp"
+#include "pixello.hpp"
+#include "spatial_index.hpp"
+
+/*******************************************************************************
+ * RETAINED UI
+ ******************************************************************************/
+using widget_id_t = uint32_t;
+constexpr widget_id_t INVALID_WIDGET_ID = UINT32_MAX;
+
+enum class widget_type_t
+{
+  PANEL,
+  BUTTON,
+  LABEL,
+  TEXT_FIELD
+};
+
+enum class layout_t
+{
+  VERTICAL,
+  HORIZONTAL
+};
+
+// Panel colors are expected to be opaque, a widget that changes state is
+// redrawn on top of its parent background.
+struct ui_style_t
+{
+  pixel_t panel_color = 0x333333FF;
+  pixel_t label_color = 0xFFFFFFFF;
+  pixel_t button_color = 0xDDDDDDFF;
+  pixel_t button_hover_color = 0xEEEEEEFF;
+  pixel_t button_pressed_color = 0xAAAAAAFF;
+  pixel_t button_text_color = 0x000000FF;
+  pixel_t field_color = 0x888888FF;
+  pixel_t field_focus_color = 0xFFFFFFFF;
+  pixel_t field_text_color = 0x000000FF;
+  int32_t padding = 4;
+  int32_t spacing = 4;
+};
+
+// Widget tree laid out once and rendered into a cached texture. Only the
+// widgets that change state or text are re-rendered, so a static UI costs a
+// single texture copy per frame.
+class ui_t
+{
+private:
+  struct widget_t
+  {
+    widget_type_t type;
+    widget_id_t parent;
+    std::vector<widget_id_t> children;
+    layout_t layout = layout_t::VERTICAL;
+
+    rect_t rect = {0, 0, 0, 0};  // Relative to the ui origin
+    int32_t min_w = 0;
+    int32_t min_h = 0;
+
+    std::string text;
+    texture_t text_texture;
+    bool text_dirty = false;
+
+    spatial_id_t hit_id = INVALID_SPATIAL_ID;
+
+    // Text fields bound to an editable buffer
+    const text_buffer_t* buffer = nullptr;
+    uint64_t buffer_version = 0;
+    text_view_t view;
+  };
+
+  const pixello& _pixello;
+  font_t _font;
+  ui_style_t _style;
+  int32_t _line_h;
+
+  std::vector<widget_t> _widgets;
+  point_t _origin = {0, 0};
+
+  // Interactive widgets, used to resolve the hovered one
+  grid_index_t _hit_index;
+  std::vector<widget_id_t> _hit_widgets;
+
+  widget_id_t _hovered = INVALID_WIDGET_ID;
+  widget_id_t _pressed = INVALID_WIDGET_ID;
+  widget_id_t _focused = INVALID_WIDGET_ID;
+  widget_id_t _clicked = INVALID_WIDGET_ID;
+
+  std::unique_ptr<glyph_cache_t> _field_glyphs;
+
+  texture_t _target;
+  bool _layout_dirty = true;
+  bool _full_redraw = true;
+  std::vector<widget_id_t> _dirty;
+
+  widget_id_t add_widget(const widget_id_t parent, const widget_type_t type);
+  void check_id(const widget_id_t id) const;
+  void mark_dirty(const widget_id_t id);
+  void refresh_text(widget_t& w);
+  void measure(const widget_id_t id);
+  void place(const widget_id_t id, const int32_t x, const int32_t y);
+  void layout();
+  void render_widget(const widget_id_t id, const bool clear_background);
+  pixel_t background(const widget_id_t id) const;
+
+public:
+  ui_t(const pixello& p, const font_t& font, const ui_style_t& style = {});
+
+  // The root is a vertical panel
+  inline widget_id_t root() const { return 0; }
+
+  widget_id_t add_panel(const widget_id_t parent, const layout_t layout);
+  widget_id_t add_button(const widget_id_t parent,
+                         const std::string& text,
+                         const int32_t min_w = 0,
+                         const int32_t min_h = 0);
+  widget_id_t add_label(const widget_id_t parent, const std::string& text);
+  widget_id_t add_text_field(const widget_id_t parent, const int32_t w);
+
+  void set_text(const widget_id_t id, const std::string& text);
+
+  // The field shows the buffer with cursor and selection, and is redrawn only
+  // when the buffer changes. The buffer must outlive the ui.
+  void bind_text_buffer(const widget_id_t id, const text_buffer_t* buffer);
+  const std::string& text(const widget_id_t id) const;
+  const rect_t& rect(const widget_id_t id);
+
+  inline void set_position(const point_t& p) { _origin = p; }
+  inline const point_t& position() const { return _origin; }
+
+  // Hover, press and focus from the frame input snapshot
+  void update(const mouse_t& mouse);
+
+  inline bool clicked(const widget_id_t id) const { return _clicked == id; }
+  inline widget_id_t hovered() const { return _hovered; }
+  inline widget_id_t focused() const { return _focused; }
+
+  void draw();
+};
@@ -0,0 +1,156 @@
+#include <vector>
+#include "atlas.hpp"
+#include "check.hpp"
+
+
+bool overlap(const rect_t& a, const rect_t& b)
+{
+  return a.x < b.x + b.w && b.x < a.x + a.w && a.y < b.y + b.h &&
+         b.y < a.y + a.h;
+}
+
+
+bool inside(const rect_t& r, const int32_t w, const int32_t h)
+{
+  return r.x >= 0 && r.y >= 0 && r.x + r.w <= w && r.y + r.h <= h;
+}
+
+
+void check_fit()
+{
+  // Four quarters fill the page exactly
+  skyline_packer_t packer(64, 64);
+  std::vector<rect_t> rects;
+  for (int32_t i = 0; i < 4; ++i) {
+    rect_t r;
+    check(packer.pack(32, 32, r), "quarter " + STR(i) + " fits");
+    rects.push_back(r);
+  }
+
+  rect_t r;
+  check(!packer.pack(1, 1, r), "full page");
+  check(packer.occupancy() == 1.0f, "full occupancy");
+  check(packer.used_width() == 64 && packer.used_height() == 64,
+        "full extent");
+
+  bool ok = true;
+  for (size_t i = 0; i < rects.size(); ++i) {
+    for (size_t j = i + 1; j < rects.size(); ++j) {
+      ok = ok && !overlap(rects[i], rects[j]);
+    }
+  }
+  check(ok, "quarters overlap");
+
+  // The extent follows what was packed, back to nothing on reset
+  packer.reset();
+  check(packer.used_width() == 0 && packer.used_height() == 0,
+        "extent after reset");
+  check(packer.pack(20, 10, r) && r.x == 0 && r.y == 0, "first rect");
+  check(packer.pack(8, 30, r), "second rect");
+  check(packer.used_width() == 28 && packer.used_height() == 30,
+        "extent of two rects");
+
+  check(!packer.pack(65, 1, r) && !packer.pack(1, 65, r),
+        "bigger than the page");
+}
+
+
+void check_new_page()
+{
+  // As load_atlas() does, a rect that fits no page opens a new one
+  std::vector<skyline_packer_t> packers;
+  std::vector<size_t> pages;
+
+  for (int32_t i = 0; i < 5; ++i) {
+    rect_t r;
+    size_t page = 0;
+    while (page < packers.size() && !packers[page].pack(40, 40, r)) { ++page; }
+
+    if (page == packers.size()) {
+      packers.emplace_back(64, 64);
+      check(packers.back().pack(40, 40, r), "fits a new page");
+    }
+
+    check(r.x == 0 && r.y == 0, "alone at the origin of its page");
+    pages.push_back(page);
+  }
+
+  check(packers.size() == 5 && pages.back() == 4, "one page each");
+  check(packers[0].used_width() == 40 && packers[0].used_height() == 40,
+        "page extent");
+}
+
+
+void check_padding_and_overlaps()
+{
+  // Sizes of every kind, padded as load_atlas() does, until the page is full
+  constexpr int32_t page = 256;
+  constexpr int32_t padding = 2;
+  skyline_packer_t packer(page, page);
+  std::vector<rect_t> images;
+
+  uint32_t seed = 7;
+  for (int32_t i = 0; i < 400; ++i) {
+    seed = seed * 1664525u + 1013904223u;
+    const int32_t w = 1 + static_cast<int32_t>((seed >> 8) % 40);
+    const int32_t h = 1 + static_cast<int32_t>((seed >> 20) % 40);
+
+    rect_t r;
+    if (!packer.pack(w + 2 * padding, h + 2 * padding, r)) { continue; }
+    images.push_back({r.x + padding, r.y + padding, w, h});
+  }
+
+  check(images.size() > 20, "enough images packed");
+
+  // Grown by the padding the images still do not touch, and stay in the
+  // page and in its extent
+  bool ok = true;
+  for (size_t i = 0; i < images.size(); ++i) {
+    const rect_t& a = images[i];
+    const rect_t padded = {a.x - padding, a.y - padding, a.w + 2 * padding,
+                           a.h + 2 * padding};
+    ok = ok && inside(padded, page, page) &&
+         inside(padded, packer.used_width(), packer.used_height());
+
+    for (size_t j = i + 1; j < images.size(); ++j) {
+      const rect_t& b = images[j];
+      const rect_t other = {b.x - padding, b.y - padding, b.w + 2 * padding,
+                            b.h + 2 * padding};
+      ok = ok && !overlap(padded, other);
+    }
+  }
+  check(ok, "padded images overlap or leave the page");
+}
+
+
+void check_invalid()
+{
+  bool thrown = false;
+  try {
+    skyline_packer_t packer(0, 64);
+  } catch (const input_exception&) {
+    thrown = true;
+  }
+  check(thrown, "empty page throws");
+
+  thrown = false;
+  try {
+    skyline_packer_t packer(64, 64);
+    rect_t r;
+    packer.pack(0, 4, r);
+  } catch (const input_exception&) {
+    thrown = true;
+  }
+  check(thrown, "empty rect throws");
+}
+
+
+int main()
+{
+  check_fit();
+  check_new_page();
+  check_padding_and_overlaps();
+  check_invalid();
+
+  return report("atlas");
+}
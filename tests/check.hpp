@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+/*******************************************************************************
+ * CHECKS
+ ******************************************************************************/
+// For the tests checking values. Failures are printed and counted, main()
+// returns report() so that any of them fails the test.
+
+inline uint32_t failures = 0;
+
+
+inline void check(const bool ok, const std::string& what)
+{
+  if (ok) { return; }
+
+  std::cout << "FAILED: " << what << std::endl;
+  ++failures;
+}
+
+
+inline int report(const std::string& name)
+{
+  if (failures == 0) { return 0; }
+
+  std::cout << failures << " " << name << " checks failed" << std::endl;
+  return 1;
+}
@@ -0,0 +1,140 @@
+#include <chrono>
+#include <iostream>
+#include <vector>
+#include "collision_mask.hpp"
+#include "image.hpp"
+
+constexpr int32_t world_size = 1024;
+constexpr size_t sprite_count = 1000;
+constexpr int32_t frame_count = 60;
+
+using bench_clock = std::chrono::steady_clock;
+
+struct sprite_t
+{
+  const collision_mask_t* mask;
+  point_t pos;
+};
+
+
+double elapsed_ms(const bench_clock::time_point& start)
+{
+  const auto end = bench_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+
+// A ring, solid only at the edge, so the bounding boxes overlap a lot more
+// often than the pixels
+image_t ring_image(const int32_t size, const int32_t thickness)
+{
+  image_t image(size, size);
+  const float c = (size - 1) * 0.5f;
+
+  for (int32_t y = 0; y < size; ++y) {
+    for (int32_t x = 0; x < size; ++x) {
+      const float d2 = (x - c) * (x - c) + (y - c) * (y - c);
+      const float outer = c;
+      const float inner = c - thickness;
+      if (d2 <= outer * outer && d2 >= inner * inner) {
+        image.at(x, y) = pixel_t(255, 255, 255, 255);
+      }
+    }
+  }
+
+  return image;
+}
+
+
+// Reference, pixel by pixel
+bool slow_collides(const sprite_t& a, const sprite_t& b)
+{
+  for (int32_t y = 0; y < a.mask->h(); ++y) {
+    for (int32_t x = 0; x < a.mask->w(); ++x) {
+      const point_t p = {a.pos.x + x, a.pos.y + y};
+      if (a.mask->contains(a.pos, p) && b.mask->contains(b.pos, p)) {
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+
+int main()
+{
+  const collision_mask_t small(ring_image(24, 4));
+  const collision_mask_t large(ring_image(100, 6));
+
+  uint32_t seed = 7;
+  auto random = [&seed](const int32_t n) {
+    seed = seed * 1664525u + 1013904223u;
+    return static_cast<int32_t>((seed >> 8) % n);
+  };
+
+  std::vector<sprite_t> sprites(sprite_count);
+  std::vector<point_t> velocities(sprite_count);
+  for (size_t i = 0; i < sprite_count; ++i) {
+    sprites[i] = {i % 8 == 0 ? &large : &small,
+                  {random(world_size), random(world_size)}};
+    velocities[i] = {random(7) - 3, random(7) - 3};
+  }
+
+  // Every pair, as a game without a spatial index would
+  const size_t pairs = sprite_count * (sprite_count - 1) / 2;
+  size_t boxes = 0;
+  size_t hits = 0;
+  size_t mismatches = 0;
+  double total_ms = 0.0;
+
+  for (int32_t frame = 0; frame < frame_count; ++frame) {
+    for (size_t i = 0; i < sprite_count; ++i) {
+      point_t& p = sprites[i].pos;
+      p.x = (p.x + velocities[i].x) & (world_size - 1);
+      p.y = (p.y + velocities[i].y) & (world_size - 1);
+    }
+
+    const auto start = bench_clock::now();
+    for (size_t i = 0; i < sprite_count; ++i) {
+      for (size_t j = i + 1; j < sprite_count; ++j) {
+        hits += collision_mask_t::collides(*sprites[i].mask, sprites[i].pos,
+                                           *sprites[j].mask, sprites[j].pos);
+      }
+    }
+    total_ms += elapsed_ms(start);
+
+    // Checked outside of the timing
+    for (size_t i = 0; i < sprite_count; ++i) {
+      for (size_t j = i + 1; j < sprite_count; ++j) {
+        const sprite_t& a = sprites[i];
+        const sprite_t& b = sprites[j];
+        const rect_t ra = a.mask->rect(a.pos);
+        const rect_t rb = b.mask->rect(b.pos);
+        if (ra.x >= rb.x + rb.w || rb.x >= ra.x + ra.w ||
+            ra.y >= rb.y + rb.h || rb.y >= ra.y + ra.h) {
+          continue;
+        }
+
+        ++boxes;
+        if (frame % 10 == 0 &&
+            collision_mask_t::collides(*a.mask, a.pos, *b.mask, b.pos) !=
+                slow_collides(a, b)) {
+          ++mismatches;
+        }
+      }
+    }
+  }
+
+  std::cout << pairs << " pairs per frame, " << boxes / frame_count
+            << " box overlaps, " << hits / frame_count
+            << " pixel collisions, avg: " << total_ms / frame_count << "ms"
+            << std::endl;
+
+  if (mismatches != 0) {
+    std::cout << mismatches << " mismatches with the reference" << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
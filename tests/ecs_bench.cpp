@@ -0,0 +1,134 @@
+#include <chrono>
+#include <iostream>
+#include "ecs.hpp"
+#include "job_system.hpp"
+
+constexpr size_t entity_count = 100000;
+constexpr int32_t frame_count = 600;
+constexpr float frame_dt = 1.0f / 60.0f;
+constexpr float world_size = 1000.0f;
+
+using bench_clock = std::chrono::steady_clock;
+
+struct position_t
+{
+  float x, y;
+};
+
+struct velocity_t
+{
+  float x, y;
+};
+
+// What a draw list needs for the entity, advanced by the animation system
+struct sprite_t
+{
+  uint32_t frame;
+  float time;
+  pixel_t tint;
+};
+
+
+static void setup(registry_t& registry,
+                  system_scheduler_t& scheduler,
+                  job_system_t* jobs)
+{
+  uint32_t seed = 42;
+  auto random = [&seed]() {
+    seed = seed * 1664525u + 1013904223u;
+    return (seed >> 8) / static_cast<float>(1 << 24);
+  };
+
+  for (size_t i = 0; i < entity_count; ++i) {
+    const entity_t e = registry.create();
+    registry.add<position_t>(e, random() * world_size, random() * world_size);
+    registry.add<velocity_t>(e, random() * 200.0f - 100.0f,
+                             random() * 200.0f - 100.0f);
+
+    // Some entities are static and not animated, as in a real scene
+    if (i % 4 != 0) { registry.add<sprite_t>(e, 0u, 0.0f, 0xFFFFFFFF); }
+  }
+
+  // Positions walked in the order of the velocities
+  registry.align<position_t, velocity_t>();
+
+  // Split in ranges when there is a job system
+  scheduler.add(
+      "movement",
+      [jobs](registry_t& r, const float dt) {
+        const auto view = r.view<velocity_t, position_t>();
+        auto move = [&view, dt](const size_t begin, const size_t end) {
+          view.each(begin, end, [dt](entity_t, velocity_t& v, position_t& p) {
+            p.x += v.x * dt;
+            p.y += v.y * dt;
+          });
+        };
+
+        if (jobs) {
+          jobs->parallel_for(0, view.size_hint(), 8192, move);
+        } else {
+          move(0, view.size_hint());
+        }
+      },
+      system_access_t().write<position_t>().read<velocity_t>());
+
+  // Independent of the movement, shares a stage with it
+  scheduler.add(
+      "animation",
+      [](registry_t& r, const float dt) {
+        r.view<sprite_t>().each([dt](entity_t, sprite_t& s) {
+          s.time += dt;
+          if (s.time >= 0.1f) {
+            s.time -= 0.1f;
+            s.frame = (s.frame + 1) & 7;
+          }
+        });
+      },
+      system_access_t().write<sprite_t>());
+
+  // Needs the new positions, starts a new stage
+  scheduler.add(
+      "bounce",
+      [](registry_t& r, const float) {
+        r.view<velocity_t, position_t>().each(
+            [](entity_t, velocity_t& v, const position_t& p) {
+              if (p.x < 0.0f || p.x > world_size) { v.x = -v.x; }
+              if (p.y < 0.0f || p.y > world_size) { v.y = -v.y; }
+            });
+      },
+      system_access_t().write<velocity_t>().read<position_t>());
+}
+
+
+static double bench(job_system_t* jobs)
+{
+  registry_t registry;
+  system_scheduler_t scheduler(jobs);
+  setup(registry, scheduler, jobs);
+
+  double total_ms = 0.0;
+  for (int32_t i = 0; i < frame_count; ++i) {
+    const auto start = bench_clock::now();
+    scheduler.run(registry, frame_dt);
+    total_ms += std::chrono::duration<double, std::milli>(bench_clock::now() -
+                                                          start)
+                    .count();
+  }
+
+  std::cout << entity_count << " entities, " << scheduler.stages()
+            << " stages, "
+            << (jobs ? STR(jobs->workers()) + " workers" : "serial")
+            << " update avg: " << total_ms / frame_count << "ms" << std::endl;
+
+  return registry.size() == entity_count ? total_ms : -1.0;
+}
+
+
+int main()
+{
+  job_system_t jobs;
+
+  if (bench(nullptr) < 0.0 || bench(&jobs) < 0.0) { return 1; }
+
+  return 0;
+}
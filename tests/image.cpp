@@ -0,0 +1,323 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "image.hpp"
+#include "check.hpp"
+
+// Single pixel rows and columns, and widths that are not a multiple of the
+// 4 pixel steps or of the 16 pixel stride
+const std::vector<std::pair<int32_t, int32_t>> sizes = {
+    {1, 1}, {1, 9}, {9, 1}, {7, 3}, {13, 5}, {17, 4}, {33, 2}};
+
+
+std::string size_str(const image_t& image)
+{
+  return STR(image.w()) + "x" + STR(image.h());
+}
+
+
+image_t random_image(const int32_t w, const int32_t h, uint32_t seed)
+{
+  image_t image(w, h);
+  for (int32_t y = 0; y < h; ++y) {
+    for (int32_t x = 0; x < w; ++x) {
+      seed = seed * 1664525u + 1013904223u;
+      image.at(x, y) = pixel_t(seed);
+    }
+  }
+
+  return image;
+}
+
+
+uint8_t rounded_mul(const uint8_t x, const uint8_t f)
+{
+  return static_cast<uint8_t>(std::lround(x * f / 255.0));
+}
+
+
+bool near(const pixel_t& a, const pixel_t& b, const int32_t tolerance)
+{
+  return std::abs(a.r - b.r) <= tolerance && std::abs(a.g - b.g) <= tolerance &&
+         std::abs(a.b - b.b) <= tolerance && std::abs(a.a - b.a) <= tolerance;
+}
+
+
+// Every pixel of out against f(pixel of in)
+template <typename F>
+bool per_pixel(const image_t& in, const image_t& out, F f)
+{
+  for (int32_t y = 0; y < in.h(); ++y) {
+    for (int32_t x = 0; x < in.w(); ++x) {
+      if (out.at(x, y) != f(in.at(x, y))) { return false; }
+    }
+  }
+
+  return true;
+}
+
+
+void check_pixel_kernels()
+{
+  for (const auto& [w, h] : sizes) {
+    const image_t source = random_image(w, h, w * 31 + h);
+
+    image_t image = source;
+    image.premultiply();
+    check(per_pixel(source, image,
+                    [](const pixel_t& c) {
+                      return pixel_t(rounded_mul(c.r, c.a),
+                                     rounded_mul(c.g, c.a),
+                                     rounded_mul(c.b, c.a), c.a);
+                    }),
+          "premultiply " + size_str(image));
+
+    const pixel_t color(255, 128, 0, 200);
+    image = source;
+    image.tint(color);
+    check(per_pixel(source, image,
+                    [&](const pixel_t& c) {
+                      return pixel_t(rounded_mul(c.r, color.r),
+                                     rounded_mul(c.g, color.g),
+                                     rounded_mul(c.b, color.b),
+                                     rounded_mul(c.a, color.a));
+                    }),
+          "tint " + size_str(image));
+
+    image = source;
+    image.grayscale();
+    check(per_pixel(source, image,
+                    [](const pixel_t& c) {
+                      const uint8_t y = static_cast<uint8_t>(
+                          (77 * c.r + 150 * c.g + 29 * c.b + 128) >> 8);
+                      return pixel_t(y, y, y, c.a);
+                    }),
+          "grayscale " + size_str(image));
+  }
+
+  // Known values
+  image_t image(3, 1);
+  image.at(0, 0) = pixel_t(200, 100, 50, 128);
+  image.at(1, 0) = pixel_t(200, 100, 50, 0);
+  image.at(2, 0) = pixel_t(200, 100, 50, 255);
+  image.premultiply();
+  check(image.at(0, 0) == pixel_t(100, 50, 25, 128) &&
+            image.at(1, 0) == pixel_t(0, 0, 0, 0) &&
+            image.at(2, 0) == pixel_t(200, 100, 50, 255),
+        "premultiply known values");
+
+  image = image_t(2, 1);
+  image.at(0, 0) = pixel_t(255, 255, 255, 255);
+  image.at(1, 0) = pixel_t(255, 0, 0, 10);
+  image.grayscale();
+  check(image.at(0, 0) == pixel_t(255, 255, 255, 255) &&
+            image.at(1, 0) == pixel_t(77, 77, 77, 10),
+        "grayscale known values");
+}
+
+
+// Plain box filter, the edges repeat the border pixels
+image_t reference_box_blur(const image_t& in, const int32_t r)
+{
+  auto pass = [r](const image_t& src, const bool vertical) {
+    image_t out(src.w(), src.h());
+    for (int32_t y = 0; y < src.h(); ++y) {
+      for (int32_t x = 0; x < src.w(); ++x) {
+        double sum[4] = {0, 0, 0, 0};
+        for (int32_t k = -r; k <= r; ++k) {
+          const int32_t sx = vertical ? x : std::clamp(x + k, 0, src.w() - 1);
+          const int32_t sy = vertical ? std::clamp(y + k, 0, src.h() - 1) : y;
+          const pixel_t& c = src.at(sx, sy);
+          sum[0] += c.r;
+          sum[1] += c.g;
+          sum[2] += c.b;
+          sum[3] += c.a;
+        }
+
+        auto avg = [&](const int i) {
+          return static_cast<uint8_t>(std::lround(sum[i] / (2 * r + 1)));
+        };
+        out.at(x, y) = pixel_t(avg(0), avg(1), avg(2), avg(3));
+      }
+    }
+    return out;
+  };
+
+  return pass(pass(in, false), true);
+}
+
+
+void check_blurs()
+{
+  for (const auto& [w, h] : sizes) {
+    const image_t source = random_image(w, h, w * 7 + h * 3);
+
+    // Radii larger than the image too. Rounded twice, off by one at most.
+    for (const int32_t r : {1, 2, 5, 40}) {
+      image_t image = source;
+      image.box_blur(r);
+      const image_t expected = reference_box_blur(source, r);
+
+      bool ok = true;
+      for (int32_t y = 0; y < h; ++y) {
+        for (int32_t x = 0; x < w; ++x) {
+          ok = ok && near(image.at(x, y), expected.at(x, y), 1);
+        }
+      }
+      check(ok, "box blur " + size_str(image) + ", radius " + STR(r));
+    }
+  }
+
+  // A white dot spread over its row and column
+  image_t dot(5, 5, pixel_t(0, 0, 0, 255));
+  dot.at(2, 2) = pixel_t(255, 255, 255, 255);
+  dot.box_blur(1);
+  bool ok = true;
+  for (int32_t y = 0; y < 5; ++y) {
+    for (int32_t x = 0; x < 5; ++x) {
+      const bool inside = std::abs(x - 2) <= 1 && std::abs(y - 2) <= 1;
+      const uint8_t v = inside ? 28 : 0;  // 255 / 9
+      ok = ok && dot.at(x, y) == pixel_t(v, v, v, 255);
+    }
+  }
+  check(ok, "box blur known values");
+
+  // Flat stays flat, a dot stays symmetric and peaks in the middle
+  image_t flat(13, 7, pixel_t(10, 20, 30, 40));
+  flat.gaussian_blur(2.0f);
+  check(per_pixel(flat, flat,
+                  [](const pixel_t&) { return pixel_t(10, 20, 30, 40); }),
+        "gaussian blur of a flat image");
+
+  image_t blurred(21, 21, pixel_t(0, 0, 0, 0));
+  blurred.at(10, 10) = pixel_t(255, 255, 255, 255);
+  blurred.gaussian_blur(1.5f);
+  ok = blurred.at(10, 10).r > blurred.at(11, 10).r;
+  for (int32_t y = 0; y < 21; ++y) {
+    for (int32_t x = 0; x < 21; ++x) {
+      ok = ok && blurred.at(x, y) == blurred.at(20 - x, y) &&
+           blurred.at(x, y) == blurred.at(y, x);
+    }
+  }
+  for (int32_t x = 10; x < 20; ++x) {
+    ok = ok && blurred.at(x, 10).r >= blurred.at(x + 1, 10).r;
+  }
+  check(ok, "gaussian blur of a dot");
+}
+
+
+void check_scaling()
+{
+  // Nearest, each pixel doubled, then every other one kept
+  image_t small(3, 1);
+  small.at(0, 0) = 0x112233FF;
+  small.at(1, 0) = 0x445566FF;
+  small.at(2, 0) = 0x778899FF;
+
+  const image_t doubled = small.scaled(6, 2, scale_filter_t::NEAREST);
+  bool ok = doubled.w() == 6 && doubled.h() == 2;
+  for (int32_t y = 0; y < 2; ++y) {
+    for (int32_t x = 0; x < 6; ++x) {
+      ok = ok && doubled.at(x, y) == small.at(x / 2, 0);
+    }
+  }
+  check(ok, "nearest upscale");
+
+  const image_t halved = doubled.scaled(3, 1, scale_filter_t::NEAREST);
+  check(per_pixel(small, halved, [](const pixel_t& c) { return c; }),
+        "nearest downscale");
+
+  // Bilinear between black and white, on pixel centers
+  image_t ramp(2, 1);
+  ramp.at(0, 0) = pixel_t(0, 0, 0, 255);
+  ramp.at(1, 0) = pixel_t(255, 255, 255, 255);
+
+  const image_t wide = ramp.scaled(4, 1, scale_filter_t::BILINEAR);
+  const uint8_t expected[4] = {0, 63, 191, 255};
+  ok = true;
+  for (int32_t x = 0; x < 4; ++x) {
+    const uint8_t v = expected[x];
+    ok = ok && wide.at(x, 0) == pixel_t(v, v, v, 255);
+  }
+  check(ok, "bilinear known values");
+
+  for (const auto& [w, h] : sizes) {
+    const image_t source = random_image(w, h, w + h * 5);
+
+    const image_t same = source.scaled(w, h, scale_filter_t::BILINEAR);
+    check(per_pixel(source, same, [](const pixel_t& c) { return c; }),
+          "bilinear at the same size " + size_str(source));
+
+    const image_t flat(w, h, pixel_t(90, 180, 45, 200));
+    const image_t scaled = flat.scaled(w * 2 + 1, h + 2,
+                                       scale_filter_t::BILINEAR);
+    ok = true;
+    for (int32_t y = 0; y < scaled.h(); ++y) {
+      for (int32_t x = 0; x < scaled.w(); ++x) {
+        ok = ok && scaled.at(x, y) == pixel_t(90, 180, 45, 200);
+      }
+    }
+    check(ok, "bilinear of a flat image " + size_str(source));
+  }
+}
+
+
+void check_alpha_bleed()
+{
+  const pixel_t clear(0, 0, 0, 0);
+  const pixel_t red(255, 0, 0, 255);
+  const pixel_t blue(0, 0, 255, 255);
+
+  // One ring per pass, the colors stay transparent
+  image_t line(5, 1, clear);
+  line.at(0, 0) = red;
+  line.alpha_bleed(1);
+  check(line.at(1, 0) == pixel_t(255, 0, 0, 0) && line.at(2, 0) == clear,
+        "alpha bleed, one pass");
+
+  // Bled pixels are still transparent, so they do not count as opaque
+  line.alpha_bleed(2);
+  check(line.at(2, 0) == pixel_t(255, 0, 0, 0) && line.at(3, 0) == clear &&
+            line.at(0, 0) == red,
+        "alpha bleed, more passes");
+
+  // Averaged between the two opaque neighbors
+  image_t square(3, 3, clear);
+  square.at(0, 0) = red;
+  square.at(2, 0) = blue;
+  square.alpha_bleed(1);
+  check(square.at(1, 0) == pixel_t(127, 0, 127, 0) &&
+            square.at(1, 1) == pixel_t(127, 0, 127, 0) &&
+            square.at(0, 1) == pixel_t(255, 0, 0, 0) &&
+            square.at(2, 1) == pixel_t(0, 0, 255, 0) &&
+            square.at(1, 2) == clear,
+        "alpha bleed known values");
+
+  // Nothing to give
+  image_t empty(1, 4, clear);
+  empty.alpha_bleed(3);
+  check(empty.at(0, 3) == clear, "alpha bleed without opaque pixels");
+}
+
+
+int main()
+{
+  // The SSE2 kernels where built, then the plain loops
+  for (const bool simd : {true, false}) {
+    image_t::simd = simd;
+    const uint32_t before = failures;
+
+    check_pixel_kernels();
+    check_blurs();
+    check_scaling();
+    check_alpha_bleed();
+
+    if (failures != before) {
+      std::cout << "with simd: " << STR(simd) << std::endl;
+    }
+  }
+
+  return report("image");
+}
@@ -0,0 +1,138 @@
+#include <filesystem>
+#include <iostream>
+#include <vector>
+#include "input_record.hpp"
+#include "check.hpp"
+
+
+bool same_button(const button_key_t& a, const button_key_t& b)
+{
+  return a.state == b.state && a.click == b.click &&
+         a.double_click == b.double_click;
+}
+
+
+bool same_frame(const input_frame_t& a, const input_frame_t& b)
+{
+  const mouse_t& ma = a.mouse;
+  const mouse_t& mb = b.mouse;
+
+  return a.dt_us == b.dt_us && a.keys == b.keys && ma.x == mb.x &&
+         ma.y == mb.y && ma.relative_x == mb.relative_x &&
+         ma.relative_y == mb.relative_y &&
+         ma.did_mouse_moved == mb.did_mouse_moved &&
+         ma.left_button_pressed == mb.left_button_pressed &&
+         ma.central_button_pressed == mb.central_button_pressed &&
+         ma.right_button_pressed == mb.right_button_pressed &&
+         same_button(ma.left_button, mb.left_button) &&
+         same_button(ma.central_button, mb.central_button) &&
+         same_button(ma.right_button, mb.right_button) &&
+         a.has_text == b.has_text &&
+         (!a.has_text || (a.text == b.text && a.cursor == b.cursor &&
+                          a.anchor == b.anchor));
+}
+
+
+std::vector<input_frame_t> sample_frames()
+{
+  std::vector<input_frame_t> frames;
+
+  input_frame_t idle;
+  idle.dt_us = 16667;
+  idle.mouse.relative_x = 0;
+  idle.mouse.relative_y = 0;
+  frames.push_back(idle);
+
+  // Moving left and up, every button in a different state
+  input_frame_t moved;
+  moved.dt_us = 33334;
+  moved.mouse.x = 1919;
+  moved.mouse.y = 0;
+  moved.mouse.relative_x = -12;
+  moved.mouse.relative_y = -2147483647;
+  moved.mouse.did_mouse_moved = true;
+  moved.mouse.left_button_pressed = true;
+  moved.mouse.right_button_pressed = true;
+  moved.mouse.left_button = {button_key_t::DOWN, true, true};
+  moved.mouse.central_button = {button_key_t::UP, true, false};
+  moved.mouse.right_button = {button_key_t::DOWN, false, false};
+  moved.keys = 0x8000000000000001ull;
+  frames.push_back(moved);
+
+  input_frame_t text = idle;
+  text.mouse.central_button_pressed = true;
+  text.has_text = true;
+  text.text = "h\xC3\xA9llo";
+  text.cursor = 6;
+  text.anchor = 2;
+  frames.push_back(text);
+
+  // Emptied text field
+  input_frame_t cleared = idle;
+  cleared.has_text = true;
+  frames.push_back(cleared);
+
+  return frames;
+}
+
+
+int main()
+{
+  const std::filesystem::path path =
+      std::filesystem::temp_directory_path() / "pixello_input_record.bin";
+  const std::vector<input_frame_t> frames = sample_frames();
+
+  {
+    input_recorder_t recorder(path.string());
+    for (const input_frame_t& f : frames) { recorder.write(f); }
+  }
+
+  // Round trip
+  {
+    input_player_t player(path.string());
+    input_frame_t f;
+    for (size_t i = 0; i < frames.size(); ++i) {
+      check(player.read(f), "read frame " + STR(i));
+      check(same_frame(f, frames[i]), "same frame " + STR(i));
+    }
+    check(!player.read(f), "end of the log");
+    check(player.frames() == frames.size(), "frame count");
+  }
+
+  // Cut inside the text of the third frame, as after a crash. A record is
+  // dt, flags, 4 mouse values and keys, then the text length, the text,
+  // the cursor and the anchor when it has text.
+  {
+    const uintmax_t record = 4 + 2 + 4 * 4 + 8;
+    const uintmax_t cleared = record + 4 + 0 + 4 + 4;
+    const uintmax_t cut = cleared + 4 + 4 + 3;  // Anchor, cursor, 3 bytes
+
+    const uintmax_t size = std::filesystem::file_size(path);
+    check(size == 8 + 4 * record + 2 * 12 + frames[2].text.size(),
+          "log size");
+    std::filesystem::resize_file(path, size - cut);
+
+    input_player_t player(path.string());
+    input_frame_t f;
+    check(player.read(f) && player.read(f), "frames before the cut");
+    check(!player.read(f), "truncated record");
+    check(player.frames() == 2, "truncated record is not counted");
+  }
+
+  // Not a log
+  {
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << "PXIM";
+
+    bool thrown = false;
+    try {
+      input_player_t player(path.string());
+    } catch (const load_exceptions&) {
+      thrown = true;
+    }
+    check(thrown, "bad header");
+  }
+
+  std::filesystem::remove(path);
+
+  return report("input record");
+}
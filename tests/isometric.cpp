@@ -1,6 +1,7 @@
 #include <math.h>
 #include <algorithm>
 #include <vector>
+#include "draw_list.hpp"
 #include "pixello.hpp"
 
 constexpr int screen_w = 800;
@@ -14,9 +15,20 @@ constexpr int world_h = 10;
 constexpr int tile_w = 40;
 constexpr int tile_h = 20;
 
-// Where to place tile (0,0) on screen (in tile size steps)
+// Camera speeds, per performance counter tick
 constexpr float scroll_speed = 0.0000007f;
-point_t map_render_offset = {200, 200};
+constexpr float zoom_speed = 0.000000002f;
+constexpr float rotation_speed = 0.000000001f;
+
+// The main view starts with tile (0,0) at {200, 200} on screen
+view_t main_view = {{0, 0, screen_w, screen_h}, {200.0f, 0.0f, 1.0f, 0.0f}};
+view_t minimap_view = {{screen_w - 210, 10, 200, 100},
+                       {200.0f, 0.0f, 0.25f, 0.0f}};
+
+// World recorded once, rebuilt only when a tile changes
+draw_list_t world_list;
+draw_list_t cursor_list;
+bool world_dirty = true;
 
 // Sprite that holds all imagery
 constexpr int sprite_w = 40;
@@ -28,17 +40,14 @@ font_t font;
 int world[world_h][world_w];
 
 
-point_t coord_screen_to_map(const point_t screen_coord)
+point_t coord_world_to_map(const float wx, const float wy)
 {
   point_t tile_coord;
 
   float sx, sy;
 
-  sx = screen_coord.x - (tile_w / 2.0f);
-  sy = screen_coord.y - (tile_h / 2.0f);
-
-  sx -= map_render_offset.x;
-  sy -= map_render_offset.y;
+  sx = wx - (tile_w / 2.0f);
+  sy = wy - (tile_h / 2.0f);
 
   tile_coord.x = static_cast<int>(roundf(((sx / tile_w) - (sy / tile_h))));
   tile_coord.y = static_cast<int>(roundf(((sx / tile_w) + (sy / tile_h))));
@@ -47,15 +56,12 @@ point_t coord_screen_to_map(const point_t screen_coord)
 }
 
 
-point_t coord_map_to_screen(const point_t& map_cord)
+point_t coord_map_to_world(const point_t& map_cord)
 {
   point_t iso_coord;
 
-  iso_coord.x = map_render_offset.x +
-                ((map_cord.x * tile_w / 2) + (map_cord.y * tile_w / 2));
-
-  iso_coord.y = map_render_offset.y +
-                ((map_cord.y * tile_h / 2) - (map_cord.x * tile_h / 2));
+  iso_coord.x = (map_cord.x * tile_w / 2) + (map_cord.y * tile_w / 2);
+  iso_coord.y = (map_cord.y * tile_h / 2) - (map_cord.x * tile_h / 2);
 
   return iso_coord;
 }
@@ -98,31 +104,101 @@ private:
       // Check if we have to quit the game
       if (is_key_pressed(keycap_t::ESC)) { stop(); }
 
-      if (is_key_pressed(keycap_t::LEFT)) {
-        map_render_offset.x -=
-            static_cast<int>(floorf(scroll_speed * delta_time()));
-      }
-      if (is_key_pressed(keycap_t::RIGHT)) {
-        map_render_offset.x +=
-            static_cast<int>(floorf(scroll_speed * delta_time()));
+      camera_t& camera = main_view.camera;
+      const float dt = static_cast<float>(delta_time());
+      const float scroll = scroll_speed * dt / camera.zoom;
+
+      if (is_key_pressed(keycap_t::LEFT)) { camera.x += scroll; }
+      if (is_key_pressed(keycap_t::RIGHT)) { camera.x -= scroll; }
+      if (is_key_pressed(keycap_t::UP)) { camera.y += scroll; }
+      if (is_key_pressed(keycap_t::DOWN)) { camera.y -= scroll; }
+
+      if (is_key_pressed(keycap_t::Z)) { camera.zoom += zoom_speed * dt; }
+      if (is_key_pressed(keycap_t::X)) {
+        camera.zoom = std::max(0.1f, camera.zoom - zoom_speed * dt);
       }
-      if (is_key_pressed(keycap_t::UP)) {
-        map_render_offset.y -=
-            static_cast<int>(floorf(scroll_speed * delta_time()));
+
+      if (is_key_pressed(keycap_t::Q)) {
+        camera.rotation -= rotation_speed * dt;
       }
-      if (is_key_pressed(keycap_t::DOWN)) {
-        map_render_offset.y +=
-            static_cast<int>(floorf(scroll_speed * delta_time()));
+      if (is_key_pressed(keycap_t::E)) {
+        camera.rotation += rotation_speed * dt;
       }
     }
 
     // Clear screen
     draw_rect({0, 0, screen_w, screen_h}, 0xFFFFFFFF);
 
+    if (world_dirty) {
+      build_world();
+      world_dirty = false;
+    }
+
+    // The same recorded world goes to both views
+    submit(world_list, main_view);
+
+    // Selected tile
+    const int mouse_x = mouse_state().x;
+    const int mouse_y = mouse_state().y;
+
+    float world_x, world_y;
+    main_view.to_world({mouse_x, mouse_y}, world_x, world_y);
+
+    const point_t selected_tile = coord_world_to_map(world_x, world_y);
+    const point_t world_selected_tile = coord_map_to_world(selected_tile);
+
+    rect_t position;
+    rect_t sprite_crop;
+    position.x = world_selected_tile.x;
+    position.y = world_selected_tile.y;
+    position.w = tile_w;
+    position.h = tile_h;
+
+    sprite_crop.x = 0 * sprite_w;
+    sprite_crop.y = 0 * sprite_h;
+    sprite_crop.w = sprite_w;
+    sprite_crop.h = sprite_h;
+
+    cursor_list.clear();
+    cursor_list.add_sprite(sprites, position, sprite_crop);
+    submit(cursor_list, main_view);
+
+    // Minimap
+    set_current_viewport(minimap_view.viewport, 0xDDDDDDFF);
+    submit(world_list, minimap_view);
+    submit(cursor_list, minimap_view);
+
+    // Draw coordinates
+    const texture_t mouse_coord_text = create_text(
+        "Mouse: " + STR(mouse_x) + ", " + STR(mouse_y), 0x000000FF, font);
+
+    const texture_t tile_coord_text = create_text(
+        "Tile: " + STR(selected_tile.x) + ", " + STR(selected_tile.y),
+        0x000000FF, font);
+
+    reset_viewport();
+    draw_texture(mouse_coord_text, 5, 5);
+    draw_texture(tile_coord_text, 5, 20);
+
+    // Change the tile
+    if (mouse_state().left_button.click) {
+      if (selected_tile.x < world_w && selected_tile.x >= 0 &&
+          selected_tile.y < world_h && selected_tile.y >= 0) {
+        const int current_val = world[selected_tile.y][selected_tile.x];
+        world[selected_tile.y][selected_tile.x] = (current_val + 1) % 6;
+        world_dirty = true;
+      }
+    }
+  }
+
+  void build_world()
+  {
+    world_list.clear();
+
     // Draw in this order to draw first the objects that are more far away
     for (int x = (world_w - 1); x > -1; --x) {
       for (int y = 0; y < world_h; ++y) {
-        const point_t screen_pos = coord_map_to_screen({x, y});
+        const point_t world_pos = coord_map_to_world({x, y});
 
         const int cell_elem = world[y][x];
         rect_t position;
@@ -131,8 +207,8 @@ private:
           default:
           case 0:
             // Invisible Tile
-            position.x = screen_pos.x;
-            position.y = screen_pos.y;
+            position.x = world_pos.x;
+            position.y = world_pos.y;
             position.w = tile_w;
             position.h = tile_h;
 
@@ -146,8 +222,8 @@ private:
 
           case 1:
             // Visible Tile
-            position.x = screen_pos.x;
-            position.y = screen_pos.y;
+            position.x = world_pos.x;
+            position.y = world_pos.y;
             position.w = tile_w;
             position.h = tile_h;
 
@@ -159,8 +235,8 @@ private:
             break;
           case 2:
             // Tree
-            position.x = screen_pos.x;
-            position.y = screen_pos.y - tile_h;
+            position.x = world_pos.x;
+            position.y = world_pos.y - tile_h;
             position.w = tile_w;
             position.h = tile_h * 2;
 
@@ -173,8 +249,8 @@ private:
 
           case 3:
             // Spooky Tree
-            position.x = screen_pos.x;
-            position.y = screen_pos.y - tile_h;
+            position.x = world_pos.x;
+            position.y = world_pos.y - tile_h;
             position.w = tile_w;
             position.h = tile_h * 2;
 
@@ -187,8 +263,8 @@ private:
 
           case 4:
             // Beach
-            position.x = screen_pos.x;
-            position.y = screen_pos.y;
+            position.x = world_pos.x;
+            position.y = world_pos.y;
             position.w = tile_w;
             position.h = tile_h;
 
@@ -201,8 +277,8 @@ private:
 
           case 5:
             // Water
-            position.x = screen_pos.x;
-            position.y = screen_pos.y;
+            position.x = world_pos.x;
+            position.y = world_pos.y;
             position.w = tile_w;
             position.h = tile_h;
 
@@ -214,49 +290,7 @@ private:
             break;
         }
 
-        draw_texture(sprites, position, sprite_crop);
-      }
-    }
-
-
-    // Selected tile
-    const int mouse_x = mouse_state().x;
-    const int mouse_y = mouse_state().y;
-
-    const point_t selected_tile = coord_screen_to_map({mouse_x, mouse_y});
-    const point_t screen_selected_tile = coord_map_to_screen(selected_tile);
-
-    rect_t position;
-    rect_t sprite_crop;
-    position.x = screen_selected_tile.x;
-    position.y = screen_selected_tile.y;
-    position.w = tile_w;
-    position.h = tile_h;
-
-    sprite_crop.x = 0 * sprite_w;
-    sprite_crop.y = 0 * sprite_h;
-    sprite_crop.w = sprite_w;
-    sprite_crop.h = sprite_h;
-
-    draw_texture(sprites, position, sprite_crop);
-
-    // Draw coordinates
-    const texture_t mouse_coord_text = create_text(
-        "Mouse: " + STR(mouse_x) + ", " + STR(mouse_y), 0x000000FF, font);
-
-    const texture_t tile_coord_text = create_text(
-        "Tile: " + STR(selected_tile.x) + ", " + STR(selected_tile.y),
-        0x000000FF, font);
-
-    draw_texture(mouse_coord_text, 5, 5);
-    draw_texture(tile_coord_text, 5, 20);
-
-    // Change the tile
-    if (mouse_state().left_button.click) {
-      if (selected_tile.x < world_w && selected_tile.x >= 0 &&
-          selected_tile.y < world_h && selected_tile.y >= 0) {
-        const int current_val = world[selected_tile.y][selected_tile.x];
-        world[selected_tile.y][selected_tile.x] = (current_val + 1) % 6;
+        world_list.add_sprite(sprites, position, sprite_crop);
       }
     }
   }
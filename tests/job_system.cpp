@@ -0,0 +1,222 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "job_system.hpp"
+#include "check.hpp"
+
+
+void check_parallel_for(job_system_t& jobs, const std::string& name)
+{
+  // Each index once, over ranges that do not divide the count
+  constexpr size_t count = 100003;
+  std::vector<std::atomic<uint8_t>> hits(count);
+  std::atomic<uint64_t> sum{0};
+
+  jobs.parallel_for(0, count, 1000, [&](const size_t b, const size_t e) {
+    uint64_t local = 0;
+    for (size_t i = b; i < e; ++i) {
+      hits[i].fetch_add(1);
+      local += i;
+    }
+    sum.fetch_add(local);
+  });
+
+  bool once = true;
+  for (const auto& h : hits) { once = once && h.load() == 1; }
+  check(once, name + ": parallel_for runs each index once");
+  check(sum.load() == uint64_t(count) * (count - 1) / 2,
+        name + ": parallel_for sum");
+}
+
+
+void check_nested(job_system_t& jobs, const std::string& name)
+{
+  // More jobs than a deque holds, started from jobs
+  job_counter_t counter;
+  std::atomic<int32_t> ran{0};
+
+  for (int32_t i = 0; i < 64; ++i) {
+    jobs.run(
+        [&] {
+          for (int32_t k = 0; k < 200; ++k) {
+            jobs.run([&] { ran.fetch_add(1); }, &counter);
+          }
+        },
+        &counter);
+  }
+
+  jobs.wait(counter);
+  check(ran.load() == 64 * 200, name + ": nested jobs all ran");
+}
+
+
+void check_run_after(job_system_t& jobs, const std::string& name)
+{
+  // Three stages, each started once the previous one is done
+  job_counter_t first, second, third;
+  std::atomic<int32_t> stage_one{0};
+  std::atomic<int32_t> stage_two{0};
+  std::atomic<bool> ordered{true};
+
+  for (int32_t i = 0; i < 100; ++i) {
+    jobs.run(
+        [&] {
+          std::this_thread::sleep_for(std::chrono::microseconds(50));
+          stage_one.fetch_add(1);
+        },
+        &first);
+  }
+
+  for (int32_t i = 0; i < 10; ++i) {
+    jobs.run_after(
+        first,
+        [&] {
+          if (stage_one.load() != 100) { ordered = false; }
+          stage_two.fetch_add(1);
+        },
+        &second);
+  }
+
+  jobs.run_after(
+      second, [&] { ordered = ordered && stage_two.load() == 10; }, &third);
+
+  jobs.wait(third);
+  check(ordered.load(), name + ": run_after waits for its dependency");
+  check(first.done() && second.done(), name + ": dependencies done");
+
+  // A dependency already done starts the job right away
+  std::atomic<bool> ran{false};
+  jobs.run_after(first, [&] { ran = true; }, &third);
+  jobs.wait(third);
+  check(ran.load(), name + ": run_after a done counter");
+}
+
+
+void check_main_jobs(job_system_t& jobs, const std::string& name)
+{
+  // Queued from workers, run by the main thread while it waits
+  job_counter_t counter;
+  std::atomic<int32_t> on_main{0};
+  std::atomic<int32_t> off_main{0};
+
+  for (int32_t i = 0; i < 16; ++i) {
+    jobs.run(
+        [&] {
+          jobs.run_on_main(
+              [&] {
+                if (jobs.is_main_thread()) {
+                  on_main.fetch_add(1);
+                } else {
+                  off_main.fetch_add(1);
+                }
+              },
+              &counter);
+        },
+        &counter);
+  }
+
+  jobs.wait(counter);
+  check(on_main.load() == 16 && off_main.load() == 0,
+        name + ": main only jobs run on the main thread");
+}
+
+
+void check_sleeping_wait(job_system_t& jobs, const std::string& name)
+{
+  // Nothing to help with, the waiter sleeps until the job ends
+  job_counter_t counter;
+  std::atomic<bool> done{false};
+
+  jobs.run(
+      [&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        done = true;
+      },
+      &counter);
+
+  jobs.wait(counter);
+  check(done.load(), name + ": wait returns after the job");
+}
+
+
+void check_exceptions(job_system_t& jobs, const std::string& name)
+{
+  // The others still run, wait() rethrows and the counter can be reused
+  job_counter_t counter;
+  std::atomic<int32_t> ran{0};
+
+  for (int32_t i = 0; i < 20; ++i) {
+    jobs.run(
+        [&, i] {
+          if (i == 7) { throw runtime_exception("job 7"); }
+          ran.fetch_add(1);
+        },
+        &counter);
+  }
+
+  std::string what;
+  try {
+    jobs.wait(counter);
+  } catch (const runtime_exception& e) {
+    what = e.what();
+  }
+  check(what.find("job 7") != std::string::npos,
+        name + ": wait rethrows the job exception");
+  check(ran.load() == 19 && counter.done(), name + ": the other jobs ran");
+
+  bool thrown = false;
+  jobs.run([] {}, &counter);
+  try {
+    jobs.wait(counter);
+  } catch (...) {
+    thrown = true;
+  }
+  check(!thrown, name + ": the counter is clean after the rethrow");
+
+  thrown = false;
+  try {
+    jobs.parallel_for(0, 100, 10, [](const size_t b, const size_t) {
+      if (b == 50) { throw runtime_exception("range 50"); }
+    });
+  } catch (const runtime_exception&) {
+    thrown = true;
+  }
+  check(thrown, name + ": parallel_for rethrows");
+
+  // Without a counter it comes out of run_main_jobs(). Without workers the
+  // thrower, started last, runs first while waiting.
+  job_counter_t idle;
+  jobs.run([] {}, &idle);
+  jobs.run([] { throw runtime_exception("orphan"); });
+  jobs.wait(idle);
+
+  thrown = false;
+  for (int32_t i = 0; i < 1000 && !thrown; ++i) {
+    try {
+      jobs.run_main_jobs();
+    } catch (const runtime_exception&) {
+      thrown = true;
+    }
+    if (!thrown) { std::this_thread::sleep_for(std::chrono::milliseconds(1)); }
+  }
+  check(thrown, name + ": run_main_jobs rethrows the job without counter");
+}
+
+
+int main()
+{
+  for (const int32_t workers : {3, 0}) {
+    job_system_t jobs(workers);
+    const std::string name = STR(workers) + " workers";
+
+    check_parallel_for(jobs, name);
+    check_nested(jobs, name);
+    check_run_after(jobs, name);
+    check_main_jobs(jobs, name);
+    check_sleeping_wait(jobs, name);
+    check_exceptions(jobs, name);
+  }
+
+  return report("job system");
+}
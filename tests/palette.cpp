@@ -0,0 +1,146 @@
+#include <iostream>
+#include <memory>
+#include <vector>
+#include "palette.hpp"
+#include "check.hpp"
+
+std::unique_ptr<palette_framebuffer_t> fb;
+uint32_t frame = 0;
+
+
+uint32_t argb(const uint8_t a,
+              const uint8_t r,
+              const uint8_t g,
+              const uint8_t b)
+{
+  return (uint32_t(a) << 24) | (uint32_t(r) << 16) | (uint32_t(g) << 8) | b;
+}
+
+
+// Both paths against the table itself, on lengths around the 8 pixel steps
+void check_expansion()
+{
+  std::vector<uint32_t> lut(256);
+  for (uint32_t i = 0; i < 256; ++i) { lut[i] = i * 0x01010101u ^ 0x5A00A5u; }
+
+  std::vector<uint8_t> src(1031);
+  uint32_t seed = 3;
+  for (uint8_t& v : src) {
+    seed = seed * 1664525u + 1013904223u;
+    v = static_cast<uint8_t>(seed >> 24);
+  }
+
+  for (const size_t n : {0, 1, 7, 8, 9, 15, 16, 17, 33, 1031}) {
+    for (const bool simd : {false, true}) {
+      std::vector<uint32_t> dst(n + 1, 0xDEADBEEF);
+      palette_framebuffer_t::expand_row(dst.data(), src.data(), n, lut.data(),
+                                        simd);
+
+      bool ok = dst[n] == 0xDEADBEEF;
+      for (size_t i = 0; i < n; ++i) { ok = ok && dst[i] == lut[src[i]]; }
+      check(ok, "expand_row, n: " + STR(n) + ", simd: " + STR(simd));
+    }
+  }
+}
+
+
+void check_cycle()
+{
+  std::vector<pixel_t> colors;
+  for (uint32_t i = 0; i < 256; ++i) {
+    colors.push_back(pixel_t(i, 255 - i, i / 2, 255));
+  }
+  fb->set_palette(colors);
+
+  fb->cycle(16, 8, 1);
+  check(fb->color(17) == colors[16], "cycle forward moves the colors up");
+  check(fb->color(16) == colors[23], "cycle forward wraps the last color");
+  check(fb->color(15) == colors[15] && fb->color(24) == colors[24],
+        "cycle leaves the colors out of the range");
+
+  // Nine steps over eight entries is one, back to the start after it
+  fb->cycle(16, 8, -9);
+  bool same = true;
+  for (uint32_t i = 0; i < 256; ++i) {
+    same = same && fb->color(i) == colors[i];
+  }
+  check(same, "cycle backward undoes the forward one");
+
+  bool thrown = false;
+  try {
+    fb->cycle(250, 8, 1);
+  } catch (const input_exception&) {
+    thrown = true;
+  }
+  check(thrown, "cycle past the palette throws");
+}
+
+
+void check_fade()
+{
+  fb->set_color(1, pixel_t(255, 0, 100, 200));
+
+  fb->fade(pixel_t(0, 0, 0, 255), 0.0f);
+  check(fb->lut()[1] == argb(200, 255, 0, 100), "no fade keeps the color");
+
+  fb->fade(pixel_t(0, 0, 0, 255), 0.5f);
+  check(fb->lut()[1] == argb(200, 127, 0, 50), "half fade to black");
+
+  fb->fade(pixel_t(0, 255, 0, 255), 1.0f);
+  check(fb->lut()[1] == argb(200, 0, 255, 0), "full fade keeps the alpha");
+
+  fb->fade(pixel_t(0, 0, 0, 255), 2.0f);
+  check(fb->lut()[1] == argb(200, 0, 0, 0), "fade amount is clamped");
+
+  fb->fade(pixel_t(0, 0, 0, 255), 0.0f);
+}
+
+
+class palette_demo : public pixello
+{
+public:
+  palette_demo() : pixello(640, 400, "Palette", 60) {}
+
+private:
+  void on_init(void*) override
+  {
+    fb = std::make_unique<palette_framebuffer_t>(*this, 320, 200);
+
+    check_expansion();
+    check_cycle();
+    check_fade();
+
+    // A ramp over the cycled range, in diagonal bands
+    std::vector<pixel_t> colors(256, pixel_t(0, 0, 0, 255));
+    for (uint32_t i = 0; i < 64; ++i) {
+      colors[32 + i] = pixel_t(i * 4, 255 - i * 4, 128, 255);
+    }
+    fb->set_palette(colors);
+
+    for (int32_t y = 0; y < fb->h(); ++y) {
+      for (int32_t x = 0; x < fb->w(); ++x) {
+        fb->set_pixel(x, y, 32 + (x + y) / 4 % 64);
+      }
+    }
+  }
+
+  void on_update(void*) override
+  {
+    // The bands scroll without touching the pixels, then fade out
+    fb->cycle(32, 64, 1);
+    fb->fade(pixel_t(0, 0, 0, 255), frame / 120.0f);
+    fb->draw(*this);
+
+    if (++frame > 120 || is_key_pressed(keycap_t::ESC)) { stop(); }
+  }
+};
+
+
+int main()
+{
+  palette_demo p;
+
+  if (!p.run()) { return 1; }
+
+  return report("palette");
+}
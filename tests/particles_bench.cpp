@@ -0,0 +1,53 @@
+#include <chrono>
+#include <iostream>
+#include "particles.hpp"
+
+constexpr size_t particle_count = 1000000;
+constexpr int32_t frame_count = 600;
+constexpr float frame_dt = 1.0f / 60.0f;
+
+using bench_clock = std::chrono::steady_clock;
+
+
+int main()
+{
+  particle_config_t config;
+  config.gravity_y = 98.0f;
+  config.drag = 0.1f;
+  config.color_start = 0xFFCC00FF;
+  config.color_end = 0xFF000000;
+
+  particle_system_t particles(particle_count, config);
+
+  particle_burst_t burst;
+  burst.x = 400.0f;
+  burst.y = 400.0f;
+  burst.radius = 20.0f;
+  burst.life_min = 1.0f;
+  burst.life_max = 3.0f;
+
+  (void)particles.emit(burst, particle_count);
+
+  double total_ms = 0.0;
+  double max_ms = 0.0;
+
+  for (int32_t i = 0; i < frame_count; ++i) {
+    const auto start = bench_clock::now();
+
+    particles.update(frame_dt);
+    // Keeps the system full, as a steady effect would
+    (void)particles.emit(burst, particle_count - particles.size());
+
+    const auto end = bench_clock::now();
+    const double ms =
+        std::chrono::duration<double, std::milli>(end - start).count();
+    total_ms += ms;
+    max_ms = std::max(max_ms, ms);
+  }
+
+  std::cout << particle_count << " particles, update avg: "
+            << total_ms / frame_count << "ms max: " << max_ms << "ms"
+            << std::endl;
+
+  return particles.size() == particle_count ? 0 : 1;
+}
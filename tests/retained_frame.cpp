@@ -0,0 +1,83 @@
+#include <iostream>
+#include "pixello.hpp"
+#include "check.hpp"
+
+constexpr int32_t frame_count = 60;
+
+uint32_t skipped = 0;
+int32_t frame = 0;
+bool damaged = false;
+rect_t square = {0, 40, 16, 16};
+
+
+config_t retained_config()
+{
+  config_t config(2, 640, 400, "Retained frame", 60);
+  config.logical_resolution = true;
+  config.retained_frame = true;
+  config.retained_wait_ms = 10;
+  return config;
+}
+
+
+class retained_demo : public pixello
+{
+public:
+  retained_demo() : pixello(retained_config()) {}
+
+private:
+  void on_init(void*) override {}
+
+  void on_update(void*) override
+  {
+    // The stats of the previous frame. Window events may damage any frame,
+    // so only the ones damaged here must be presented.
+    if (frame > 1) {
+      const uint32_t presents = frame_stats().presents;
+      check(!damaged || presents == 1,
+            "damaged frame not presented at frame " + STR(frame - 1));
+      if (presents == 0) { ++skipped; }
+    }
+
+    // A square moving every fourth frame, cleared where it was first
+    damaged = frame % 4 == 0;
+    if (damaged) {
+      invalidate(square);
+      square.x = (square.x + 16) % (width() - square.w);
+      invalidate(square);
+
+      const rect_t& d = damage();
+      check(d.x <= square.x && d.y <= square.y &&
+                d.x + d.w >= square.x + square.w &&
+                d.y + d.h >= square.y + square.h,
+            "damage does not cover the square at frame " + STR(frame));
+    }
+
+    // Out of the frame, damage is cut to it
+    if (frame == 2) {
+      invalidate({width() - 10, height() - 10, 40, 40});
+      check(damage().x + damage().w <= width() &&
+                damage().y + damage().h <= height(),
+            "damage out of the frame");
+    }
+
+    // Drawn every frame, shown only when damaged
+    draw_rect({0, 0, width(), height()}, pixel_t(30, 30, 60, 255));
+    draw_rect(square, pixel_t(255, 200, 0, 255));
+
+    if (++frame > frame_count || is_key_pressed(keycap_t::ESC)) { stop(); }
+  }
+};
+
+
+int main()
+{
+  retained_demo p;
+
+  if (!p.run()) { return 1; }
+
+  check(skipped > 0, "no present was skipped");
+  std::cout << skipped << " presents skipped" << std::endl;
+
+  return report("retained frame");
+}
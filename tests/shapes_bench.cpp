@@ -0,0 +1,119 @@
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "pixello.hpp"
+#include "shapes.hpp"
+
+constexpr size_t circle_count = 5000;
+constexpr int32_t frames_per_mode = 120;
+
+struct circle_t
+{
+  int32_t x, y, r;
+  pixel_t color;
+};
+
+enum class bench_mode_t
+{
+  BATCH,
+  BATCH_AA,
+  PER_CALL,
+#ifdef PIXELLO_HAS_SDL2_GFX
+  GFX,
+#endif
+  DONE
+};
+
+const char* mode_names[] = {"batch", "batch aa", "draw_circle", "SDL2_gfx"};
+
+std::vector<circle_t> circles;
+shape_batch_t batch;
+bench_mode_t mode = bench_mode_t::BATCH;
+int32_t frame = 0;
+double total_ms = 0.0;
+
+
+class shapes_bench : public pixello
+{
+public:
+  shapes_bench() : pixello(800, 800, "Shapes benchmark", 1000) {}
+
+private:
+  void on_init(void*) override
+  {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int32_t> pos(0, 800);
+    std::uniform_int_distribution<int32_t> radius(2, 40);
+    std::uniform_int_distribution<uint32_t> color(0, 0xFFFFFF);
+
+    circles.resize(circle_count);
+    for (auto& c : circles) {
+      c = {pos(rng), pos(rng), radius(rng), (color(rng) << 8) | 0x80};
+    }
+  }
+
+  void on_update(void*) override
+  {
+    const auto start = std::chrono::steady_clock::now();
+
+    switch (mode) {
+      case bench_mode_t::BATCH:
+      case bench_mode_t::BATCH_AA:
+        // Rebuilt every frame, as moving circles would be
+        batch.clear();
+        batch.set_antialias(mode == bench_mode_t::BATCH_AA);
+        for (const auto& c : circles) {
+          batch.add_circle(static_cast<float>(c.x), static_cast<float>(c.y),
+                           static_cast<float>(c.r), c.color);
+        }
+        batch.draw(*this);
+        break;
+
+      case bench_mode_t::PER_CALL:
+        for (const auto& c : circles) {
+          draw_circle(c.x, c.y, c.r, c.color);
+        }
+        break;
+
+#ifdef PIXELLO_HAS_SDL2_GFX
+      case bench_mode_t::GFX:
+        for (const auto& c : circles) {
+          draw_circle_gfx(c.x, c.y, c.r, c.color);
+        }
+        break;
+#endif
+
+      case bench_mode_t::DONE: break;
+    }
+
+    total_ms += std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+
+    if (++frame < frames_per_mode) { return; }
+
+    std::cout << circle_count << " circles, "
+              << mode_names[static_cast<int>(mode)]
+              << ": " << total_ms / frames_per_mode << "ms per frame, "
+              << frame_stats().draw_calls << " draw calls, "
+              << frame_stats().state_changes << " state changes ("
+              << frame_stats().state_changes_skipped << " skipped)"
+              << std::endl;
+
+    frame = 0;
+    total_ms = 0.0;
+    mode = static_cast<bench_mode_t>(static_cast<int>(mode) + 1);
+    if (mode == bench_mode_t::DONE) { stop(); }
+  }
+};
+
+
+int main()
+{
+  shapes_bench p;
+
+  if (p.run()) { return 0; }
+
+  return 1;
+}
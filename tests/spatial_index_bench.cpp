@@ -0,0 +1,130 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "spatial_index.hpp"
+
+constexpr int32_t world_size = 8192;
+constexpr size_t rect_count = 100000;
+constexpr size_t query_count = 100000;
+
+using bench_clock = std::chrono::steady_clock;
+
+std::vector<rect_t> rects;
+std::vector<int32_t> zs;
+std::vector<point_t> points;
+
+
+double elapsed_ms(const bench_clock::time_point& start)
+{
+  const auto end = bench_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+
+// Reference implementation, what is_mouse_in() per widget amounts to
+spatial_id_t linear_pick(const point_t& p)
+{
+  spatial_id_t result = INVALID_SPATIAL_ID;
+
+  for (size_t i = 0; i < rects.size(); ++i) {
+    const rect_t& r = rects[i];
+    if (p.x >= r.x && p.x < r.x + r.w && p.y >= r.y && p.y < r.y + r.h) {
+      if (result == INVALID_SPATIAL_ID || zs[i] >= zs[result]) {
+        result = static_cast<spatial_id_t>(i);
+      }
+    }
+  }
+
+  return result;
+}
+
+
+template <typename INDEX>
+bool bench(const std::string& name, INDEX& index)
+{
+  auto start = bench_clock::now();
+  for (size_t i = 0; i < rects.size(); ++i) {
+    index.insert(rects[i], zs[i]);
+  }
+  std::cout << name << " insert: " << elapsed_ms(start) << "ms" << std::endl;
+
+  start = bench_clock::now();
+  spatial_id_t checksum = 0;
+  for (const auto& p : points) {
+    checksum += index.pick(p);
+  }
+  std::cout << name << " pick: " << elapsed_ms(start) << "ms (" << checksum
+            << ")" << std::endl;
+
+  start = bench_clock::now();
+  std::vector<spatial_id_t> out;
+  size_t hits = 0;
+  for (const auto& p : points) {
+    out.clear();
+    index.query(rect_t{p.x, p.y, 128, 128}, out);
+    hits += out.size();
+  }
+  std::cout << name << " rect query: " << elapsed_ms(start) << "ms (" << hits
+            << " hits)" << std::endl;
+
+  // Move everything a bit, like a frame of moving entities
+  start = bench_clock::now();
+  for (size_t i = 0; i < rects.size(); ++i) {
+    rect_t r = rects[i];
+    r.x += 3;
+    r.y -= 2;
+    index.move(static_cast<spatial_id_t>(i), r);
+  }
+  std::cout << name << " move: " << elapsed_ms(start) << "ms" << std::endl;
+
+  for (size_t i = 0; i < rects.size(); ++i) {
+    index.move(static_cast<spatial_id_t>(i), rects[i]);
+  }
+
+  // Check against the reference on a subset of the points
+  for (size_t i = 0; i < 1000; ++i) {
+    if (index.pick(points[i]) != linear_pick(points[i])) {
+      std::cout << name << " pick mismatch at " << points[i].x << ", "
+                << points[i].y << std::endl;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+int main()
+{
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int32_t> pos(0, world_size - 256);
+  std::uniform_int_distribution<int32_t> size(4, 96);
+  std::uniform_int_distribution<int32_t> layer(0, 3);
+
+  for (size_t i = 0; i < rect_count; ++i) {
+    rects.push_back({pos(rng), pos(rng), size(rng), size(rng)});
+    zs.push_back(layer(rng));
+  }
+
+  for (size_t i = 0; i < query_count; ++i) {
+    points.push_back({pos(rng), pos(rng)});
+  }
+
+  auto start = bench_clock::now();
+  spatial_id_t checksum = 0;
+  for (size_t i = 0; i < 1000; ++i) {
+    checksum += linear_pick(points[i]);
+  }
+  std::cout << "linear pick (1000 points only): " << elapsed_ms(start) << "ms ("
+            << checksum << ")" << std::endl;
+
+  grid_index_t grid(64);
+  quadtree_t tree({0, 0, world_size, world_size});
+
+  bool ok = bench("grid", grid);
+  ok = bench("quadtree", tree) && ok;
+
+  return ok ? 0 : 1;
+}
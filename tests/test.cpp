@@ -1,16 +1,20 @@
 #include <iostream>
+#include <memory>
 #include <vector>
+#include "glyph_cache.hpp"
 #include "pixello.hpp"
 
 texture_t media1;
-texture_t media2;
 texture_t sprites;
 
+atlas_t atlas;
+sub_texture_t media2;
+sub_texture_t penguin;
+
 int32_t media2_x;
 int32_t media2_y;
 
 sound_t sound;
-music_t music;
 
 font_t font;
 font_t font_2;
@@ -32,7 +36,8 @@ float global_volume = 1.0f;
 bool music_state = false;
 simple_timer timer;
 
-texture_t input_text_texture;
+std::unique_ptr<glyph_cache_t> input_glyphs;
+text_view_t input_view;
 
 std::string pos_str(button_key_t::state_t s)
 {
@@ -77,19 +82,25 @@ private:
   {
     font = load_font("assets/font/PressStart2P.ttf", 10);
     font_2 = load_font("assets/font/PressStart2P.ttf", 20);
+    input_glyphs = std::make_unique<glyph_cache_t>(*this, font, 0x000000FF);
     media1 = load_image("assets/sample_640x426.bmp");
-    media2 = load_image("assets/Chess_klt60.png");
     sprites = load_image("assets/sprites.png");
 
-    media2_x = (800 / 2) - (media2.w / 2);
-    media2_y = (800 / 2) - (media2.h / 2);
+    // Small images share the same atlas page
+    atlas = load_atlas({"assets/Chess_klt60.png", "assets/penguin.png",
+                        "assets/foo.png"});
+    media2 = atlas.get("assets/Chess_klt60.png");
+    penguin = atlas.get("assets/penguin.png");
+
+    media2_x = (800 / 2) - (media2.w() / 2);
+    media2_y = (800 / 2) - (media2.h() / 2);
 
     holding_icon = false;
     holding_offset_x = 0;
     holding_offset_y = 0;
 
-    music = load_music("assets/sound/doom.wav");
     sound = load_sound("assets/sound/dspunch.wav");
+    sound.set_max_instances(3);
   }
 
   void on_update(void*) override
@@ -156,7 +167,7 @@ private:
     draw_texture(sprites, {x_clip_pos, height() / 2, 50, 50}, {0, 0, 100, 100});
 
     // Update media2 position if mouse current state button down
-    const rect_t r = {media2_x, media2_y, media2.w, media2.h};
+    const rect_t r = {media2_x, media2_y, media2.w(), media2.h()};
     if (is_mouse_in(r) &&
         (mouse_state().left_button.state == button_key_t::DOWN)) {
       if (!holding_icon) {
@@ -179,6 +190,7 @@ private:
 
     // Draw texture with transparency
     draw_texture(media2, media2_x, media2_y);
+    draw_texture(penguin, {10, 800 - 74, 64, 64});
 
     // Draw circle
     draw_circle(800 - 50, 50, 50, 0xFF000055);
@@ -262,16 +274,12 @@ private:
       stop_text_input();
     }
 
-    if (is_text_input_enabled() && should_render_text()) {
-      const std::string& text_to_render = get_input_text();
-      input_text_texture = create_text(text_to_render, 0x000000FF, font);
-    }
-
+    // Only the visible glyphs are drawn, from the glyph cache
     draw_rect(input_rect, input_filed_color);
-    if (input_text_texture.is_valid()) {
-      draw_texture(input_text_texture, input_rect.x + 2,
-                   input_rect.y + ((input_rect.h - input_text_texture.h) / 2));
-    }
+    input_view.draw(*this, *input_glyphs, input_buffer(),
+                    {input_rect.x + 2, input_rect.y, input_rect.w - 4,
+                     input_rect.h},
+                    is_text_input_enabled());
 
     int32_t y_draw_offset = 0;
     // Mouse
@@ -315,6 +323,16 @@ private:
 
     y_draw_offset += did_mouse_moved_texture.h;
 
+    const music_stream_stats_t music_stats = music_stream_stats();
+    texture_t music_texture = create_text(
+        "Music buffer: " + STR(static_cast<int>(music_stats.fill * 100)) +
+            "% underruns: " + STR(music_stats.underruns),
+        p, font);
+    draw_texture(music_texture, gray_viewport.x + 0,
+                 gray_viewport.y + y_draw_offset);
+
+    y_draw_offset += music_texture.h;
+
     set_sound_volume(sound, 0.5f);
 
     // Button
@@ -341,7 +359,8 @@ private:
     if (is_mouse_in(gray_viewport)) {
       if (mouse_state().left_button.click) { play_sound(sound); }
       if (mouse_state().right_button.click) {
-        play_music(music);
+        // Restarting crossfades with the running track
+        play_music_stream("assets/sound/doom.wav", 1.0f);
         music_state = true;
       }
     }
@@ -0,0 +1,86 @@
+#include <iostream>
+#include <vector>
+#include "image.hpp"
+#include "pixello.hpp"
+#include "check.hpp"
+
+constexpr int32_t texture_count = 8;
+constexpr int32_t size = 64;
+constexpr uint64_t texture_bytes = size * size * 4;
+constexpr int32_t frame_count = 60;
+
+std::vector<texture_t> textures;
+uint32_t evictions = 0;
+uint32_t reuploads = 0;
+int32_t frame = 0;
+
+
+class residency_demo : public pixello
+{
+public:
+  residency_demo() : pixello(640, 200, "Texture residency", 60) {}
+
+private:
+  void on_init(void*) override
+  {
+    // Room for four, three are drawn each frame
+    set_texture_budget(4 * texture_bytes);
+
+    for (int32_t i = 0; i < texture_count; ++i) {
+      const uint8_t c = static_cast<uint8_t>(i * 32);
+      const pixel_t color(c, 255 - c, 128, 255);
+
+      // The second one is kept over the others without being drawn
+      const int32_t priority = i == 1 ? 10 : 0;
+      textures.push_back(upload_managed(image_t(size, size, color), priority));
+    }
+  }
+
+  void on_update(void*) override
+  {
+    // The stats of the previous frame. Nothing is cold in the first one, it
+    // uploads everything.
+    if (frame > 1) {
+      const frame_stats_t& s = frame_stats();
+      evictions += s.texture_evictions;
+      reuploads += s.texture_reuploads;
+
+      check(s.managed_resident_bytes <= s.texture_budget,
+            "over the budget at frame " + STR(frame));
+      check(s.managed_resident_bytes + s.managed_evicted_bytes ==
+                texture_count * texture_bytes,
+            "bytes lost at frame " + STR(frame));
+      check(textures[0].pointer() != NULL, "the drawn texture was evicted");
+      check(textures[1].pointer() != NULL,
+            "the high priority texture was evicted");
+    }
+
+    // An evicted texture keeps its mod for the next upload
+    const texture_t& next = textures[2 + (frame + 2) % (texture_count - 2)];
+    if (next.pointer() == NULL) { set_texture_mod(next, 0xFF8080C0); }
+
+    // One always, two moving over the others
+    draw_texture(textures[0], {0, 0, size, size});
+    for (int32_t k = 0; k < 2; ++k) {
+      const int32_t i = 2 + (frame + k) % (texture_count - 2);
+      draw_texture(textures[i], {(k + 1) * (size + 8), 0, size, size});
+    }
+
+    if (++frame > frame_count || is_key_pressed(keycap_t::ESC)) { stop(); }
+  }
+};
+
+
+int main()
+{
+  residency_demo p;
+
+  if (!p.run()) { return 1; }
+
+  check(evictions > 0, "nothing was evicted");
+  check(reuploads > 0, "nothing was uploaded again");
+  std::cout << evictions << " evictions, " << reuploads << " re-uploads"
+            << std::endl;
+
+  return report("residency");
+}
@@ -0,0 +1,93 @@
+#include <chrono>
+#include <memory>
+#include "pixello.hpp"
+#include "ui.hpp"
+
+constexpr int rows = 25;
+constexpr int cols = 20;
+
+font_t font;
+std::unique_ptr<ui_t> ui;
+
+widget_id_t time_label;
+widget_id_t click_label;
+widget_id_t name_field;
+std::vector<widget_id_t> buttons;
+
+uint32_t click_counter = 0;
+simple_timer timer;
+
+
+class ui_demo : public pixello
+{
+public:
+  ui_demo() : pixello(1280, 800, "Retained ui", 60) {}
+
+private:
+  void on_init(void*) override
+  {
+    font = load_font("assets/font/PressStart2P.ttf", 8);
+
+    ui = std::make_unique<ui_t>(*this, font);
+    ui->set_position({10, 10});
+    timer.start();
+
+    const widget_id_t header = ui->add_panel(ui->root(), layout_t::HORIZONTAL);
+    time_label = ui->add_label(header, "UI time: 0us");
+    click_label = ui->add_label(header, "Clicks: 0");
+    name_field = ui->add_text_field(header, 200);
+    ui->bind_text_buffer(name_field, &input_buffer());
+
+    // 500 buttons, laid out once
+    for (int r = 0; r < rows; ++r) {
+      const widget_id_t row = ui->add_panel(ui->root(), layout_t::HORIZONTAL);
+
+      for (int c = 0; c < cols; ++c) {
+        buttons.push_back(ui->add_button(row, STR(r * cols + c), 56, 0));
+      }
+    }
+  }
+
+  void on_update(void*) override
+  {
+    const auto start = std::chrono::steady_clock::now();
+
+    ui->update(mouse_state());
+
+    for (const widget_id_t b : buttons) {
+      if (ui->clicked(b)) {
+        ++click_counter;
+        ui->set_text(click_label, "Clicks: " + STR(click_counter));
+      }
+    }
+
+    if (ui->focused() == name_field) {
+      start_text_input();
+    } else {
+      stop_text_input();
+    }
+
+    ui->draw();
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+
+    // Refresh the label twice per second, not to measure its own redraw
+    if (timer.get_ticks() >= 500) {
+      ui->set_text(time_label, "UI time: " + STR(elapsed.count()) + "us");
+      timer.restart();
+    }
+
+    if (is_key_pressed(keycap_t::ESC)) { stop(); }
+  }
+};
+
+
+int main()
+{
+  ui_demo p;
+
+  if (p.run()) { return 0; }
+
+  return 1;
+}